@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Contiki shell command csma-stats, which shows the CSMA
+ *         queue statistics in total and per neighbor
+ */
+
+#include <stdio.h>
+
+#include "contiki.h"
+#include "shell.h"
+#include "net/mac/csma.h"
+
+#define BUFLEN 80
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_csma_process, "csma-stats");
+SHELL_COMMAND(csma_command,
+	      "csma-stats",
+	      "csma-stats: show CSMA queue statistics per neighbor",
+	      &shell_csma_process);
+/*---------------------------------------------------------------------------*/
+#if CSMA_STATS
+static void
+print_stats(const char *name, int queue_len, const struct csma_stats *s)
+{
+  char buf[BUFLEN];
+  char queue[12];
+  unsigned long done, tx;
+
+  /* Average transmissions per packet, with two decimals */
+  done = (unsigned long)s->sent + s->dropped;
+  tx = done == 0 ? 0 : (unsigned long)s->transmissions * 100 / done;
+  if(queue_len < 0) {
+    snprintf(queue, sizeof(queue), "-");
+  } else {
+    snprintf(queue, sizeof(queue), "%d", queue_len);
+  }
+  snprintf(buf, BUFLEN, "%s %s %u %u %u %u %lu.%02lu",
+           name, queue, s->queued, s->sent, s->dropped,
+           s->collisions, tx / 100, tx % 100);
+  shell_output_str(&csma_command, buf, "");
+}
+#endif /* CSMA_STATS */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_csma_process, ev, data)
+{
+#if CSMA_STATS
+  char name[3 * LINKADDR_SIZE];
+  char *p;
+  struct csma_stats *s;
+  const linkaddr_t *addr;
+  int i;
+#endif /* CSMA_STATS */
+
+  PROCESS_BEGIN();
+
+#if CSMA_STATS
+  shell_output_str(&csma_command,
+                   "neighbor queue queued sent dropped collisions tx/packet", "");
+  print_stats("total", -1, &csma_stats);
+  for(s = csma_stats_neighbor_head(); s != NULL;
+      s = csma_stats_neighbor_next(s)) {
+    addr = csma_stats_neighbor_lladdr(s);
+    p = name;
+    for(i = 0; i < LINKADDR_SIZE; i++) {
+      p += sprintf(p, i == 0 ? "%02x" : ":%02x", addr->u8[i]);
+    }
+    print_stats(name, csma_queue_length(addr), s);
+  }
+#else /* CSMA_STATS */
+  shell_output_str(&csma_command,
+                   "csma-stats: build with CSMA_CONF_STATS to enable", "");
+#endif /* CSMA_STATS */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_csma_init(void)
+{
+  shell_register_command(&csma_command);
+}
+/*---------------------------------------------------------------------------*/
@@ -376,6 +376,7 @@ struct shell_input {
 #include "shell-blink.h"
 #include "shell-collect-view.h"
 #include "shell-coffee.h"
+#include "shell-csma.h"
 #include "shell-download.h"
 #include "shell-exec.h"
 #include "shell-file.h"
@@ -191,8 +191,15 @@ aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
   AES_128.set_key(block);
 }
 /*---------------------------------------------------------------------------*/
+static void
+forget_key(uint8_t *key)
+{
+  memset(round_keys, 0, sizeof(round_keys));
+}
+/*---------------------------------------------------------------------------*/
 const struct aes_128_driver aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  forget_key
 };
 /*---------------------------------------------------------------------------*/
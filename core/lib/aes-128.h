@@ -65,6 +65,12 @@ struct aes_128_driver {
    * \brief Encrypts.
    */
   void (* encrypt)(uint8_t *plaintext_and_result);
+  
+  /**
+   * \brief Erases what the driver keeps of a key, e.g., its round keys.
+   *        set_key has to be called before encrypting again.
+   */
+  void (* forget_key)(uint8_t *key);
 };
 
 /**
@@ -79,4 +85,10 @@ void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
 extern const struct aes_128_driver AES_128;
 
+/**
+ * Table-driven software AES-128, which is faster than aes_128_driver
+ * on 32-bit platforms at the cost of a 1 KB table.
+ */
+extern const struct aes_128_driver aes_128_ttable_driver;
+
 #endif /* AES_H_ */
@@ -54,18 +54,6 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
 }
 /*---------------------------------------------------------------------------*/
 static void
-senddata(struct tcp_socket *s)
-{
-  int len = MIN(s->output_data_max_seg, uip_mss());
-
-  if(s->output_data_len > 0) {
-    len = MIN(s->output_data_len, len);
-    s->output_data_send_nxt = len;
-    uip_send(s->output_data_ptr, len);
-  }
-}
-/*---------------------------------------------------------------------------*/
-static void
 acked(struct tcp_socket *s)
 {
   if(s->output_data_len > 0) {
@@ -89,6 +77,30 @@ acked(struct tcp_socket *s)
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+senddata(struct tcp_socket *s)
+{
+  int len = MIN(s->output_data_max_seg, uip_mss());
+
+  if(s->output_data_len > 0) {
+    len = MIN(s->output_data_len, len);
+    s->output_data_send_nxt = len;
+    uip_send(s->output_data_ptr, len);
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+    /* uIP keeps the data until it is acknowledged, so we can drop it
+       from the output buffer and ask to send more right away. */
+    if(len > 0) {
+      acked(s);
+      if(s->output_data_len > 0) {
+        tcpip_poll_tcp(uip_conn);
+      }
+    }
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
+    return len;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 newdata(struct tcp_socket *s)
 {
@@ -133,6 +145,7 @@ static void
 appcall(void *state)
 {
   struct tcp_socket *s = state;
+  int pending;
 
   if(uip_connected()) {
     /* Check if this connection originated in a local listen
@@ -185,22 +198,30 @@ appcall(void *state)
     return;
   }
 
+#if UIP_TCP_WINDOW_SEGMENTS <= 1
   if(uip_acked()) {
     acked(s);
   }
+#endif /* UIP_TCP_WINDOW_SEGMENTS <= 1 */
   if(uip_newdata()) {
     newdata(s);
   }
 
+  pending = 0;
   if(uip_rexmit() ||
      uip_newdata() ||
      uip_acked()) {
-    senddata(s);
+    pending = senddata(s);
   } else if(uip_poll()) {
-    senddata(s);
+    pending = senddata(s);
   }
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+  /* Data in the send window must be acknowledged before we close. */
+  pending |= uip_outstanding(uip_conn);
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
 
-  if(s->output_data_len == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
+  if(s->output_data_len == 0 && !pending &&
+     s->flags & TCP_SOCKET_FLAGS_CLOSING) {
     s->flags &= ~TCP_SOCKET_FLAGS_CLOSING;
     uip_close();
     tcp_markconn(uip_conn, NULL);
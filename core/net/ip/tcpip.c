@@ -413,7 +413,7 @@ eventhandler(process_event_t ev, process_data_t data)
         for(cptr = &uip_udp_conns[0];
             cptr < &uip_udp_conns[UIP_UDP_CONNS]; ++cptr) {
           if(cptr->appstate.p == p) {
-            cptr->lport = 0;
+            uip_udp_remove(cptr);
           }
         }
       }
@@ -656,10 +656,8 @@ tcpip_ipv6_output(void)
       } else {
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        uip_packetqueue_push(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                             uip_len, UIP_DS6_NBR_PACKET_LIFETIME);
 #endif
       /* RFC4861, 7.2.2:
        * "If the source address of the packet prompting the solicitation is the
@@ -684,10 +682,8 @@ tcpip_ipv6_output(void)
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit and set
            the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        uip_packetqueue_push(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                             uip_len, UIP_DS6_NBR_PACKET_LIFETIME);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_len = 0;
         return;
@@ -702,23 +698,27 @@ tcpip_ipv6_output(void)
       }
 #endif /* UIP_ND6_SEND_NA */
 
-      tcpip_output(uip_ds6_nbr_get_ll(nbr));
-
 #if UIP_CONF_IPV6_QUEUE_PKT
       /*
-       * Send the queued packets from here, may not be 100% perfect though.
-       * This happens in a few cases, for example when instead of receiving a
-       * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
-       * to STALE, and you must both send a NA and the queued packet.
+       * Send the queued packets from here, before the current one, so that
+       * the neighbor gets them in the order they were queued. This happens
+       * in a few cases, for example when instead of receiving a NA after
+       * sending a NS, you receive a NS with SLLAO: the entry moves to
+       * STALE, and you must both send a NA and the queued packets.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-        uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-        memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
-        tcpip_output(uip_ds6_nbr_get_ll(nbr));
+      if(nbr->packethandle.packet != NULL) {
+        uip_packetqueue_append(&nbr->packethandle, (uint8_t *)UIP_IP_BUF,
+                               uip_len, UIP_DS6_NBR_PACKET_LIFETIME);
+        while((uip_len = uip_packetqueue_pop(&nbr->packethandle,
+                                             (uint8_t *)UIP_IP_BUF)) != 0) {
+          tcpip_output(uip_ds6_nbr_get_ll(nbr));
+        }
+        uip_len = 0;
+        return;
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
 
+      tcpip_output(uip_ds6_nbr_get_ll(nbr));
       uip_len = 0;
       return;
     }
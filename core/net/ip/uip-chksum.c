@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum (RFC 1071), and incremental updates of
+ *         checksums when a header field is rewritten (RFC 1624).
+ */
+
+#include "net/ip/uip-chksum.h"
+
+#if UIP_CHKSUM_WORD
+#include <stdint.h>
+#if UIP_CHKSUM_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define CHKSUM_SSE2 1
+#elif UIP_CHKSUM_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define CHKSUM_NEON 1
+#endif
+/* Shorter data, such as a port number, is summed faster bytewise. */
+#define WORD_MIN_LEN 16
+#endif /* UIP_CHKSUM_WORD */
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+add16(uint16_t a, uint16_t b)
+{
+  a += b;
+  return a < b ? a + 1 : a;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+sum_bytes(uint16_t sum, const void *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = dataptr + len - 1;
+
+  while(dataptr < last_byte) {   /* At least two more bytes */
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CHKSUM_WORD
+/*
+ * Sums data that starts at an even address. The data is summed as
+ * 16-bit words in host byte order, in 32-bit words or vectors at a
+ * time, and the carries are collected in a 64-bit accumulator that
+ * cannot overflow for 64 KB of data. The ones' complement sum does
+ * not depend on the byte order, so the result only has to be swapped
+ * in the end (RFC 1071, section 2).
+ */
+static uint16_t
+sum_words(const uint8_t *p, uint16_t len)
+{
+  uint64_t acc;
+  const uint32_t *w;
+  uint8_t last[2];
+
+  acc = 0;
+  if(((uintptr_t)p & 2) && len >= 2) {
+    acc += *(const uint16_t *)p;
+    p += 2;
+    len -= 2;
+  }
+
+#if CHKSUM_SSE2
+  if(len >= 16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    __m128i v;
+    uint32_t lanes[4];
+
+    /* Each 32-bit lane collects two 16-bit words per round, which
+       cannot overflow in 4096 rounds. */
+    do {
+      v = _mm_loadu_si128((const __m128i *)p);
+      sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(v, zero));
+      sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(v, zero));
+      p += 16;
+      len -= 16;
+    } while(len >= 16);
+    _mm_storeu_si128((__m128i *)lanes, sum);
+    acc += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#elif CHKSUM_NEON
+  if(len >= 16) {
+    uint32x4_t sum = vdupq_n_u32(0);
+
+    do {
+      sum = vpadalq_u16(sum, vld1q_u16((const uint16_t *)p));
+      p += 16;
+      len -= 16;
+    } while(len >= 16);
+    acc += (uint64_t)vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1) +
+      vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+  }
+#endif /* CHKSUM_NEON */
+
+  w = (const uint32_t *)p;
+  while(len >= 16) {
+    acc += (uint64_t)w[0] + w[1] + w[2] + w[3];
+    w += 4;
+    len -= 16;
+  }
+  while(len >= 4) {
+    acc += *w++;
+    len -= 4;
+  }
+  p = (const uint8_t *)w;
+  if(len >= 2) {
+    acc += *(const uint16_t *)p;
+    p += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    last[0] = *p;
+    last[1] = 0;
+    acc += *(const uint16_t *)last;
+  }
+
+  /* Fold the carries back in. */
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  return uip_ntohs((uint16_t)acc);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const void *data, uint16_t len)
+{
+  const uint8_t *p = data;
+  uint16_t s;
+
+  if(len < WORD_MIN_LEN) {
+    return sum_bytes(sum, data, len);
+  }
+  if((uintptr_t)p & 1) {
+    /* Sum from the next byte on, which swaps the bytes of the sum,
+       and add the first byte as the high byte of a word. */
+    s = sum_words(p + 1, len - 1);
+    s = add16((s << 8) | (s >> 8), p[0] << 8);
+  } else {
+    s = sum_words(p, len);
+  }
+  return add16(sum, s);
+}
+#else /* UIP_CHKSUM_WORD */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const void *data, uint16_t len)
+{
+  return sum_bytes(sum, data, len);
+}
+#endif /* UIP_CHKSUM_WORD */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_replace(uint16_t chksum, uint16_t old_sum, uint16_t new_sum)
+{
+  uint16_t sum;
+
+  /* HC' = ~(~HC + ~m + m') */
+  sum = add16((uint16_t)~uip_ntohs(chksum), (uint16_t)~old_sum);
+  sum = add16(sum, new_sum);
+  return uip_htons((uint16_t)~sum);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The Internet checksum (RFC 1071), and incremental updates of
+ *         checksums when a header field is rewritten (RFC 1624).
+ */
+
+#ifndef UIP_CHKSUM_H_
+#define UIP_CHKSUM_H_
+
+#include "contiki-conf.h"
+#include "net/ip/uip.h"
+
+/**
+ * \brief      Add data to a ones' complement sum
+ * \param sum  The sum so far, 0 to start a new one
+ * \param data The data, which can start at any address
+ * \param len  The length of the data. An odd length is padded with a zero byte.
+ * \return     The new sum, in host byte order
+ *
+ *             The data is summed as 16-bit words in network byte
+ *             order, so consecutive blocks can only be summed this
+ *             way if all but the last have an even length.
+ */
+uint16_t uip_chksum_add(uint16_t sum, const void *data, uint16_t len);
+
+/**
+ * \brief         Update a checksum after data has been replaced
+ * \param chksum  The checksum field, in network byte order
+ * \param old_sum The uip_chksum_add() sum of the replaced data
+ * \param new_sum The uip_chksum_add() sum of the new data
+ * \return        The new value of the checksum field, in network byte order
+ *
+ *                This uses equation 3 of RFC 1624, which, unlike the
+ *                equation in RFC 1141, also gives the right result when
+ *                the sum is 0xffff. The replaced and the new data must
+ *                start at an even offset in the checksummed data, but
+ *                need not have the same length.
+ */
+uint16_t uip_chksum_replace(uint16_t chksum, uint16_t old_sum, uint16_t new_sum);
+
+/**
+ * \brief   Update a checksum after a 16-bit field has been changed
+ * \param c The checksum field, in network byte order
+ * \param o The old value of the field, in network byte order
+ * \param n The new value of the field, in network byte order
+ */
+#define uip_chksum_replace16(c, o, n) \
+  uip_chksum_replace(c, uip_ntohs(o), uip_ntohs(n))
+
+#endif /* UIP_CHKSUM_H_ */
@@ -1,13 +1,28 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "net/ip/uip.h"
 
-#include "lib/memb.h"
-
 #include "net/ip/uip-packetqueue.h"
 
-#define MAX_NUM_QUEUED_PACKETS 2
-MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
+/* The pool is split into chunks, which hold the packets in chains. */
+#define CHUNK_SIZE 32
+#define CHUNKS     (UIP_QUEUE_PKT_BUDGET / CHUNK_SIZE)
+#define NO_CHUNK   0xff
+
+#if CHUNKS >= NO_CHUNK
+#error UIP_CONF_IPV6_QUEUE_PKT_BUDGET must be less than 255 * 32 bytes
+#endif /* CHUNKS >= NO_CHUNK */
+
+static struct uip_packetqueue_packet packets[UIP_QUEUE_PKT_MAX];
+static uint16_t serial;
+
+static uint8_t pool[CHUNKS][CHUNK_SIZE];
+/* The next chunk of a packet, or of the free chunks */
+static uint8_t chunk_next[CHUNKS];
+static uint8_t free_chunk;
+static uint8_t free_chunks;
+static uint8_t initialized;
 
 #define DEBUG 0
 #if DEBUG
@@ -19,68 +34,186 @@ MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
 
 /*---------------------------------------------------------------------------*/
 static void
-packet_timedout(void *ptr)
+init(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < CHUNKS; i++) {
+    chunk_next[i] = i + 1 < CHUNKS ? i + 1 : NO_CHUNK;
+  }
+  free_chunk = CHUNKS > 0 ? 0 : NO_CHUNK;
+  free_chunks = CHUNKS;
+  initialized = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Give the chunks of a packet back to the pool. */
+static void
+packet_release(struct uip_packetqueue_packet *p)
+{
+  uint8_t c, next;
+
+  for(c = p->chunk; c != NO_CHUNK; c = next) {
+    next = chunk_next[c];
+    chunk_next[c] = free_chunk;
+    free_chunk = c;
+    free_chunks++;
+  }
+  p->handle = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Take a packet out of its queue and give its chunks back to the pool. */
+static void
+packet_free(struct uip_packetqueue_packet *p)
+{
+  struct uip_packetqueue_packet **pp;
+
+  for(pp = &p->handle->packet; *pp != p; pp = &(*pp)->next);
+  *pp = p->next;
+  packet_release(p);
+}
+/*---------------------------------------------------------------------------*/
+static void
+expire(void)
 {
-  struct uip_packetqueue_handle *h = ptr;
+  uint8_t i;
 
-  PRINTF("uip_packetqueue_free timed out %p\n", h);
-  memb_free(&packets_memb, h->packet);
-  h->packet = NULL;
+  for(i = 0; i < UIP_QUEUE_PKT_MAX; i++) {
+    if(packets[i].handle != NULL && timer_expired(&packets[i].lifetimer)) {
+      PRINTF("uip_packetqueue packet timed out %p\n", packets[i].handle);
+      UIP_STAT(++uip_stat.nd6queue.timeout);
+      packet_free(&packets[i]);
+    }
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
 uip_packetqueue_new(struct uip_packetqueue_handle *handle)
 {
+  uint8_t i;
+
   PRINTF("uip_packetqueue_new %p\n", handle);
+  /* The handle may be reused without having been freed, e.g. when a
+     neighbor entry is taken over by another neighbor. */
+  for(i = 0; i < UIP_QUEUE_PKT_MAX; i++) {
+    if(packets[i].handle == handle) {
+      UIP_STAT(++uip_stat.nd6queue.drop);
+      packet_release(&packets[i]);
+    }
+  }
   handle->packet = NULL;
 }
 /*---------------------------------------------------------------------------*/
-struct uip_packetqueue_packet *
-uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
+/* Queue a copy of a packet, unless the handle has max packets queued. */
+static int
+push(struct uip_packetqueue_handle *handle, const uint8_t *data,
+     uint16_t len, clock_time_t lifetime, uint8_t max)
 {
-  PRINTF("uip_packetqueue_alloc %p\n", handle);
-  if(handle->packet != NULL) {
-    PRINTF("alloced\n");
-    return NULL;
+  struct uip_packetqueue_packet *p, *oldest, **pp;
+  uint8_t need, count, i, *c;
+  uint16_t n;
+
+  PRINTF("uip_packetqueue_push %p len %u\n", handle, len);
+  if(!initialized) {
+    init();
+  }
+  expire();
+
+  count = 0;
+  for(p = handle->packet; p != NULL; p = p->next) {
+    count++;
+  }
+  need = (len + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if(len == 0 || count >= max || need > CHUNKS) {
+    PRINTF("uip_packetqueue_push failed\n");
+    UIP_STAT(++uip_stat.nd6queue.drop);
+    return 0;
+  }
+
+  /* Make room by discarding the packets that were queued first. */
+  for(;;) {
+    p = NULL;
+    oldest = NULL;
+    for(i = 0; i < UIP_QUEUE_PKT_MAX; i++) {
+      if(packets[i].handle == NULL) {
+        p = &packets[i];
+      } else if(oldest == NULL ||
+                (uint16_t)(serial - packets[i].serial) >
+                (uint16_t)(serial - oldest->serial)) {
+        oldest = &packets[i];
+      }
+    }
+    if(p != NULL && free_chunks >= need) {
+      break;
+    }
+    PRINTF("uip_packetqueue discarding packet of %p\n", oldest->handle);
+    UIP_STAT(++uip_stat.nd6queue.evicted);
+    packet_free(oldest);
   }
-  handle->packet = memb_alloc(&packets_memb);
-  if(handle->packet != NULL) {
-    ctimer_set(&handle->packet->lifetimer, lifetime,
-               packet_timedout, handle);
-  } else {
-    PRINTF("uip_packetqueue_alloc failed\n");
+
+  p->handle = handle;
+  p->next = NULL;
+  p->len = len;
+  p->serial = ++serial;
+  timer_set(&p->lifetimer, lifetime);
+  c = &p->chunk;
+  for(; len > 0; len -= n, data += n) {
+    n = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+    *c = free_chunk;
+    free_chunk = chunk_next[free_chunk];
+    free_chunks--;
+    memcpy(pool[*c], data, n);
+    c = &chunk_next[*c];
   }
-  return handle->packet;
+  *c = NO_CHUNK;
+  for(pp = &handle->packet; *pp != NULL; pp = &(*pp)->next);
+  *pp = p;
+  UIP_STAT(++uip_stat.nd6queue.queued);
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
-void
-uip_packetqueue_free(struct uip_packetqueue_handle *handle)
+int
+uip_packetqueue_push(struct uip_packetqueue_handle *handle,
+                     const uint8_t *data, uint16_t len, clock_time_t lifetime)
 {
-  PRINTF("uip_packetqueue_free %p\n", handle);
-  if(handle->packet != NULL) {
-    ctimer_stop(&handle->packet->lifetimer);
-    memb_free(&packets_memb, handle->packet);
-    handle->packet = NULL;
-  }
+  return push(handle, data, len, lifetime, UIP_QUEUE_PKT_NBR);
 }
 /*---------------------------------------------------------------------------*/
-uint8_t *
-uip_packetqueue_buf(struct uip_packetqueue_handle *h)
+int
+uip_packetqueue_append(struct uip_packetqueue_handle *handle,
+                       const uint8_t *data, uint16_t len, clock_time_t lifetime)
 {
-  return h->packet != NULL? h->packet->queue_buf: NULL;
+  return push(handle, data, len, lifetime, UIP_QUEUE_PKT_MAX);
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
-uip_packetqueue_buflen(struct uip_packetqueue_handle *h)
+uip_packetqueue_pop(struct uip_packetqueue_handle *handle, uint8_t *buf)
 {
-  return h->packet != NULL? h->packet->queue_buf_len: 0;
+  struct uip_packetqueue_packet *p;
+  uint16_t len, n, i;
+  uint8_t c;
+
+  expire();
+  p = handle->packet;
+  if(p == NULL) {
+    return 0;
+  }
+  PRINTF("uip_packetqueue_pop %p len %u\n", handle, p->len);
+  len = p->len;
+  for(i = 0, c = p->chunk; i < len; i += n, c = chunk_next[c]) {
+    n = len - i < CHUNK_SIZE ? len - i : CHUNK_SIZE;
+    memcpy(&buf[i], pool[c], n);
+  }
+  packet_free(p);
+  return len;
 }
 /*---------------------------------------------------------------------------*/
 void
-uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len)
+uip_packetqueue_free(struct uip_packetqueue_handle *handle)
 {
-  if(h->packet != NULL) {
-    h->packet->queue_buf_len = len;
+  PRINTF("uip_packetqueue_free %p\n", handle);
+  while(handle->packet != NULL) {
+    UIP_STAT(++uip_stat.nd6queue.drop);
+    packet_free(handle->packet);
   }
 }
 /*---------------------------------------------------------------------------*/
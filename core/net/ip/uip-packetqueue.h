@@ -1,35 +1,74 @@
 #ifndef UIP_PACKETQUEUE_H
 #define UIP_PACKETQUEUE_H
 
-#include "sys/ctimer.h"
+#include "sys/timer.h"
+
+/*
+ * Packets waiting for the link-layer address of their next hop. The
+ * packets of all neighbors share a pool of UIP_QUEUE_PKT_BUDGET bytes
+ * and UIP_QUEUE_PKT_MAX packets. A neighbor holds at most
+ * UIP_QUEUE_PKT_NBR packets, which are sent in the order they were
+ * queued. When the pool is full, the packet that was queued first is
+ * discarded to make room for a new one.
+ */
 
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
-  struct uip_ds6_queued_packet *next;
-  uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
-  uint16_t queue_buf_len;
-  struct ctimer lifetimer;
+  /* The next packet queued for the same handle */
+  struct uip_packetqueue_packet *next;
+  /* The handle of the packet, NULL if the entry is free */
   struct uip_packetqueue_handle *handle;
+  struct timer lifetimer;
+  uint16_t len;
+  /* The order in which the packets were queued */
+  uint16_t serial;
+  /* The first chunk of the pool that holds the packet */
+  uint8_t chunk;
 };
 
 struct uip_packetqueue_handle {
+  /* The packet that was queued first */
   struct uip_packetqueue_packet *packet;
 };
 
 void uip_packetqueue_new(struct uip_packetqueue_handle *handle);
 
+/**
+ * \brief Queue a copy of a packet
+ * \param handle The queue of the neighbor the packet is for
+ * \param data The packet, starting with its IP header
+ * \param len The length of the packet
+ * \param lifetime The time after which the packet is discarded
+ * \return Non-zero if the packet was queued
+ */
+int uip_packetqueue_push(struct uip_packetqueue_handle *handle,
+                         const uint8_t *data, uint16_t len,
+                         clock_time_t lifetime);
 
-struct uip_packetqueue_packet *
-uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime);
-
-
-void
-uip_packetqueue_free(struct uip_packetqueue_handle *handle);
+/**
+ * \brief Queue a copy of a packet behind the packets of a queue that is
+ *        about to be emptied, regardless of UIP_QUEUE_PKT_NBR
+ * \param handle The queue of the neighbor the packet is for
+ * \param data The packet, starting with its IP header
+ * \param len The length of the packet
+ * \param lifetime The time after which the packet is discarded
+ * \return Non-zero if the packet was queued
+ */
+int uip_packetqueue_append(struct uip_packetqueue_handle *handle,
+                           const uint8_t *data, uint16_t len,
+                           clock_time_t lifetime);
 
-uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
-uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
-void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
+/**
+ * \brief Take the packet that was queued first out of a queue
+ * \param handle The queue
+ * \param buf The buffer the packet is copied to
+ * \return The length of the packet, zero if the queue is empty
+ */
+uint16_t uip_packetqueue_pop(struct uip_packetqueue_handle *handle,
+                             uint8_t *buf);
 
+/** \brief Discard the packets of a queue */
+void uip_packetqueue_free(struct uip_packetqueue_handle *handle);
 
 #endif /* UIP_PACKETQUEUE_H */
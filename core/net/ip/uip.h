@@ -485,7 +485,7 @@ void uip_setipid(uint16_t id);
     uip_process(UIP_UDP_TIMER); } while(0)
 #endif /* UIP_UDP */
 
-/** \brief Abandon the reassembly of the current packet */
+/** \brief Abandon the reassembly of a packet that has timed out */
 void uip_reass_over(void);
 
 /**
@@ -633,6 +633,9 @@ struct uip_conn *uip_connect(uip_ipaddr_t *ripaddr, uint16_t port);
  * application will be invoked with the uip_rexmit() event being
  * set. The application will then have to resend the data using this
  * function.
+ * With UIP_CONF_TCP_WINDOW_SEGMENTS larger than 1, uIP IPv6 keeps a
+ * copy of the data and retransmits it without calling the
+ * application.
  *
  * \param data A pointer to the data which is to be sent.
  *
@@ -877,7 +880,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH_SIZE
+#define uip_udp_remove(conn) uip_udp_set_lport(conn, 0)
+#else /* UIP_CONN_HASH_SIZE */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_CONN_HASH_SIZE */
 
 /**
  * Bind a UDP connection to a local port.
@@ -889,7 +896,23 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH_SIZE
+#define uip_udp_bind(conn, port) uip_udp_set_lport(conn, port)
+#else /* UIP_CONN_HASH_SIZE */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_CONN_HASH_SIZE */
+
+/**
+ * Change the local port of a UDP connection and update the
+ * connection index, see UIP_CONF_CONN_HASH_SIZE.
+ *
+ * \param conn A pointer to the uip_udp_conn structure for the
+ * connection.
+ *
+ * \param port The local port number, in network byte order, or 0 to
+ * remove the connection.
+ */
+void uip_udp_set_lport(struct uip_udp_conn *conn, uint16_t port);
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1504,6 +1527,26 @@ struct uip_stats {
     uip_stats_t recv;     /**< Number of recived ND6 packets */
     uip_stats_t sent;     /**< Number of sent ND6 packets */
   } nd6;
+  struct {
+    uip_stats_t recv;        /**< Number of received fragments. */
+    uip_stats_t reassembled; /**< Number of reassembled datagrams. */
+    uip_stats_t timeout;     /**< Number of datagrams that timed out
+                                  before being reassembled. */
+    uip_stats_t evicted;     /**< Number of datagrams discarded to
+                                  reassemble a newer one. */
+    uip_stats_t drop;        /**< Number of dropped fragments. */
+  } frag;                    /**< IPv6 reassembly statistics. */
+  struct {
+    uip_stats_t queued;      /**< Number of packets queued during
+                                  address resolution. */
+    uip_stats_t evicted;     /**< Number of queued packets discarded
+                                  to queue newer ones. */
+    uip_stats_t timeout;     /**< Number of queued packets that timed
+                                  out. */
+    uip_stats_t drop;        /**< Number of packets that could not be
+                                  queued, or whose %neighbor was
+                                  removed. */
+  } nd6queue;                /**< Address resolution queue statistics. */
 #endif /*NETSTACK_CONF_WITH_IPV6*/
 };
 
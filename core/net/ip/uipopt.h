@@ -292,6 +292,38 @@ void uip_log(char *msg);
 #define UIP_CONF_IPV6_QUEUE_PKT       0
 #endif
 
+/**
+ * Number of packets that can be queued for a %neighbor during address
+ * resolution (default: 1)
+ */
+#ifdef UIP_CONF_IPV6_QUEUE_PKT_NBR
+#define UIP_QUEUE_PKT_NBR (UIP_CONF_IPV6_QUEUE_PKT_NBR)
+#else
+#define UIP_QUEUE_PKT_NBR 1
+#endif
+
+/**
+ * Number of packets that can be queued for all neighbors together
+ * (default: 2)
+ */
+#ifdef UIP_CONF_IPV6_QUEUE_PKT_MAX
+#define UIP_QUEUE_PKT_MAX (UIP_CONF_IPV6_QUEUE_PKT_MAX)
+#else
+#define UIP_QUEUE_PKT_MAX 2
+#endif
+
+/**
+ * Number of bytes shared by the queued packets. When it or
+ * UIP_QUEUE_PKT_MAX is used up, the packet that was queued first is
+ * discarded. The default lets every packet have UIP_BUFSIZE bytes.
+ */
+#ifdef UIP_CONF_IPV6_QUEUE_PKT_BUDGET
+#define UIP_QUEUE_PKT_BUDGET (UIP_CONF_IPV6_QUEUE_PKT_BUDGET)
+#else
+#define UIP_QUEUE_PKT_BUDGET (UIP_QUEUE_PKT_MAX * \
+                              ((UIP_BUFSIZE - UIP_LLH_LEN + 31) / 32 * 32))
+#endif
+
 #ifndef UIP_CONF_IPV6_CHECKS
 /** Do we do IPv6 consistency checks (highly recommended, default: yes) */
 #define UIP_CONF_IPV6_CHECKS          1
@@ -302,6 +334,30 @@ void uip_log(char *msg);
 #define UIP_CONF_IPV6_REASSEMBLY      0
 #endif
 
+/**
+ * Number of IPv6 datagrams that can be reassembled at the same time
+ * (default: 1). Fragments are matched to a datagram by their source
+ * address, destination address and identification.
+ */
+#ifdef UIP_CONF_IPV6_REASS_CONTEXTS
+#define UIP_REASS_CONTEXTS (UIP_CONF_IPV6_REASS_CONTEXTS)
+#else
+#define UIP_REASS_CONTEXTS 1
+#endif
+
+/**
+ * Number of bytes shared by the datagrams being reassembled, taken in
+ * 64-byte chunks as their fragments arrive. When it is used up, the
+ * oldest datagram being reassembled is discarded. The default lets
+ * every context hold a datagram of UIP_BUFSIZE bytes.
+ */
+#ifdef UIP_CONF_IPV6_REASS_BUDGET
+#define UIP_REASS_BUDGET (UIP_CONF_IPV6_REASS_BUDGET)
+#else
+#define UIP_REASS_BUDGET (UIP_REASS_CONTEXTS * \
+                          ((UIP_BUFSIZE - UIP_LLH_LEN + 63) / 64 * 64))
+#endif
+
 #ifndef UIP_CONF_NETIF_MAX_ADDRESSES
 /** Default number of IPv6 addresses associated to the node's interface */
 #define UIP_CONF_NETIF_MAX_ADDRESSES  3
@@ -365,6 +421,26 @@ void uip_log(char *msg);
 #define UIP_UDP_CONNS    10
 #endif /* UIP_CONF_UDP_CONNS */
 
+/**
+ * The number of buckets in the port-keyed index of the UDP and TCP
+ * connection tables.
+ *
+ * By default, uIP finds the connection of an incoming packet by
+ * scanning uip_udp_conns[] or uip_conns[]. With a non-zero value,
+ * which must be a power of two, the IPv6 stack keeps the connections
+ * hashed on their ports and only looks at one bucket, which pays off
+ * when there are many connections. The index costs one or two bytes
+ * per bucket and connection. UDP ports must then only be changed
+ * through uip_udp_new(), uip_udp_bind() and uip_udp_remove().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH_SIZE
+#define UIP_CONN_HASH_SIZE (UIP_CONF_CONN_HASH_SIZE)
+#else /* UIP_CONF_CONN_HASH_SIZE */
+#define UIP_CONN_HASH_SIZE 0
+#endif /* UIP_CONF_CONN_HASH_SIZE */
+
 /**
  * The name of the function that should be called when UDP datagrams arrive.
  *
@@ -500,6 +576,37 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of TCP segments that a connection can have in flight.
+ *
+ * With the default of 1, a connection sends new data only when all
+ * data it sent before has been acknowledged, and the application has
+ * to retransmit lost data when it is called with uip_rexmit() set.
+ * With a larger value, uIP copies the data that the application sends
+ * into a per-connection retransmission buffer and retransmits it by
+ * itself, so that the application can send a new segment whenever
+ * uip_mss() is not zero. Only the IPv6 stack supports this.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_SEGMENTS
+#define UIP_TCP_WINDOW_SEGMENTS (UIP_CONF_TCP_WINDOW_SEGMENTS)
+#else
+#define UIP_TCP_WINDOW_SEGMENTS 1
+#endif
+
+/**
+ * The size of the retransmission buffer of each TCP connection, when
+ * UIP_TCP_WINDOW_SEGMENTS is larger than 1.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_BUFSIZE
+#define UIP_TCP_WINDOW_BUFSIZE (UIP_CONF_TCP_WINDOW_BUFSIZE)
+#else
+#define UIP_TCP_WINDOW_BUFSIZE (UIP_TCP_WINDOW_SEGMENTS * UIP_TCP_MSS)
+#endif
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -570,6 +677,16 @@ void uip_log(char *msg);
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of datagrams that can be reassembled at the same time at the
+ * 6lowpan layer. Each needs a buffer of UIP_BUFSIZE bytes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -591,6 +708,34 @@ void uip_log(char *msg);
 #define SICSLOWPAN_CONF_FRAG  0
 #endif
 
+/**
+ * Do we send the fragments after the first one as references into
+ * uip_buf instead of copying their payload into the packetbuf
+ * (default: no)
+ */
+#ifndef SICSLOWPAN_CONF_FRAG_REFERENCE
+#define SICSLOWPAN_CONF_FRAG_REFERENCE 0
+#endif
+
+/**
+ * Do we forward the fragments of datagrams that are not for us as
+ * they arrive instead of reassembling the datagrams first (default:
+ * no). Only used by routers.
+ */
+#ifndef SICSLOWPAN_CONF_FRAG_FORWARD
+#define SICSLOWPAN_CONF_FRAG_FORWARD 0
+#endif
+
+/**
+ * Number of datagrams whose fragments can be forwarded at the same
+ * time. Each entry keeps the datagram tag, size and next hop only.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES
+#define SICSLOWPAN_FRAG_FORWARD_ENTRIES (SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES)
+#else
+#define SICSLOWPAN_FRAG_FORWARD_ENTRIES 4
+#endif
+
 /** @} */
 
 /*------------------------------------------------------------------------------*/
@@ -619,6 +764,36 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum a word at a time.
+ *
+ * By default, the checksum is summed two bytes at a time, which suits
+ * 8- and 16-bit CPUs. On 32- and 64-bit CPUs, setting this option
+ * sums 32-bit words into a 64-bit accumulator instead.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_WORD
+#define UIP_CHKSUM_WORD (UIP_CONF_CHKSUM_WORD)
+#else /* UIP_CONF_CHKSUM_WORD */
+#define UIP_CHKSUM_WORD 0
+#endif /* UIP_CONF_CHKSUM_WORD */
+
+/**
+ * Use SSE2 or NEON instructions for the word-at-a-time checksum.
+ *
+ * This only has an effect together with UIP_CONF_CHKSUM_WORD, and
+ * when the compiler targets a CPU with SSE2 (__SSE2__) or NEON
+ * (__ARM_NEON).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_SIMD
+#define UIP_CHKSUM_SIMD (UIP_CONF_CHKSUM_SIMD)
+#else /* UIP_CONF_CHKSUM_SIMD */
+#define UIP_CHKSUM_SIMD 0
+#endif /* UIP_CONF_CHKSUM_SIMD */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -61,6 +61,7 @@
 
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
+#include "net/ip/uip-chksum.h"
 
 #include "net/ip/uip-debug.h"
 
@@ -265,42 +266,11 @@ ip64_set_ipv6_address(const uip_ip6addr_t *addr)
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
-static uint16_t
 ipv4_checksum(struct ipv4_hdr *hdr)
 {
   uint16_t sum;
 
-  sum = chksum(0, (uint8_t *)hdr, IPV4_HDRLEN);
+  sum = uip_chksum_add(0, (uint8_t *)hdr, IPV4_HDRLEN);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
@@ -319,14 +289,14 @@ ipv4_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
     /* IP protocol and length fields. This addition cannot carry. */
     sum = transport_layer_len + proto;
     /* Sum IP source and destination addresses. */
-    sum = chksum(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+    sum = uip_chksum_add(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
   } else {
     /* ping replies' checksums are calculated over the icmp-part only */
     sum = 0;
   }
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV4_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV4_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -345,11 +315,11 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = transport_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
-  sum = chksum(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV6_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV6_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -365,6 +335,7 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv6len, ipv4len;
+  uint16_t old_sum, new_sum;
   struct ip64_addrmap_entry *m;
   
   v6hdr = (struct ipv6_hdr *)ipv6packet;
@@ -420,27 +391,11 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   case IP_PROTO_TCP:
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
-
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
-    }
-
     break;
 
   case IP_PROTO_UDP:
     PRINTF("ip64_6to4: UDP header\n");
     v4hdr->proto = IP_PROTO_UDP;
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
-    }
     break;
 
   case IP_PROTO_ICMPV6:
@@ -494,10 +449,17 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   }
   ip64_addr_copy4(&v4hdr->srcipaddr, &ip64_hostaddr);
 
+  /* The TCP and UDP checksums cover the IP addresses and the port
+     numbers that we translate, but nothing else that changes, so we
+     update them incrementally (RFC 1624). Unlike a recomputation, this
+     keeps the checksum of a corrupted packet bad. Here we sum the old
+     addresses and source port. */
+  old_sum = uip_chksum_add(0, &v6hdr->srcipaddr, 2 * sizeof(uip_ip6addr_t));
+  old_sum = uip_chksum_add(old_sum, &udphdr->srcport, sizeof(uint16_t));
 
   /* Next we update the transport layer header. This must be updated
      in two ways: the source port number is changed and the transport
-     layer checksum must be recomputed. The reason why we change the
+     layer checksum must be updated. The reason why we change the
      source port number is so that we can remember what IPv6 address
      this packet came from, in case the packet will result in a reply
      from the host on the IPv4 network. If a reply would be sent, it
@@ -595,16 +557,21 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   /* The checksum is in different places in the different protocol
      headers, so we need to be sure that we update the correct
      field. */
+  new_sum = uip_chksum_add(0, &v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+  new_sum = uip_chksum_add(new_sum, &udphdr->srcport, sizeof(uint16_t));
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_TCP));
+    tcphdr->tcpchksum = uip_chksum_replace(tcphdr->tcpchksum,
+                                           old_sum, new_sum);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(udphdr->udpchksum == 0) {
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+                                                    IP_PROTO_UDP));
+    } else {
+      udphdr->udpchksum = uip_chksum_replace(udphdr->udpchksum,
+                                             old_sum, new_sum);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -636,6 +603,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
+  uint16_t old_sum, new_sum;
   struct ip64_addrmap_entry *m;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
@@ -668,6 +636,11 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   icmpv4hdr = (struct icmpv4_hdr *)&ipv4packet[IPV4_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV6_HDRLEN];
 
+  /* As in ip64_6to4(), the TCP and UDP checksums are updated for the
+     translated addresses and destination port. */
+  old_sum = uip_chksum_add(0, &v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+  old_sum = uip_chksum_add(old_sum, &udphdr->destport, sizeof(uint16_t));
+
   ipv6len = ipv4len - IPV4_HDRLEN + IPV6_HDRLEN;
   ipv6_packet_len = ipv6len - IPV6_HDRLEN;
 
@@ -815,18 +788,24 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   /* The checksum is in different places in the different protocol
      headers, so we need to be sure that we update the correct
      field. */
+  new_sum = uip_chksum_add(0, &v6hdr->srcipaddr, 2 * sizeof(uip_ip6addr_t));
+  new_sum = uip_chksum_add(new_sum, &udphdr->destport, sizeof(uint16_t));
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_TCP));
+    tcphdr->tcpchksum = uip_chksum_replace(tcphdr->tcpchksum,
+                                           old_sum, new_sum);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(udphdr->udpchksum == 0) {
+      /* The IPv4 sender did not compute a checksum, but it is
+         mandatory in IPv6. */
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                                                    ipv6len,
+                                                    IP_PROTO_UDP));
+    } else {
+      udphdr->udpchksum = uip_chksum_replace(udphdr->udpchksum,
+                                             old_sum, new_sum);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
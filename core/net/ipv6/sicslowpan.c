@@ -68,6 +68,9 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #include <stdio.h>
 
@@ -221,35 +224,89 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
-
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * The buffer the received packet is uncompressed in: the buffer of a
+ * reassembly context for fragments, uip_buf otherwise.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+static uint8_t *sicslowpan_buf;
+
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+/** The number of 8-byte blocks in a reassembly buffer */
+#define REASS_BLOCKS ((UIP_BUFSIZE - UIP_LLH_LEN + 7) / 8)
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * A datagram being reassembled. Fragments belong to it if they have
+ * the same link-layer sender, datagram tag and datagram size.
  */
-static uint16_t processed_ip_in_len;
+struct reass_context {
+  /**
+   * The buffer used for the 6lowpan reassembly.
+   * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
+   * It has a fix size as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+  /** The 8-byte blocks of the datagram received so far. */
+  uint8_t received[(REASS_BLOCKS + 7) / 8];
+  /** The number of blocks set in received. */
+  uint16_t blocks;
+  /** The datagram size, zero if the context is not in use. */
+  uint16_t size;
+  uint16_t tag;
+  linkaddr_t sender;
+  /** The order in which the contexts were started. Unlike the timer,
+      this tells contexts apart that were started in the same tick. */
+  uint16_t serial;
+  /** Reassembly %timer. */
+  struct timer timer;
+};
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
+/**
+ * A reassembled datagram keeps its context until the context is
+ * needed or times out, so that late duplicates of its fragments are
+ * recognized and dropped.
+ */
+#define REASS_DONE(r) ((r)->blocks == ((r)->size + 7) >> 3)
+
+static struct reass_context reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
+static uint16_t reass_serial;
+
+#if UIP_STATISTICS == 1
+struct sicslowpan_stats sicslowpan_stats;
+#endif /* UIP_STATISTICS == 1 */
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+/** Fragment forwarding is only done by routers. */
+#define SICSLOWPAN_FRAG_FORWARD (SICSLOWPAN_CONF_FRAG_FORWARD && UIP_CONF_ROUTER)
+
+#if SICSLOWPAN_FRAG_FORWARD
+/**
+ * A datagram whose fragments are forwarded as they arrive instead of
+ * being reassembled. Its first fragment sets the entry up, the
+ * following ones are matched like in reassembly and sent to the same
+ * next hop with the tag the first one was sent with.
+ */
+struct frag_forward {
+  /** The datagram size, zero if the entry is not in use. */
+  uint16_t size;
+  uint16_t tag;
+  linkaddr_t sender;
+  /** The datagram tag of the fragments we send. */
+  uint16_t out_tag;
+  /** The link layer next hop, linkaddr_null to drop the fragments. */
+  linkaddr_t next_hop;
+  struct timer timer;
+};
 
-/** When reassembling, the source address of the fragments being merged */
-linkaddr_t frag_sender;
+static struct frag_forward frag_forwards[SICSLOWPAN_FRAG_FORWARD_ENTRIES];
+#endif /* SICSLOWPAN_FRAG_FORWARD */
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+#if SICSLOWPAN_CONF_FRAG_REFERENCE
+/** The packetbuf attributes of the packet being fragmented, restored
+    for each fragment that references uip_buf. */
+static struct packetbuf_attr frag_attrs[PACKETBUF_NUM_ATTRS];
+static struct packetbuf_addr frag_addrs[PACKETBUF_NUM_ADDRS];
+#endif /* SICSLOWPAN_CONF_FRAG_REFERENCE */
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -1350,6 +1407,55 @@ send_packet(linkaddr_t *dest)
   watchdog_periodic();
 }
 /*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the header of the IP packet in uip_buf into packetbuf
+ * \param dest The link layer destination address of the packet
+ */
+static void
+compress_hdr(linkaddr_t *dest)
+{
+  if(uip_len >= COMPRESSION_THRESHOLD) {
+    /* Try to compress the headers */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
+    compress_hdr_hc1(dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+    compress_hdr_ipv6(dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+    compress_hdr_hc06(dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+  } else {
+    compress_hdr_ipv6(dest);
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief The room left for 6lowpan headers and payload in a frame
+ * \param dest The link layer destination address of the frame
+ */
+static int
+max_payload_len(linkaddr_t *dest)
+{
+  int framer_hdrlen;
+
+  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
+   * We calculate it here only to make a better decision of whether the outgoing packet
+   * needs to be fragmented or not. */
+#define USE_FRAMER_HDRLEN 1
+#if USE_FRAMER_HDRLEN
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    /* Framing failed, we assume the maximum header length */
+    framer_hdrlen = 21;
+  }
+#else /* USE_FRAMER_HDRLEN */
+  framer_hdrlen = 21;
+#endif /* USE_FRAMER_HDRLEN */
+  return MAC_MAX_PAYLOAD - framer_hdrlen - NETSTACK_LLSEC.get_overhead();
+}
+/*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
  *  \param localdest The MAC address of the destination
@@ -1362,7 +1468,6 @@ send_packet(linkaddr_t *dest)
 static uint8_t
 output(const uip_lladdr_t *localdest)
 {
-  int framer_hdrlen;
   int max_payload;
 
   /* The MAC address of the destination of the packet */
@@ -1416,41 +1521,20 @@ output(const uip_lladdr_t *localdest)
   
   PRINTFO("sicslowpan output: sending packet len %d\n", uip_len);
 
-  if(uip_len >= COMPRESSION_THRESHOLD) {
-    /* Try to compress the headers */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
-    compress_hdr_hc1(&dest);
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
-    compress_hdr_ipv6(&dest);
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
-    compress_hdr_hc06(&dest);
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
-  } else {
-    compress_hdr_ipv6(&dest);
-  }
+  compress_hdr(&dest);
   PRINTFO("sicslowpan output: header of len %d\n", packetbuf_hdr_len);
 
-  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
-   * We calculate it here only to make a better decision of whether the outgoing packet
-   * needs to be fragmented or not. */
-#define USE_FRAMER_HDRLEN 1
-#if USE_FRAMER_HDRLEN
-  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
-  framer_hdrlen = NETSTACK_FRAMER.length();
-  if(framer_hdrlen < 0) {
-    /* Framing failed, we assume the maximum header length */
-    framer_hdrlen = 21;
-  }
-#else /* USE_FRAMER_HDRLEN */
-  framer_hdrlen = 21;
-#endif /* USE_FRAMER_HDRLEN */
-  max_payload = MAC_MAX_PAYLOAD - framer_hdrlen - NETSTACK_LLSEC.get_overhead();
+  max_payload = max_payload_len(&dest);
 
   if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_CONF_FRAG_REFERENCE
+    uint8_t *frag_ptr;
+    uint8_t frag_saved[SICSLOWPAN_FRAGN_HDR_LEN];
+    uint16_t frag_tag;
+#else /* SICSLOWPAN_CONF_FRAG_REFERENCE */
     struct queuebuf *q;
+#endif /* SICSLOWPAN_CONF_FRAG_REFERENCE */
     /*
      * The outbound IPv6 packet is too large to fit into a single 15.4
      * packet, so we fragment it into multiple packets and send them.
@@ -1484,6 +1568,9 @@ output(const uip_lladdr_t *localdest)
           ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
 /*     PACKETBUF_FRAG_BUF->tag = uip_htons(my_tag); */
     SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, my_tag);
+#if SICSLOWPAN_CONF_FRAG_REFERENCE
+    frag_tag = my_tag;
+#endif /* SICSLOWPAN_CONF_FRAG_REFERENCE */
     my_tag++;
 
     /* Copy payload and send */
@@ -1493,6 +1580,14 @@ output(const uip_lladdr_t *localdest)
     memcpy(packetbuf_ptr + packetbuf_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
     packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
+    /* Tell the receiver that more fragments follow */
+    packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
+#if SICSLOWPAN_CONF_FRAG_REFERENCE
+    /* The following fragments are built from scratch, so only the
+       attributes need to survive the MAC layer. */
+    packetbuf_attr_copyto(frag_attrs, frag_addrs);
+    send_packet(&dest);
+#else /* SICSLOWPAN_CONF_FRAG_REFERENCE */
     q = queuebuf_new_from_packetbuf();
     if(q == NULL) {
       PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
@@ -1502,6 +1597,7 @@ output(const uip_lladdr_t *localdest)
     queuebuf_to_packetbuf(q);
     queuebuf_free(q);
     q = NULL;
+#endif /* SICSLOWPAN_CONF_FRAG_REFERENCE */
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1536,9 +1632,34 @@ output(const uip_lladdr_t *localdest)
       }
       PRINTFO("(offset %d, len %d, tag %d)\n",
              processed_ip_out_len >> 3, packetbuf_payload_len, my_tag);
+#if SICSLOWPAN_CONF_FRAG_REFERENCE
+      /*
+       * Write the FRAGN header into uip_buf, right before the payload
+       * of this fragment, and let the packetbuf reference it there.
+       * The MAC layer copies the fragment before send() returns (when
+       * compacting the packetbuf to frame or queue it), after which
+       * the overwritten bytes of uip_buf are restored.
+       */
+      frag_ptr = (uint8_t *)UIP_IP_BUF + processed_ip_out_len -
+        SICSLOWPAN_FRAGN_HDR_LEN;
+      memcpy(frag_saved, frag_ptr, SICSLOWPAN_FRAGN_HDR_LEN);
+      SET16(frag_ptr, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(frag_ptr, PACKETBUF_FRAG_TAG, frag_tag);
+      frag_ptr[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
+      packetbuf_reference(frag_ptr,
+                          packetbuf_payload_len + SICSLOWPAN_FRAGN_HDR_LEN);
+      packetbuf_attr_copyfrom(frag_attrs, frag_addrs);
+      packetbuf_set_attr(PACKETBUF_ATTR_PENDING,
+                         processed_ip_out_len + packetbuf_payload_len < uip_len);
+      send_packet(&dest);
+      memcpy(frag_ptr, frag_saved, SICSLOWPAN_FRAGN_HDR_LEN);
+#else /* SICSLOWPAN_CONF_FRAG_REFERENCE */
       memcpy(packetbuf_ptr + packetbuf_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, packetbuf_payload_len);
       packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
+      packetbuf_set_attr(PACKETBUF_ATTR_PENDING,
+                         processed_ip_out_len + packetbuf_payload_len < uip_len);
       q = queuebuf_new_from_packetbuf();
       if(q == NULL) {
         PRINTFO("could not allocate queuebuf, dropping fragment\n");
@@ -1548,6 +1669,7 @@ output(const uip_lladdr_t *localdest)
       queuebuf_to_packetbuf(q);
       queuebuf_free(q);
       q = NULL;
+#endif /* SICSLOWPAN_CONF_FRAG_REFERENCE */
       processed_ip_out_len += packetbuf_payload_len;
 
       /* Check tx result. */
@@ -1576,6 +1698,338 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that have timed out. */
+static void
+reass_expire(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass_contexts[i].size > 0 && timer_expired(&reass_contexts[i].timer)) {
+      if(!REASS_DONE(&reass_contexts[i])) {
+        PRINTFI("sicslowpan input: reassembly of tag %d timed out\n",
+                reass_contexts[i].tag);
+        UIP_STAT(++sicslowpan_stats.frag.timeout);
+      }
+      reass_contexts[i].size = 0;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Get the reassembly context of a fragment
+ * \param sender The link-layer sender of the fragment
+ * \param tag The datagram tag of the fragment
+ * \param size The datagram size of the fragment
+ * \return The context, or a new one if none matches
+ *
+ * A new context is preferably one that is not in use, then one of a
+ * datagram that has been reassembled. If all contexts are reassembling
+ * datagrams, the one that was started first is discarded in favour of
+ * the new datagram. This lessens the negative impacts of too high
+ * SICSLOWPAN_REASS_MAXAGE.
+ */
+static struct reass_context *
+reass_context(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct reass_context *c, *r, *oldest;
+  int i;
+
+  r = NULL;
+  oldest = NULL;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    c = &reass_contexts[i];
+    if(c->size == size && c->tag == tag && linkaddr_cmp(&c->sender, sender)) {
+      return c;
+    }
+    if(c->size == 0 || REASS_DONE(c)) {
+      if(r == NULL || r->size > 0) {
+        r = c;
+      }
+    } else if(oldest == NULL ||
+              (uint16_t)(reass_serial - c->serial) >
+              (uint16_t)(reass_serial - oldest->serial)) {
+      oldest = c;
+    }
+  }
+
+  if(r == NULL) {
+    PRINTFI("sicslowpan input: discarding reassembly of tag %d\n",
+            oldest->tag);
+    UIP_STAT(++sicslowpan_stats.frag.evicted);
+    r = oldest;
+  }
+
+  r->size = size;
+  r->tag = tag;
+  linkaddr_copy(&r->sender, sender);
+  r->serial = ++reass_serial;
+  r->blocks = 0;
+  memset(r->received, 0, sizeof(r->received));
+  timer_set(&r->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  return r;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Mark bytes of a datagram as received
+ * \param r The reassembly context of the datagram
+ * \param offset The offset of the bytes in the datagram
+ * \param len The number of bytes
+ * \return Non-zero if the whole datagram has been received
+ */
+static int
+reass_mark(struct reass_context *r, uint16_t offset, uint16_t len)
+{
+  uint16_t block, end;
+
+  end = (offset + len + 7) >> 3;
+  for(block = offset >> 3; block < end; block++) {
+    if((r->received[block >> 3] & (1 << (block & 7))) == 0) {
+      r->received[block >> 3] |= 1 << (block & 7);
+      r->blocks++;
+    }
+  }
+  return REASS_DONE(r);
+}
+#if SICSLOWPAN_FRAG_FORWARD
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Get the forwarding entry of a fragment
+ * \param sender The link-layer sender of the fragment
+ * \param tag The datagram tag of the fragment
+ * \param size The datagram size of the fragment
+ * \return The entry, or NULL if the datagram is not being forwarded
+ */
+static struct frag_forward *
+forward_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct frag_forward *f;
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_ENTRIES; i++) {
+    f = &frag_forwards[i];
+    if(f->size > 0 && timer_expired(&f->timer)) {
+      f->size = 0;
+    }
+    if(f->size == size && f->tag == tag && linkaddr_cmp(&f->sender, sender)) {
+      return f;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a datagram that is not for us
+ * \param r The reassembly context the fragment was uncompressed in
+ * \param len The number of bytes of the datagram in the fragment
+ * \return Non-zero if the fragments of the datagram are forwarded as
+ * they arrive, zero if the datagram has to be reassembled
+ *
+ * The IP header is checked and updated as uip6.c does when forwarding
+ * a datagram. It is then compressed again, as what can be elided
+ * depends on the link layer addresses, and sent with the rest of the
+ * fragment. Datagrams that uip6.c or tcpip.c would handle otherwise
+ * than by forwarding them to a known neighbor are reassembled.
+ */
+static int
+forward_first(struct reass_context *r, uint16_t len)
+{
+  struct frag_forward *f;
+  uip_ds6_route_t *route;
+  uip_ipaddr_t *nexthop;
+  uip_ds6_nbr_t *nbr;
+  linkaddr_t dest;
+  int end;
+  int i;
+
+  f = NULL;
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_ENTRIES; i++) {
+    if(frag_forwards[i].size == 0 || timer_expired(&frag_forwards[i].timer)) {
+      f = &frag_forwards[i];
+      break;
+    }
+  }
+  if(f == NULL) {
+    return 0;
+  }
+
+  memcpy(UIP_IP_BUF, SICSLOWPAN_IP_BUF, len);
+
+  if(uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_loopback(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr) ||
+     r->size > UIP_LINK_MTU || UIP_IP_BUF->ttl <= 1) {
+    return 0;
+  }
+
+#if UIP_CONF_IPV6_RPL
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+    /* RPL updates its option, which must be in this fragment */
+    if(len < UIP_IPH_LEN + 2 ||
+       len < UIP_IPH_LEN + ((((uint8_t *)UIP_IP_BUF)[UIP_IPH_LEN + 1] + 1) << 3)) {
+      return 0;
+    }
+  } else if(RPL_INSERT_HBH_OPTION) {
+    /* RPL inserts its option, which moves the following fragments */
+    return 0;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL) {
+    return 0;
+  }
+  nbr = uip_ds6_nbr_lookup(nexthop);
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return 0;
+  }
+  linkaddr_copy(&dest, (const linkaddr_t *)uip_ds6_nbr_get_ll(nbr));
+
+  /* From here on, the datagram is not reassembled */
+  f->size = r->size;
+  f->tag = r->tag;
+  linkaddr_copy(&f->sender, &r->sender);
+  linkaddr_copy(&f->next_hop, &linkaddr_null);
+  timer_set(&f->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  r->size = 0;
+
+#if UIP_CONF_IPV6_RPL
+  uip_ext_len = 0;
+  if(rpl_update_header_empty() || rpl_update_header_final(nexthop)) {
+    PRINTFI("sicslowpan input: RPL forward error, dropping tag %d\n", f->tag);
+    UIP_STAT(++sicslowpan_stats.frag.drop);
+    return 1;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  if(callback) {
+    set_packet_attrs();
+  }
+
+  uip_len = f->size;
+  compress_hdr(&dest);
+  uip_len = 0;
+
+  /*
+   * The header may compress worse for the next hop than it did for us,
+   * typically as an address can no longer be derived from the link
+   * layer source. The bytes that then do not fit in the first fragment
+   * are sent in a fragment of their own.
+   */
+  end = (uncomp_hdr_len + max_payload_len(&dest) -
+         SICSLOWPAN_FRAG1_HDR_LEN - packetbuf_hdr_len) & 0xfffffff8;
+  if(end > len) {
+    end = len;
+  }
+  if(end <= uncomp_hdr_len) {
+    PRINTFI("sicslowpan input: first fragment too large, dropping tag %d\n",
+            f->tag);
+    UIP_STAT(++sicslowpan_stats.frag.drop);
+    return 1;
+  }
+  f->out_tag = my_tag++;
+  linkaddr_copy(&f->next_hop, &dest);
+  PRINTFI("sicslowpan input: forwarding tag %d as tag %d\n",
+          f->tag, f->out_tag);
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | f->size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, f->out_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  packetbuf_payload_len = end - uncomp_hdr_len;
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + packetbuf_payload_len);
+  UIP_STAT(++sicslowpan_stats.frag.forwarded);
+  send_packet(&dest);
+
+  if(end < len) {
+    packetbuf_clear();
+    packetbuf_ptr = packetbuf_dataptr();
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                       SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+    if(callback) {
+      set_packet_attrs();
+    }
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | f->size));
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, f->out_tag);
+    PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = end >> 3;
+    memcpy(packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN,
+           (uint8_t *)UIP_IP_BUF + end, len - end);
+    packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + len - end);
+    send_packet(&dest);
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a subsequent fragment of a datagram
+ * \param f The forwarding entry of the datagram
+ * \param offset The offset of the fragment in 8-byte units
+ *
+ * The fragment is sent as it is in packetbuf, with only its datagram
+ * tag changed. The entry is freed once the fragment that ends the
+ * datagram is forwarded. Fragments arriving after it start a reassembly
+ * that times out, so they are dropped all the same.
+ */
+static void
+forward_next(struct frag_forward *f, uint8_t offset)
+{
+  uint8_t *frag;
+  uint16_t len;
+
+  if(linkaddr_cmp(&f->next_hop, &linkaddr_null)) {
+    UIP_STAT(++sicslowpan_stats.frag.drop);
+    return;
+  }
+
+  frag = packetbuf_dataptr();
+  len = packetbuf_datalen();
+  if(len < SICSLOWPAN_FRAGN_HDR_LEN) {
+    UIP_STAT(++sicslowpan_stats.frag.drop);
+    return;
+  }
+  if((uint16_t)(offset << 3) + len - SICSLOWPAN_FRAGN_HDR_LEN >= f->size) {
+    f->size = 0;
+  }
+
+  /* Move the fragment to where the MAC layer expects a packet to send */
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), frag, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  SET16((uint8_t *)packetbuf_dataptr(), PACKETBUF_FRAG_TAG, f->out_tag);
+
+  PRINTFI("sicslowpan input: forwarding offset %d of tag %d as tag %d\n",
+          offset, f->tag, f->out_tag);
+  UIP_STAT(++sicslowpan_stats.frag.forwarded);
+  send_packet(&f->next_hop);
+}
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1600,8 +2054,12 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
+  /* the datagram the fragment belongs to */
+  struct reass_context *reass = NULL;
 #endif /*SICSLOWPAN_CONF_FRAG*/
+#if SICSLOWPAN_FRAG_FORWARD
+  struct frag_forward *forward;
+#endif /* SICSLOWPAN_FRAG_FORWARD */
 
   /* init */
   uncomp_hdr_len = 0;
@@ -1615,10 +2073,7 @@ input(void)
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
   /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  reass_expire();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1634,8 +2089,6 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
-      /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
-      first_fragment = 1;
       is_fragment = 1;
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1650,77 +2103,50 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-
-  if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
-      return;
-    }
-  } else {
+  if(is_fragment) {
     /*
-     * reassembly is off
-     * start it if we received a fragment
+     * Fragments are reassembled in the context of their datagram,
+     * which is started by whichever fragment arrives first.
      */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
-        return;
+    UIP_STAT(++sicslowpan_stats.frag.recv);
+    if(frag_size == 0 || frag_size > UIP_BUFSIZE - UIP_LLH_LEN) {
+      PRINTFI("sicslowpan input: Dropping fragment of invalid size %d\n",
+              frag_size);
+      UIP_STAT(++sicslowpan_stats.frag.drop);
+      return;
+    }
+#if SICSLOWPAN_FRAG_FORWARD
+    forward = forward_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                             frag_tag, frag_size);
+    if(forward != NULL) {
+      if(packetbuf_hdr_len == SICSLOWPAN_FRAG1_HDR_LEN) {
+        PRINTFI("sicslowpan input: Dropping duplicate first fragment of tag %d\n",
+                frag_tag);
+        UIP_STAT(++sicslowpan_stats.frag.drop);
+      } else {
+        forward_next(forward, frag_offset);
       }
-
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      linkaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      return;
     }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+    reass = reass_context(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                          frag_tag, frag_size);
+    if(REASS_DONE(reass)) {
+      PRINTFI("sicslowpan input: Dropping duplicate fragment of tag %d\n",
+              frag_tag);
+      UIP_STAT(++sicslowpan_stats.frag.drop);
+      return;
+    }
+    sicslowpan_buf = reass->buf.u8;
+  } else {
+    /* Packets that are not fragmented are uncompressed in place. */
+    sicslowpan_buf = uip_buf;
   }
 
   if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1782,77 +2208,87 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+#if SICSLOWPAN_CONF_FRAG
+    if(is_fragment && req_size > UIP_LLH_LEN + frag_size) {
+      if(uncomp_hdr_len + (uint16_t)(frag_offset << 3) >= frag_size) {
+        PRINTFI("sicslowpan input: Dropping fragment beyond datagram size\n");
+        UIP_STAT(++sicslowpan_stats.frag.drop);
+        return;
+      }
+      /* For the last fragment, we may shave off any extrenous bytes at
+         the end. We must be liberal in what we accept. */
+      packetbuf_payload_len = frag_size - uncomp_hdr_len - (uint16_t)(frag_offset << 3);
+      req_size = UIP_LLH_LEN + frag_size;
+    }
+#endif /* SICSLOWPAN_CONF_FRAG */
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          packetbuf_payload_len, req_size, sizeof(sicslowpan_buf));
+          packetbuf_payload_len, req_size, UIP_BUFSIZE);
+#if SICSLOWPAN_CONF_FRAG
+      if(is_fragment) {
+        UIP_STAT(++sicslowpan_stats.frag.drop);
+      }
+#endif /* SICSLOWPAN_CONF_FRAG */
       return;
     }
   }
 
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
   
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
-
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
-    }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
-    } else {
-      processed_ip_in_len += packetbuf_payload_len;
+  if(is_fragment) {
+#if SICSLOWPAN_FRAG_FORWARD
+    /* Only a first fragment that starts its datagram can be forwarded */
+    uint8_t can_forward = uncomp_hdr_len > 0 && reass->blocks == 0;
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+    /*
+     * If we have a full IP packet in the reassembly buffer, deliver
+     * it to the IP stack
+     */
+    if(!reass_mark(reass, (uint16_t)(frag_offset << 3),
+                   uncomp_hdr_len + packetbuf_payload_len)) {
+#if SICSLOWPAN_FRAG_FORWARD
+      if(can_forward &&
+         forward_first(reass, uncomp_hdr_len + packetbuf_payload_len)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+      PRINTF("sicslowpan input: %d of %d blocks of tag %d received\n",
+             reass->blocks, (reass->size + 7) >> 3, reass->tag);
+      return;
     }
-    PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", processed_ip_in_len, packetbuf_payload_len);
-
+    PRINTFI("sicslowpan input: IP packet ready (length %d)\n", reass->size);
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, reass->size);
+    uip_len = reass->size;
+    UIP_STAT(++sicslowpan_stats.frag.reassembled);
   } else {
-#endif /* SICSLOWPAN_CONF_FRAG */
-    sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
+    uip_len = packetbuf_payload_len + uncomp_hdr_len;
   }
-
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
+#else /* SICSLOWPAN_CONF_FRAG */
+  sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
-    {
-      uint16_t ndx;
-      PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
-      for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
-        uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
-        PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint16_t ndx;
+    PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
+    for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
-    /* if callback is set then set attributes and call */
-    if(callback) {
-      set_packet_attrs();
-      callback->input_callback();
-    }
-
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+  /* if callback is set then set attributes and call */
+  if(callback) {
+    set_packet_attrs();
+    callback->input_callback();
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+
+  tcpip_input();
 }
 /** @} */
 
@@ -319,6 +319,27 @@ struct sicslowpan_nh_compressor {
 
 };
 
+#if UIP_STATISTICS == 1
+/**
+ * The 6lowpan statistics, gathered if UIP_STATISTICS is set to 1.
+ */
+struct sicslowpan_stats {
+  struct {
+    uip_stats_t recv;        /**< Number of received fragments. */
+    uip_stats_t reassembled; /**< Number of reassembled datagrams. */
+    uip_stats_t timeout;     /**< Number of datagrams that timed out
+                                  before being reassembled. */
+    uip_stats_t evicted;     /**< Number of datagrams discarded to
+                                  reassemble a newer one. */
+    uip_stats_t forwarded;   /**< Number of fragments forwarded
+                                  without reassembly. */
+    uip_stats_t drop;        /**< Number of dropped fragments. */
+  } frag;                    /**< Fragmentation statistics. */
+};
+
+extern struct sicslowpan_stats sicslowpan_stats;
+#endif /* UIP_STATISTICS == 1 */
+
 int sicslowpan_get_last_rssi(void);
 
 extern const struct network_driver sicslowpan_driver;
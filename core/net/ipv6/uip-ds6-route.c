@@ -72,6 +72,48 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_WITH_HASH
+/* Hash index over the routes, using open addressing with linear
+   probing. Each slot holds the index of a route in routememb plus
+   one, or zero if the slot is empty. A route is hashed on its prefix
+   length and the bytes that uip_ipaddr_prefixcmp() compares for that
+   length. */
+#if UIP_DS6_ROUTE_NB <= 8
+#define ROUTE_HASH_SIZE 16
+#elif UIP_DS6_ROUTE_NB <= 16
+#define ROUTE_HASH_SIZE 32
+#elif UIP_DS6_ROUTE_NB <= 32
+#define ROUTE_HASH_SIZE 64
+#elif UIP_DS6_ROUTE_NB <= 64
+#define ROUTE_HASH_SIZE 128
+#elif UIP_DS6_ROUTE_NB <= 128
+#define ROUTE_HASH_SIZE 256
+#elif UIP_DS6_ROUTE_NB <= 256
+#define ROUTE_HASH_SIZE 512
+#elif UIP_DS6_ROUTE_NB <= 512
+#define ROUTE_HASH_SIZE 1024
+#elif UIP_DS6_ROUTE_NB <= 1024
+#define ROUTE_HASH_SIZE 2048
+#else
+#error UIP_DS6_ROUTE_WITH_HASH supports at most 1024 routes
+#endif
+
+#if UIP_DS6_ROUTE_NB < 255
+typedef uint8_t route_slot_t;
+#else
+typedef uint16_t route_slot_t;
+#endif
+
+static route_slot_t route_slots[ROUTE_HASH_SIZE];
+
+/* Bitmap of the prefix lengths, 0 to 128, used by at least one
+   route. */
+static uint8_t route_lengths[128 / 8 + 1];
+
+#define ROUTE_INDEX(r) ((r) - (uip_ds6_route_t *)routememb.mem)
+#define ROUTE_FROM_SLOT(s) ((uip_ds6_route_t *)routememb.mem + (s) - 1)
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -106,6 +148,101 @@ assert_nbr_routes_list_sane(void)
 }
 #endif /* DEBUG != DEBUG_NONE */
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_WITH_HASH
+static int
+route_hash(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint16_t h;
+  int i;
+
+  h = length;
+  for(i = 0; i < (length >> 3); i++) {
+    h = (h << 5) + h + addr->u8[i];
+  }
+  return (h ^ (h >> 8)) & (ROUTE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_add(uip_ds6_route_t *r)
+{
+  int slot;
+
+  slot = route_hash(&r->ipaddr, r->length);
+  while(route_slots[slot] != 0) {
+    slot = (slot + 1) & (ROUTE_HASH_SIZE - 1);
+  }
+  route_slots[slot] = ROUTE_INDEX(r) + 1;
+  route_lengths[r->length >> 3] |= 1 << (r->length & 7);
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_rm(uip_ds6_route_t *route)
+{
+  uip_ds6_route_t *r;
+  int slot, next, home;
+
+  slot = route_hash(&route->ipaddr, route->length);
+  while(route_slots[slot] != ROUTE_INDEX(route) + 1) {
+    if(route_slots[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) & (ROUTE_HASH_SIZE - 1);
+  }
+
+  /* Shift back the entries that follow in the probe sequence, so
+     that no lookup stops at the hole we leave. An entry is moved
+     unless its home slot lies cyclically in (slot, next]. */
+  next = slot;
+  while(1) {
+    next = (next + 1) & (ROUTE_HASH_SIZE - 1);
+    if(route_slots[next] == 0) {
+      break;
+    }
+    r = ROUTE_FROM_SLOT(route_slots[next]);
+    home = route_hash(&r->ipaddr, r->length);
+    if(((next - home) & (ROUTE_HASH_SIZE - 1)) >=
+       ((next - slot) & (ROUTE_HASH_SIZE - 1))) {
+      route_slots[slot] = route_slots[next];
+      slot = next;
+    }
+  }
+  route_slots[slot] = 0;
+
+  /* Clear the prefix length from the bitmap if no other route uses
+     it. The route must already be removed from the route list. */
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length == route->length) {
+      return;
+    }
+  }
+  route_lengths[route->length >> 3] &= ~(1 << (route->length & 7));
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_hash_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  int length, slot;
+
+  /* Probe the index for each prefix length in use, longest first. */
+  for(length = 128; length >= 0; length--) {
+    if((route_lengths[length >> 3] & (1 << (length & 7))) == 0) {
+      continue;
+    }
+    slot = route_hash(addr, length);
+    while(route_slots[slot] != 0) {
+      r = ROUTE_FROM_SLOT(route_slots[slot]);
+      if(r->length == length &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        return r;
+      }
+      slot = (slot + 1) & (ROUTE_HASH_SIZE - 1);
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
+/*---------------------------------------------------------------------------*/
 #if UIP_DS6_NOTIFICATIONS
 static void
 call_route_callback(int event, uip_ipaddr_t *route,
@@ -148,6 +285,10 @@ uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_WITH_HASH
+  memset(route_slots, 0, sizeof(route_slots));
+  memset(route_lengths, 0, sizeof(route_lengths));
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -205,15 +346,20 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_WITH_HASH
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_WITH_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_WITH_HASH
+  found_route = route_hash_lookup(addr);
+#else /* UIP_DS6_ROUTE_WITH_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -229,6 +375,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -240,6 +387,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if !UIP_DS6_ROUTE_WITH_HASH
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -249,6 +397,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_WITH_HASH */
 
   return found_route;
 }
@@ -372,6 +521,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
 
+#if UIP_DS6_ROUTE_WITH_HASH
+  route_hash_add(r);
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
+
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
 #endif
@@ -410,6 +563,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     /* Remove the route from the route list */
     list_remove(routelist, route);
 
+#if UIP_DS6_ROUTE_WITH_HASH
+    route_hash_rm(route);
+#endif /* UIP_DS6_ROUTE_WITH_HASH */
+
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
         neighbor_route != NULL && neighbor_route->route != route;
@@ -88,6 +88,19 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Keep a hash index over the routes, keyed by prefix and prefix
+   length, so that a route lookup probes the index once for each
+   prefix length in use instead of comparing against every route.
+   Costs one or two bytes of RAM per hash slot, with at least twice
+   as many hash slots as routes. Lookups no longer move the route to
+   the front of the route list, so when the table is full the oldest
+   route, rather than the least recently used one, is dropped. */
+#ifdef UIP_CONF_DS6_ROUTE_WITH_HASH
+#define UIP_DS6_ROUTE_WITH_HASH UIP_CONF_DS6_ROUTE_WITH_HASH
+#else /* UIP_CONF_DS6_ROUTE_WITH_HASH */
+#define UIP_DS6_ROUTE_WITH_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_WITH_HASH */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
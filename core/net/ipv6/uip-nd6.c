@@ -391,8 +391,8 @@ uip_nd6_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t * tgt)
 /**
  * Neighbor Advertisement Processing
  *
- * we might have to send a pkt that had been buffered while address
- * resolution was performed (if we support buffering, see UIP_CONF_QUEUE_PKT)
+ * we might have to send the pkts that had been buffered while address
+ * resolution was performed (if we support buffering, see UIP_CONF_IPV6_QUEUE_PKT)
  *
  * As per RFC 4861, on link layer that have addresses, TLLAO options MUST be
  * included when responding to multicast solicitations, SHOULD be included in
@@ -536,20 +536,11 @@ na_input(void)
     }
   }
 #if UIP_CONF_IPV6_QUEUE_PKT
-  /* The nbr is now reachable, check if we had buffered a pkt for it */
-  /*if(nbr->queue_buf_len != 0) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
+  /* The nbr is now reachable, send the pkts we had buffered for it */
+  while((uip_len = uip_packetqueue_pop(&nbr->packethandle,
+                                       (uint8_t *)UIP_IP_BUF)) != 0) {
+    tcpip_output(uip_ds6_nbr_get_ll(nbr));
   }
-  
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
 
 discard:
@@ -1008,18 +999,12 @@ ra_input(void)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   /* If the nbr just became reachable (e.g. it was in NBR_INCOMPLETE state
-   * and we got a SLLAO), check if we had buffered a pkt for it */
-  /*  if((nbr != NULL) && (nbr->queue_buf_len != 0)) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
+   * and we got a SLLAO), send the pkts we had buffered for it */
+  if(nbr != NULL) {
+    while((uip_len = uip_packetqueue_pop(&nbr->packethandle,
+                                         (uint8_t *)UIP_IP_BUF)) != 0) {
+      tcpip_output(uip_ds6_nbr_get_ll(nbr));
+    }
   }
 
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
@@ -73,6 +73,7 @@
 
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
@@ -151,7 +152,6 @@ uint8_t uip_ext_opt_offset = 0;
  * \name Buffer defines
  * @{
  */
-#define FBUF                             ((struct uip_tcpip_hdr *)&uip_reassbuf[0])
 #define UIP_IP_BUF                          ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF                      ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
 #define UIP_UDP_BUF                        ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
@@ -208,8 +208,12 @@ struct uip_conn *uip_conn;
 
 /* Temporary variables. */
 #if (UIP_TCP || UIP_UDP)
+#if UIP_UDP_CONNS > 255 || UIP_CONNS > 255
+static uint16_t c;
+#else
 static uint8_t c;
 #endif
+#endif
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
 /* Keeps track of the last port used for a new connection. */
@@ -257,6 +261,35 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+#if UIP_CONF_TCP_SPLIT
+#error UIP_CONF_TCP_SPLIT cannot be used with UIP_CONF_TCP_WINDOW_SEGMENTS
+#endif /* UIP_CONF_TCP_SPLIT */
+/* The data that a connection has queued for sending and not yet got
+   acknowledged, in segments, oldest first. */
+struct tcp_window {
+  uint8_t buf[UIP_TCP_WINDOW_BUFSIZE];
+  uint16_t seglen[UIP_TCP_WINDOW_SEGMENTS];
+  uint16_t snd_wnd;  /* The window advertised by the peer. */
+  uint16_t sndlen;   /* The length of the segments that have been sent. */
+  uint16_t sndmax;   /* The length of the data ever sent, i.e., snd_max
+                        minus snd_nxt, which a retransmission leaves. */
+  uint8_t nseg;      /* The number of segments in the buffer. */
+  uint8_t nsent;     /* The number of segments that have been sent. */
+  uint8_t close;     /* Send a FIN once all data has been acknowledged. */
+};
+static struct tcp_window tcp_windows[UIP_CONNS];
+#define TCP_WINDOW(conn) (&tcp_windows[(conn) - uip_conns])
+
+/* The offset from snd_nxt of the data segment that is being sent. */
+static uint16_t tcp_snd_offset;
+
+#define TCP_CAN_SEND(conn) ((conn)->mss > 0 ||                           \
+                            TCP_WINDOW(conn)->nsent < TCP_WINDOW(conn)->nseg)
+#else /* UIP_TCP_WINDOW_SEGMENTS > 1 */
+#define TCP_CAN_SEND(conn) (!uip_outstanding(conn))
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -272,6 +305,117 @@ struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
 #endif /* UIP_UDP */
 /** @} */
 
+/*---------------------------------------------------------------------------*/
+/**
+ * \name Connection index
+ * @{
+ */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_HASH_SIZE
+#if UIP_CONN_HASH_SIZE & (UIP_CONN_HASH_SIZE - 1)
+#error UIP_CONF_CONN_HASH_SIZE must be a power of two
+#endif
+/* Each bucket is a chain of indices into the connection table, linked
+   through the next array and kept in table order, so that a lookup
+   returns the same connection as a scan of the table would. */
+#if UIP_UDP_CONNS < 255 && UIP_CONNS < 255
+typedef uint8_t conn_hash_index_t;
+#else
+typedef uint16_t conn_hash_index_t;
+#endif
+#define CONN_HASH_END ((conn_hash_index_t)~0)
+static conn_hash_index_t conn_hash_i;
+#define CONN_HASH(port) \
+  ((((port) >> 8) ^ (port)) & (UIP_CONN_HASH_SIZE - 1))
+
+#if UIP_UDP
+/* UDP connections are hashed on the local port. */
+static conn_hash_index_t udp_hash[UIP_CONN_HASH_SIZE];
+static conn_hash_index_t udp_hash_next[UIP_UDP_CONNS];
+#endif /* UIP_UDP */
+#if UIP_TCP
+/* TCP connections are hashed on both ports. */
+#define TCP_HASH_KEY(conn) ((conn)->lport ^ (conn)->rport)
+static conn_hash_index_t tcp_hash[UIP_CONN_HASH_SIZE];
+static conn_hash_index_t tcp_hash_next[UIP_CONNS];
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_remove(conn_hash_index_t *bucket, conn_hash_index_t *next,
+                 conn_hash_index_t i)
+{
+  for(; *bucket != CONN_HASH_END; bucket = &next[*bucket]) {
+    if(*bucket == i) {
+      *bucket = next[i];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_add(conn_hash_index_t *bucket, conn_hash_index_t *next,
+              conn_hash_index_t i)
+{
+  while(*bucket != CONN_HASH_END && *bucket < i) {
+    bucket = &next[*bucket];
+  }
+  next[i] = *bucket;
+  *bucket = i;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+void
+uip_udp_set_lport(struct uip_udp_conn *conn, uint16_t port)
+{
+  conn_hash_index_t i = conn - uip_udp_conns;
+
+  if(conn->lport != 0) {
+    conn_hash_remove(&udp_hash[CONN_HASH(conn->lport)], udp_hash_next, i);
+  }
+  conn->lport = port;
+  if(port != 0) {
+    conn_hash_add(&udp_hash[CONN_HASH(port)], udp_hash_next, i);
+  }
+}
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+/* Change the ports of a TCP connection. Closed connections stay in the
+   index until they are reused. */
+static void
+tcp_set_ports(struct uip_conn *conn, uint16_t lport, uint16_t rport)
+{
+  conn_hash_index_t i = conn - uip_conns;
+
+  if(conn->lport != 0) {
+    conn_hash_remove(&tcp_hash[CONN_HASH(TCP_HASH_KEY(conn))],
+                     tcp_hash_next, i);
+  }
+  conn->lport = lport;
+  conn->rport = rport;
+  conn_hash_add(&tcp_hash[CONN_HASH(TCP_HASH_KEY(conn))], tcp_hash_next, i);
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+static void
+conn_hash_init(void)
+{
+#if UIP_UDP
+  memset(udp_hash, 0xff, sizeof(udp_hash));
+#endif /* UIP_UDP */
+#if UIP_TCP
+  memset(tcp_hash, 0xff, sizeof(tcp_hash));
+  for(c = 0; c < UIP_CONNS; ++c) {
+    if(uip_conns[c].lport != 0) {
+      conn_hash_add(&tcp_hash[CONN_HASH(TCP_HASH_KEY(&uip_conns[c]))],
+                    tcp_hash_next, c);
+    }
+  }
+#endif /* UIP_TCP */
+}
+#endif /* UIP_CONN_HASH_SIZE */
+/** @} */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \name ICMPv6 variables
@@ -319,41 +463,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-  
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-  
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -362,7 +475,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -392,10 +505,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
                upper_layer_len);
     
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -425,6 +538,10 @@ uip_udpchksum(void)
 #endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+#if UIP_CONF_IPV6_REASSEMBLY
+static void uip_reass_init(void);
+#endif /* UIP_CONF_IPV6_REASSEMBLY */
+
 void
 uip_init(void)
 {
@@ -452,6 +569,14 @@ uip_init(void)
   }
 #endif /* UIP_UDP */
 
+#if UIP_CONN_HASH_SIZE
+  conn_hash_init();
+#endif /* UIP_CONN_HASH_SIZE */
+
+#if UIP_CONF_IPV6_REASSEMBLY
+  uip_reass_init();
+#endif /* UIP_CONF_IPV6_REASSEMBLY */
+
 #if UIP_CONF_IPV6_MULTICAST
   UIP_MCAST6.init();
 #endif
@@ -520,8 +645,12 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_CONN_HASH_SIZE
+  tcp_set_ports(conn, uip_htons(lastport), rport);
+#else /* UIP_CONN_HASH_SIZE */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
+#endif /* UIP_CONN_HASH_SIZE */
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
   
   return conn;
@@ -585,7 +714,7 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     return 0;
   }
   
-  conn->lport = UIP_HTONS(lastport);
+  uip_udp_bind(conn, UIP_HTONS(lastport));
   conn->rport = rport;
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
@@ -626,194 +755,413 @@ uip_listen(uint16_t port)
 #if UIP_CONF_IPV6_REASSEMBLY
 #define UIP_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
 
-static uint8_t uip_reassbuf[UIP_REASS_BUFSIZE];
+/*
+ * See RFC 2460 for a description of fragmentation in IPv6
+ * A typical Ipv6 fragment
+ *  +------------------+--------+--------------+
+ *  |  Unfragmentable  |Fragment|    first     |
+ *  |       Part       | Header |   fragment   |
+ *  +------------------+--------+--------------+
+ */
+
+/*
+ * The datagrams being reassembled are stored, unfragmentable part
+ * first, in chunks taken from a pool of UIP_REASS_BUDGET bytes that
+ * is shared by all reassembly contexts. A context only holds the
+ * chunks its fragments have reached so far.
+ */
+#define REASS_CHUNK_SIZE 64
+#define REASS_CHUNKS     (UIP_REASS_BUDGET / REASS_CHUNK_SIZE)
+#define REASS_MAX_CHUNKS ((UIP_REASS_BUFSIZE + REASS_CHUNK_SIZE - 1) / REASS_CHUNK_SIZE)
+#define REASS_NO_CHUNK   0xff
 
-static uint8_t uip_reassbitmap[UIP_REASS_BUFSIZE / (8 * 8)];
-/*the first byte of an IP fragment is aligned on an 8-byte boundary */
+#if REASS_CHUNKS >= REASS_NO_CHUNK
+#error UIP_CONF_IPV6_REASS_BUDGET must be less than 255 * 64 bytes
+#endif /* REASS_CHUNKS >= REASS_NO_CHUNK */
 
-static const uint8_t bitmap_bits[8] = {0xff, 0x7f, 0x3f, 0x1f,
-                                    0x0f, 0x07, 0x03, 0x01};
-static uint16_t uip_reasslen;
-static uint8_t uip_reassflags;
+/* The number of 8-byte blocks in a reassembled datagram */
+#define REASS_BLOCKS ((UIP_REASS_BUFSIZE + 7) / 8)
+
+/*
+ * A datagram being reassembled. Fragments belong to it if they have
+ * the same source address, destination address and identification.
+ */
+struct uip_reass_context {
+  uip_ipaddr_t srcipaddr;
+  uip_ipaddr_t destipaddr;
+  uint32_t id;
+  /* The chunks holding the datagram, REASS_NO_CHUNK where none has
+     been needed yet. */
+  uint8_t chunk[REASS_MAX_CHUNKS];
+  /* The 8-byte blocks of the fragmentable part received so far. */
+  uint8_t received[(REASS_BLOCKS + 7) / 8];
+  /* The number of blocks set in received. */
+  uint16_t blocks;
+  /* The length of the fragmentable part, known once the last fragment
+     has been received. */
+  uint16_t len;
+  /* The length of the unfragmentable part, zero if the context is not
+     in use. */
+  uint16_t hdrlen;
+  /* The order in which the contexts were started. */
+  uint16_t serial;
+  uint8_t flags;
+  struct timer timer;
+};
 
 #define UIP_REASS_FLAG_LASTFRAG 0x01
 #define UIP_REASS_FLAG_FIRSTFRAG 0x02
 #define UIP_REASS_FLAG_ERROR_MSG 0x04
-
+#define UIP_REASS_FLAG_DONE 0x08
 
 /*
- * See RFC 2460 for a description of fragmentation in IPv6
- * A typical Ipv6 fragment
- *  +------------------+--------+--------------+
- *  |  Unfragmentable  |Fragment|    first     |
- *  |       Part       | Header |   fragment   |
- *  +------------------+--------+--------------+
+ * A reassembled datagram gives its chunks back at once but keeps its
+ * context until the context is needed or times out, so that late
+ * duplicates of its fragments are recognized and dropped.
  */
+#define REASS_DONE(r) ((r)->flags & UIP_REASS_FLAG_DONE)
+
+static struct uip_reass_context uip_reass_contexts[UIP_REASS_CONTEXTS];
+static uint16_t uip_reass_serial;
 
+static uint8_t uip_reass_pool[REASS_CHUNKS][REASS_CHUNK_SIZE];
+/* The free chunks of the pool, linked through uip_reass_next. */
+static uint8_t uip_reass_next[REASS_CHUNKS];
+static uint8_t uip_reass_free;
+
+/* Only tells uip_process whether uip_reass() left an error message in
+   uip_buf. */
+static uint8_t uip_reassflags;
 
-struct etimer uip_reass_timer; /* timer for reassembly */
-uint8_t uip_reass_on; /* equal to 1 if we are currently reassembling a packet */
+struct etimer uip_reass_timer; /* timer for the oldest reassembly */
 
-static uint32_t uip_id; /* For every packet that is to be fragmented, the source
-                        node generates an Identification value that is present
-                        in all the fragments */
 #define IP_MF   0x0001
 
-static uint16_t
-uip_reass(void)
+/*---------------------------------------------------------------------------*/
+static void
+uip_reass_init(void)
 {
-  uint16_t offset=0;
-  uint16_t len;
-  uint16_t i;
-  
-  /* If ip_reasstmr is zero, no packet is present in the buffer */
-  /* We first write the unfragmentable part of IP header into the reassembly
-     buffer. The reset the other reassembly variables. */
-  if(uip_reass_on == 0) {
-    PRINTF("Starting reassembly\n");
-    memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
-    /* temporary in case we do not receive the fragment with offset 0 first */
-    etimer_set(&uip_reass_timer, UIP_REASS_MAXAGE*CLOCK_SECOND);
-    uip_reass_on = 1;
-    uip_reassflags = 0;
-    uip_id = UIP_FRAG_BUF->id;
-    /* Clear the bitmap. */
-    memset(uip_reassbitmap, 0, sizeof(uip_reassbitmap));
+  uint8_t i;
+
+  for(i = 0; i < UIP_REASS_CONTEXTS; i++) {
+    uip_reass_contexts[i].hdrlen = 0;
   }
-  /*
-   * Check if the incoming fragment matches the one currently present
-   * in the reasembly buffer. If so, we proceed with copying the fragment
-   * into the buffer.
-   */
-  if(uip_ipaddr_cmp(&FBUF->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
-     uip_ipaddr_cmp(&FBUF->destipaddr, &UIP_IP_BUF->destipaddr) &&
-     UIP_FRAG_BUF->id == uip_id) {
-    len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
-    offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
-    /* in byte, originaly in multiple of 8 bytes*/
-    PRINTF("len %d\n", len);
-    PRINTF("offset %d\n", offset);
-    if(offset == 0){
-      uip_reassflags |= UIP_REASS_FLAG_FIRSTFRAG;
-      /*
-       * The Next Header field of the last header of the Unfragmentable
-       * Part is obtained from the Next Header field of the first
-       * fragment's Fragment header.
-       */
-      *uip_next_hdr = UIP_FRAG_BUF->next;
-      memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
-      PRINTF("src ");
-      PRINT6ADDR(&FBUF->srcipaddr);
-      PRINTF("dest ");
-      PRINT6ADDR(&FBUF->destipaddr);
-      PRINTF("next %d\n", UIP_IP_BUF->proto);
-      
+  for(i = 0; i < REASS_CHUNKS; i++) {
+    uip_reass_next[i] = i + 1 < REASS_CHUNKS ? i + 1 : REASS_NO_CHUNK;
+  }
+  uip_reass_free = REASS_CHUNKS > 0 ? 0 : REASS_NO_CHUNK;
+}
+/*---------------------------------------------------------------------------*/
+/* Give the chunks of a context back to the pool. */
+static void
+uip_reass_release(struct uip_reass_context *r)
+{
+  uint8_t i;
+
+  for(i = 0; i < REASS_MAX_CHUNKS; i++) {
+    if(r->chunk[i] != REASS_NO_CHUNK) {
+      uip_reass_next[r->chunk[i]] = uip_reass_free;
+      uip_reass_free = r->chunk[i];
+      r->chunk[i] = REASS_NO_CHUNK;
     }
-    
-    /* If the offset or the offset + fragment length overflows the
-       reassembly buffer, we discard the entire packet. */
-    if(offset > UIP_REASS_BUFSIZE ||
-       offset + len > UIP_REASS_BUFSIZE) {
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-      return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Discard the datagram being reassembled in a context. */
+static void
+uip_reass_discard(struct uip_reass_context *r)
+{
+  uip_reass_release(r);
+  r->hdrlen = 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Get the reassembly context of a fragment, or a new one if none
+ * matches. A new context is preferably one that is not in use, then
+ * one of a datagram that has been reassembled. If all contexts are
+ * reassembling datagrams, the one that was started first is discarded
+ * in favour of the new datagram.
+ */
+static struct uip_reass_context *
+uip_reass_context(void)
+{
+  struct uip_reass_context *c, *r, *oldest;
+  uint8_t i;
+
+  r = NULL;
+  oldest = NULL;
+  for(i = 0; i < UIP_REASS_CONTEXTS; i++) {
+    c = &uip_reass_contexts[i];
+    if(c->hdrlen > 0 && timer_expired(&c->timer) && REASS_DONE(c)) {
+      c->hdrlen = 0;
     }
-
-    /* If this fragment has the More Fragments flag set to zero, it is the
-       last fragment*/
-    if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
-      uip_reassflags |= UIP_REASS_FLAG_LASTFRAG;
-      /*calculate the size of the entire packet*/
-      uip_reasslen = offset + len;
-      PRINTF("LAST FRAGMENT reasslen %d\n", uip_reasslen);
-    } else {
-      /* If len is not a multiple of 8 octets and the M flag of that fragment
-         is 1, then that fragment must be discarded and an ICMP Parameter
-         Problem, Code 0, message should be sent to the source of the fragment,
-         pointing to the Payload Length field of the fragment packet. */
-      if(len % 8 != 0){
-        uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
-        uip_reassflags |= UIP_REASS_FLAG_ERROR_MSG;
-        /* not clear if we should interrupt reassembly, but it seems so from
-           the conformance tests */
-        uip_reass_on = 0;
-        etimer_stop(&uip_reass_timer);
-        return uip_len;
-      }
+    if(c->hdrlen > 0 && c->id == UIP_FRAG_BUF->id &&
+       uip_ipaddr_cmp(&c->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
+       uip_ipaddr_cmp(&c->destipaddr, &UIP_IP_BUF->destipaddr)) {
+      return c;
     }
-    
-    /* Copy the fragment into the reassembly buffer, at the right
-       offset. */
-    memcpy((uint8_t *)FBUF + UIP_IPH_LEN + uip_ext_len + offset,
-           (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len);
-    
-    /* Update the bitmap. */
-    if(offset >> 6 == (offset + len) >> 6) {
-      uip_reassbitmap[offset >> 6] |=
-        bitmap_bits[(offset >> 3) & 7] &
-        ~bitmap_bits[((offset + len) >> 3)  & 7];
-    } else {
-      /* If the two endpoints are in different bytes, we update the
-         bytes in the endpoints and fill the stuff inbetween with
-         0xff. */
-      uip_reassbitmap[offset >> 6] |= bitmap_bits[(offset >> 3) & 7];
- 
-      for(i = (1 + (offset >> 6)); i < ((offset + len) >> 6); ++i) {
-        uip_reassbitmap[i] = 0xff;
+    if(c->hdrlen == 0 || REASS_DONE(c)) {
+      if(r == NULL || r->hdrlen > 0) {
+        r = c;
       }
-      uip_reassbitmap[(offset + len) >> 6] |=
-        ~bitmap_bits[((offset + len) >> 3) & 7];
+    } else if(oldest == NULL ||
+              (uint16_t)(uip_reass_serial - c->serial) >
+              (uint16_t)(uip_reass_serial - oldest->serial)) {
+      oldest = c;
     }
-  
-    /* Finally, we check if we have a full packet in the buffer. We do
-       this by checking if we have the last fragment and if all bits
-       in the bitmap are set. */
-    
-    if(uip_reassflags & UIP_REASS_FLAG_LASTFRAG) {
-      /* Check all bytes up to and including all but the last byte in
-         the bitmap. */
-      for(i = 0; i < (uip_reasslen >> 6); ++i) {
-        if(uip_reassbitmap[i] != 0xff) {
-          return 0;
+  }
+
+  if(r == NULL) {
+    PRINTF("Discarding the oldest reassembly\n");
+    UIP_STAT(++uip_stat.frag.evicted);
+    uip_reass_discard(oldest);
+    r = oldest;
+  }
+
+  PRINTF("Starting reassembly\n");
+  uip_ipaddr_copy(&r->srcipaddr, &UIP_IP_BUF->srcipaddr);
+  uip_ipaddr_copy(&r->destipaddr, &UIP_IP_BUF->destipaddr);
+  r->id = UIP_FRAG_BUF->id;
+  memset(r->chunk, REASS_NO_CHUNK, sizeof(r->chunk));
+  memset(r->received, 0, sizeof(r->received));
+  r->blocks = 0;
+  r->len = 0;
+  r->hdrlen = uip_ext_len + UIP_IPH_LEN;
+  r->serial = ++uip_reass_serial;
+  r->flags = 0;
+  timer_set(&r->timer, UIP_REASS_MAXAGE * CLOCK_SECOND);
+  if(etimer_expired(&uip_reass_timer)) {
+    etimer_set(&uip_reass_timer, UIP_REASS_MAXAGE * CLOCK_SECOND);
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copy bytes into a context, taking the chunks they need from the
+ * pool. If the pool is exhausted, the oldest other datagram being
+ * reassembled is discarded. Returns zero if no chunk could be had.
+ */
+static int
+uip_reass_copy(struct uip_reass_context *r, uint16_t pos,
+               const uint8_t *data, uint16_t len)
+{
+  struct uip_reass_context *c, *oldest;
+  uint16_t n;
+  uint8_t i, k;
+
+  while(len > 0) {
+    k = pos / REASS_CHUNK_SIZE;
+    while(r->chunk[k] == REASS_NO_CHUNK) {
+      if(uip_reass_free != REASS_NO_CHUNK) {
+        r->chunk[k] = uip_reass_free;
+        uip_reass_free = uip_reass_next[uip_reass_free];
+        break;
+      }
+      oldest = NULL;
+      for(i = 0; i < UIP_REASS_CONTEXTS; i++) {
+        c = &uip_reass_contexts[i];
+        if(c != r && c->hdrlen > 0 && !REASS_DONE(c) &&
+           (oldest == NULL ||
+            (uint16_t)(uip_reass_serial - c->serial) >
+            (uint16_t)(uip_reass_serial - oldest->serial))) {
+          oldest = c;
         }
       }
-      /* Check the last byte in the bitmap. It should contain just the
-         right amount of bits. */
-      if(uip_reassbitmap[uip_reasslen >> 6] !=
-         (uint8_t)~bitmap_bits[(uip_reasslen >> 3) & 7]) {
+      if(oldest == NULL) {
         return 0;
       }
+      PRINTF("Reassembly budget exhausted, discarding the oldest\n");
+      UIP_STAT(++uip_stat.frag.evicted);
+      uip_reass_discard(oldest);
+    }
+    n = REASS_CHUNK_SIZE - pos % REASS_CHUNK_SIZE;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&uip_reass_pool[r->chunk[k]][pos % REASS_CHUNK_SIZE], data, n);
+    pos += n;
+    data += n;
+    len -= n;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Mark bytes of the fragmentable part as received. */
+static void
+uip_reass_mark(struct uip_reass_context *r, uint16_t offset, uint16_t len)
+{
+  uint16_t block, end;
 
-     /* If we have come this far, we have a full packet in the
-         buffer, so we copy it to uip_buf. We also reset the timer. */
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-
-      uip_reasslen += UIP_IPH_LEN + uip_ext_len;
-      memcpy(UIP_IP_BUF, FBUF, uip_reasslen);
-      UIP_IP_BUF->len[0] = ((uip_reasslen - UIP_IPH_LEN) >> 8);
-      UIP_IP_BUF->len[1] = ((uip_reasslen - UIP_IPH_LEN) & 0xff);
-      PRINTF("REASSEMBLED PAQUET %d (%d)\n", uip_reasslen,
-             (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
-   
-      return uip_reasslen;
-      
+  end = (offset + len + 7) >> 3;
+  for(block = offset >> 3; block < end; block++) {
+    if((r->received[block >> 3] & (1 << (block & 7))) == 0) {
+      r->received[block >> 3] |= 1 << (block & 7);
+      r->blocks++;
     }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+uip_reass(void)
+{
+  struct uip_reass_context *r;
+  uint16_t offset;
+  uint16_t len;
+  uint16_t i, n;
+
+  UIP_STAT(++uip_stat.frag.recv);
+  uip_reassflags = 0;
+
+  r = uip_reass_context();
+  if(REASS_DONE(r)) {
+    PRINTF("Fragment of a reassembled packet\n");
+    UIP_STAT(++uip_stat.frag.drop);
+    return 0;
+  }
+
+  /* The unfragmentable part must be the same in all fragments, as it
+     is where the fragment data is put in the reassembled packet. */
+  if(r->hdrlen != uip_ext_len + UIP_IPH_LEN) {
+    PRINTF("Unfragmentable part length mismatch\n");
+    UIP_STAT(++uip_stat.frag.drop);
+    return 0;
+  }
+
+  len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
+  offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
+  /* in byte, originaly in multiple of 8 bytes*/
+  PRINTF("len %d\n", len);
+  PRINTF("offset %d\n", offset);
+
+  /* If the offset or the offset + fragment length overflows the
+     reassembly buffer, we discard the entire packet. */
+  if(offset > UIP_REASS_BUFSIZE - r->hdrlen ||
+     len > UIP_REASS_BUFSIZE - r->hdrlen - offset) {
+    uip_reass_discard(r);
+    UIP_STAT(++uip_stat.frag.drop);
+    return 0;
+  }
+
+  /* If this fragment has the More Fragments flag set to zero, it is the
+     last fragment*/
+  if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
+    r->flags |= UIP_REASS_FLAG_LASTFRAG;
+    /*calculate the size of the entire packet*/
+    r->len = offset + len;
+    PRINTF("LAST FRAGMENT reasslen %d\n", r->len);
   } else {
-    PRINTF("Already reassembling another paquet\n");
+    /* If len is not a multiple of 8 octets and the M flag of that fragment
+       is 1, then that fragment must be discarded and an ICMP Parameter
+       Problem, Code 0, message should be sent to the source of the fragment,
+       pointing to the Payload Length field of the fragment packet. */
+    if(len % 8 != 0){
+      uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
+      uip_reassflags |= UIP_REASS_FLAG_ERROR_MSG;
+      /* not clear if we should interrupt reassembly, but it seems so from
+         the conformance tests */
+      uip_reass_discard(r);
+      UIP_STAT(++uip_stat.frag.drop);
+      return uip_len;
+    }
   }
-  return 0;
+
+  if(offset == 0){
+    /*
+     * The Next Header field of the last header of the Unfragmentable
+     * Part is obtained from the Next Header field of the first
+     * fragment's Fragment header.
+     */
+    *uip_next_hdr = UIP_FRAG_BUF->next;
+    PRINTF("src ");
+    PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
+    PRINTF("dest ");
+    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+    PRINTF("next %d\n", UIP_IP_BUF->proto);
+  }
+
+  /* Copy the unfragmentable part, of the first fragment if we have
+     it, and the fragment into the context, at the right offset. */
+  if((r->flags & UIP_REASS_FLAG_FIRSTFRAG) == 0 &&
+     !uip_reass_copy(r, 0, (uint8_t *)UIP_IP_BUF, r->hdrlen)) {
+    UIP_STAT(++uip_stat.frag.drop);
+    return 0;
+  }
+  if(!uip_reass_copy(r, r->hdrlen + offset,
+                     (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len)) {
+    UIP_STAT(++uip_stat.frag.drop);
+    return 0;
+  }
+  if(offset == 0) {
+    r->flags |= UIP_REASS_FLAG_FIRSTFRAG;
+  }
+  uip_reass_mark(r, offset, len);
+
+  /* Finally, we check if we have a full packet in the context, that
+     is if we have the last fragment and all blocks up to it. */
+  if((r->flags & UIP_REASS_FLAG_LASTFRAG) == 0 ||
+     r->blocks != (r->len + 7) >> 3) {
+    return 0;
+  }
+
+  /* If we have come this far, we have a full packet in the context, so
+     we copy it to uip_buf. */
+  len = r->hdrlen + r->len;
+  for(i = 0; i < len; i += n) {
+    n = len - i < REASS_CHUNK_SIZE ? len - i : REASS_CHUNK_SIZE;
+    memcpy((uint8_t *)UIP_IP_BUF + i,
+           uip_reass_pool[r->chunk[i / REASS_CHUNK_SIZE]], n);
+  }
+  uip_reass_release(r);
+  r->flags |= UIP_REASS_FLAG_DONE;
+  UIP_STAT(++uip_stat.frag.reassembled);
+
+  UIP_IP_BUF->len[0] = ((len - UIP_IPH_LEN) >> 8);
+  UIP_IP_BUF->len[1] = ((len - UIP_IPH_LEN) & 0xff);
+  PRINTF("REASSEMBLED PAQUET %d (%d)\n", len,
+         (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
+
+  return len;
 }
 
 void
 uip_reass_over(void)
 {
-   /* to late, we abandon the reassembly of the packet */
+  struct uip_reass_context *c, *r, *n;
+  clock_time_t next, left;
+  uint8_t i;
+
+  /* One of the reassemblies is too late, we abandon it */
+  uip_len = 0;
+  r = NULL;
+  n = NULL;
+  next = 0;
+  for(i = 0; i < UIP_REASS_CONTEXTS; i++) {
+    c = &uip_reass_contexts[i];
+    if(c->hdrlen == 0 || REASS_DONE(c)) {
+      continue;
+    }
+    left = timer_expired(&c->timer) ? 0 : timer_remaining(&c->timer);
+    if(left == 0 && r == NULL) {
+      r = c;
+    } else if(n == NULL || left < next) {
+      n = c;
+      next = left;
+    }
+  }
 
-  uip_reass_on = 0;
-  etimer_stop(&uip_reass_timer);
+  /* Wait for the next reassembly to be too late, which may already be
+     the case. */
+  if(n != NULL) {
+    etimer_set(&uip_reass_timer, next);
+  } else {
+    etimer_stop(&uip_reass_timer);
+  }
+  if(r == NULL) {
+    return;
+  }
+  UIP_STAT(++uip_stat.frag.timeout);
 
-  if(uip_reassflags & UIP_REASS_FLAG_FIRSTFRAG){
+  if(r->flags & UIP_REASS_FLAG_FIRSTFRAG){
     PRINTF("FRAG INTERRUPTED TOO LATE\n");
     /* If the first fragment has been received, an ICMP Time Exceeded
        -- Fragment Reassembly Time Exceeded message should be sent to the
@@ -824,15 +1172,16 @@ uip_reass_over(void)
      * any RFC, we decided not to include it as it reduces the size of
      * the packet.
      */
-    uip_len = 0;
     uip_ext_len = 0;
-    memcpy(UIP_IP_BUF, FBUF, UIP_IPH_LEN); /* copy the header for src
-                                              and dest address*/
+    memcpy(UIP_IP_BUF, uip_reass_pool[r->chunk[0]], UIP_IPH_LEN); /* copy
+                                              the header for src and dest
+                                              address*/
     uip_icmp6_error_output(ICMP6_TIME_EXCEEDED, ICMP6_TIME_EXCEED_REASSEMBLY, 0);
-    
+
     UIP_STAT(++uip_stat.ip.sent);
     uip_flags = 0;
   }
+  uip_reass_discard(r);
 }
 
 #endif /* UIP_CONF_IPV6_REASSEMBLY */
@@ -848,6 +1197,139 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+/*---------------------------------------------------------------------------*/
+/* Sets the mss of a connection to the amount of new data that its
+   send window can take. */
+static void
+tcp_window_update(struct uip_conn *conn)
+{
+  struct tcp_window *w = TCP_WINDOW(conn);
+  uint16_t wnd;
+
+  wnd = w->snd_wnd;
+  if(wnd == 0 && conn->len == 0) {
+    /* Probe a zero window with a full segment, as uIP does without
+       the window. */
+    wnd = conn->initialmss;
+  }
+  conn->mss = 0;
+  if(w->nseg < UIP_TCP_WINDOW_SEGMENTS && wnd > conn->len) {
+    conn->mss = wnd - conn->len;
+    if(conn->mss > UIP_TCP_WINDOW_BUFSIZE - conn->len) {
+      conn->mss = UIP_TCP_WINDOW_BUFSIZE - conn->len;
+    }
+    if(conn->mss > conn->initialmss) {
+      conn->mss = conn->initialmss;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_window_init(struct uip_conn *conn)
+{
+  struct tcp_window *w = TCP_WINDOW(conn);
+
+  w->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + UIP_TCP_BUF->wnd[1];
+  w->sndlen = 0;
+  w->sndmax = 0;
+  w->nseg = 0;
+  w->nsent = 0;
+  w->close = 0;
+  tcp_window_update(conn);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+tcp_seqno(const uint8_t *seqno)
+{
+  return ((uint32_t)seqno[0] << 24) | ((uint32_t)seqno[1] << 16) |
+    ((uint32_t)seqno[2] << 8) | seqno[3];
+}
+/*---------------------------------------------------------------------------*/
+/* Removes the data that the incoming segment acknowledges from the
+   window. Returns 0 if the segment acknowledges no new data. After a
+   retransmission timeout, the peer may acknowledge data up to the
+   highest sequence number sent before the timeout. */
+static uint8_t
+tcp_window_ack(struct uip_conn *conn)
+{
+  struct tcp_window *w = TCP_WINDOW(conn);
+  uint32_t acked;
+  uint16_t n;
+  uint8_t i;
+
+  acked = tcp_seqno(UIP_TCP_BUF->ackno) - tcp_seqno(conn->snd_nxt);
+  if(acked == 0 || acked > w->sndmax) {
+    return 0;
+  }
+
+  n = acked;
+  uip_add32(conn->snd_nxt, n);
+  memcpy(conn->snd_nxt, uip_acc32, sizeof(conn->snd_nxt));
+  conn->len -= n;
+  w->sndmax -= n;
+  if(n < w->sndlen) {
+    w->sndlen -= n;
+  } else {
+    /* The peer acknowledged data that we have not sent again yet. */
+    w->sndlen = 0;
+  }
+  memmove(w->buf, w->buf + n, conn->len);
+
+  for(i = 0; i < w->nseg && n >= w->seglen[i]; i++) {
+    n -= w->seglen[i];
+  }
+  w->nseg -= i;
+  w->nsent = w->nsent > i ? w->nsent - i : 0;
+  memmove(w->seglen, w->seglen + i, w->nseg * sizeof(w->seglen[0]));
+  if(n > 0) {
+    /* The peer acknowledged part of a segment. */
+    w->seglen[0] -= n;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Adds the data that the application has put into uip_buf to the
+   window, as far as the window can take it. */
+static void
+tcp_window_queue(struct uip_conn *conn)
+{
+  struct tcp_window *w = TCP_WINDOW(conn);
+
+  if(uip_slen > conn->mss) {
+    uip_slen = conn->mss;
+  }
+  if(uip_slen > 0) {
+    memcpy(w->buf + conn->len, uip_sappdata, uip_slen);
+    w->seglen[w->nseg++] = uip_slen;
+    conn->len += uip_slen;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Puts the oldest segment that has not been sent into uip_buf, unless
+   it already is there. Returns its length, or 0 if there is none. */
+static uint16_t
+tcp_window_next(struct uip_conn *conn, uint8_t copy)
+{
+  struct tcp_window *w = TCP_WINDOW(conn);
+  uint16_t len;
+
+  if(w->nsent == w->nseg) {
+    return 0;
+  }
+  len = w->seglen[w->nsent];
+  if(copy) {
+    memcpy(uip_sappdata, w->buf + w->sndlen, len);
+  }
+  tcp_snd_offset = w->sndlen;
+  w->sndlen += len;
+  if(w->sndlen > w->sndmax) {
+    w->sndmax = w->sndlen;
+  }
+  w->nsent++;
+  return len;
+}
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
 #endif
 /*---------------------------------------------------------------------------*/
 
@@ -953,7 +1435,7 @@ uip_process(uint8_t flag)
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       TCP_CAN_SEND(uip_connr)) {
       uip_flags = UIP_POLL;
       UIP_APPCALL();
       goto appsend;
@@ -1049,6 +1531,18 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
                      
             case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+              /*
+               * With the send window, we go back to the oldest
+               * unacknowledged segment and send the segments again
+               * from the retransmission buffer.
+               */
+              TCP_WINDOW(uip_connr)->nsent = 0;
+              TCP_WINDOW(uip_connr)->sndlen = 0;
+              uip_len = tcp_window_next(uip_connr, 1) + UIP_TCPIP_HLEN;
+              UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+              goto tcp_send_noopts;
+#else /* UIP_TCP_WINDOW_SEGMENTS > 1 */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1058,6 +1552,7 @@ uip_process(uint8_t flag)
               uip_flags = UIP_REXMIT;
               UIP_APPCALL();
               goto apprexmit;
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
                      
             case UIP_FIN_WAIT_1:
             case UIP_CLOSING:
@@ -1066,7 +1561,9 @@ uip_process(uint8_t flag)
               goto tcp_send_finack;
           }
         }
-      } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+         TCP_CAN_SEND(uip_connr)) {
         /*
          * If there was no need for a retransmission, we poll the
          * application for new data.
@@ -1504,9 +2001,15 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONN_HASH_SIZE
+  for(conn_hash_i = udp_hash[CONN_HASH(UIP_UDP_BUF->destport)];
+      conn_hash_i != CONN_HASH_END; conn_hash_i = udp_hash_next[conn_hash_i]) {
+    uip_udp_conn = &uip_udp_conns[conn_hash_i];
+#else /* UIP_CONN_HASH_SIZE */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
+#endif /* UIP_CONN_HASH_SIZE */
     /* If the local UDP port is non-zero, the connection is considered
        to be used. If so, the local port number is checked against the
        destination port number in the received packet. If the two port
@@ -1613,8 +2116,15 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONN_HASH_SIZE
+  for(conn_hash_i = tcp_hash[CONN_HASH(UIP_TCP_BUF->destport ^
+                                       UIP_TCP_BUF->srcport)];
+      conn_hash_i != CONN_HASH_END; conn_hash_i = tcp_hash_next[conn_hash_i]) {
+    uip_connr = &uip_conns[conn_hash_i];
+#else /* UIP_CONN_HASH_SIZE */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
+#endif /* UIP_CONN_HASH_SIZE */
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
        UIP_TCP_BUF->destport == uip_connr->lport &&
        UIP_TCP_BUF->srcport == uip_connr->rport &&
@@ -1734,8 +2244,12 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_CONN_HASH_SIZE
+  tcp_set_ports(uip_connr, UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport);
+#else /* UIP_CONN_HASH_SIZE */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
+#endif /* UIP_CONN_HASH_SIZE */
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
 
@@ -1862,18 +2376,32 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
-    uip_add32(uip_connr->snd_nxt, uip_connr->len);
-
-    if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
-       UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
-       UIP_TCP_BUF->ackno[2] == uip_acc32[2] &&
-       UIP_TCP_BUF->ackno[3] == uip_acc32[3]) {
-      /* Update sequence number. */
-      uip_connr->snd_nxt[0] = uip_acc32[0];
-      uip_connr->snd_nxt[1] = uip_acc32[1];
-      uip_connr->snd_nxt[2] = uip_acc32[2];
-      uip_connr->snd_nxt[3] = uip_acc32[3];
-   
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+    if(TCP_WINDOW(uip_connr)->nseg > 0) {
+      /* With segments in the send window, any new data may be
+         acknowledged. */
+      c = tcp_window_ack(uip_connr);
+    } else
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
+    {
+      uip_add32(uip_connr->snd_nxt, uip_connr->len);
+      c = UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
+        UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
+        UIP_TCP_BUF->ackno[2] == uip_acc32[2] &&
+        UIP_TCP_BUF->ackno[3] == uip_acc32[3];
+      if(c) {
+        /* Update sequence number. */
+        uip_connr->snd_nxt[0] = uip_acc32[0];
+        uip_connr->snd_nxt[1] = uip_acc32[1];
+        uip_connr->snd_nxt[2] = uip_acc32[2];
+        uip_connr->snd_nxt[3] = uip_acc32[3];
+
+        /* Reset length of outstanding data. */
+        uip_connr->len = 0;
+      }
+    }
+
+    if(c) {
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
         signed char m;
@@ -1893,9 +2421,9 @@ uip_process(uint8_t flag)
       uip_flags = UIP_ACKDATA;
       /* Reset the retransmission timer. */
       uip_connr->timer = uip_connr->rto;
-
-      /* Reset length of outstanding data. */
-      uip_connr->len = 0;
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+      uip_connr->nrtx = 0;
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
     }
     
   }
@@ -1915,6 +2443,9 @@ uip_process(uint8_t flag)
         uip_connr->tcpstateflags = UIP_ESTABLISHED;
         uip_flags = UIP_CONNECTED;
         uip_connr->len = 0;
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+        tcp_window_init(uip_connr);
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
         if(uip_len > 0) {
           uip_flags |= UIP_NEWDATA;
           uip_add_rcv_nxt(uip_len);
@@ -1977,6 +2508,9 @@ uip_process(uint8_t flag)
         uip_add_rcv_nxt(1);
         uip_flags = UIP_CONNECTED | UIP_NEWDATA;
         uip_connr->len = 0;
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+        tcp_window_init(uip_connr);
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
         uip_len = 0;
         uip_slen = 0;
         UIP_APPCALL();
@@ -2064,11 +2598,18 @@ uip_process(uint8_t flag)
          "persistent timer" and uses the retransmission mechanim.
       */
       tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+      /* With the send window, the mss is the amount of new data that
+         the window can take. */
+      TCP_WINDOW(uip_connr)->snd_wnd = tmp16;
+      tcp_window_update(uip_connr);
+#else /* UIP_TCP_WINDOW_SEGMENTS > 1 */
       if(tmp16 > uip_connr->initialmss ||
          tmp16 == 0) {
         tmp16 = uip_connr->initialmss;
       }
       uip_connr->mss = tmp16;
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
 
       /* If this packet constitutes an ACK for outstanding data (flagged
          by the UIP_ACKDATA flag, we should call the application since it
@@ -2099,6 +2640,25 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+        /* Data that the application sends with uip_close() goes out
+           before the FIN, which waits until all data has been
+           acknowledged. */
+        if(TCP_WINDOW(uip_connr)->close) {
+          uip_slen = 0;
+        } else {
+          tcp_window_queue(uip_connr);
+        }
+        if(uip_flags & UIP_CLOSE) {
+          TCP_WINDOW(uip_connr)->close = 1;
+        }
+        if(TCP_WINDOW(uip_connr)->close && TCP_WINDOW(uip_connr)->nseg == 0) {
+          uip_flags |= UIP_CLOSE;
+        } else {
+          uip_flags &= ~UIP_CLOSE;
+        }
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
+
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
           uip_connr->len = 1;
@@ -2108,6 +2668,26 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+        /* Send the oldest segment that has not been sent. If that is
+           the one that the application just sent, it is in uip_buf
+           already. */
+        uip_appdata = uip_sappdata;
+        c = uip_slen > 0 &&
+          TCP_WINDOW(uip_connr)->nsent + 1 == TCP_WINDOW(uip_connr)->nseg;
+        uip_slen = tcp_window_next(uip_connr, !c);
+        tcp_window_update(uip_connr);
+        if(uip_slen > 0) {
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+        if(uip_flags & UIP_NEWDATA) {
+          uip_len = UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK;
+          goto tcp_send_noopts;
+        }
+#else /* UIP_TCP_WINDOW_SEGMENTS > 1 */
         /* If uip_slen > 0, the application has data to be sent. */
         if(uip_slen > 0) {
 
@@ -2161,6 +2741,7 @@ uip_process(uint8_t flag)
           UIP_TCP_BUF->flags = TCP_ACK;
           goto tcp_send_noopts;
         }
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
       }
       goto drop;
     case UIP_LAST_ACK:
@@ -2258,6 +2839,16 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
 
+#if UIP_TCP_WINDOW_SEGMENTS > 1
+  if(TCP_WINDOW(uip_connr)->nseg > 0) {
+    /* Data segments start at their offset in the send window. Other
+       segments carry the sequence number after the data sent. */
+    uip_add32(uip_connr->snd_nxt, uip_len > UIP_TCPIP_HLEN ?
+              tcp_snd_offset : TCP_WINDOW(uip_connr)->sndlen);
+    memcpy(UIP_TCP_BUF->seqno, uip_acc32, sizeof(UIP_TCP_BUF->seqno));
+  }
+#endif /* UIP_TCP_WINDOW_SEGMENTS > 1 */
+
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
 
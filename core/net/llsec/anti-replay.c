@@ -33,7 +33,8 @@
 /**
  * \file
  *         Protects against replay attacks by comparing with the last
- *         unicast or broadcast frame counter of the sender.
+ *         unicast or broadcast frame counter of the sender, or with a
+ *         window of recently received frame counters.
  * \author
  *         Konrad Krentz <konrad.krentz@gmail.com>
  */
@@ -78,8 +79,53 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW
+  /* Frames below the first counter are taken for replays, as without
+     window */
+  info->broadcast_window = info->unicast_window = ~(anti_replay_window_t)0;
+#endif /* ANTI_REPLAY_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW
+static int
+was_replayed(uint32_t received_counter,
+    uint32_t *last_counter,
+    anti_replay_window_t *window)
+{
+  uint32_t distance;
+  
+  if(received_counter > *last_counter) {
+    /* slide the window up to the received counter */
+    distance = received_counter - *last_counter;
+    if(distance < ANTI_REPLAY_WINDOW) {
+      *window = (*window << distance) | 1;
+    } else {
+      *window = 1;
+    }
+    *last_counter = received_counter;
+    return 0;
+  }
+  
+  distance = *last_counter - received_counter;
+  if((distance >= ANTI_REPLAY_WINDOW)
+      || (*window & ((anti_replay_window_t)1 << distance))) {
+    return 1;
+  }
+  *window |= (anti_replay_window_t)1 << distance;
+  return 0;
+}
+#else /* ANTI_REPLAY_WINDOW */
+static int
+was_replayed(uint32_t received_counter, uint32_t *last_counter)
+{
+  if(received_counter <= *last_counter) {
+    return 1;
+  }
+  *last_counter = received_counter;
+  return 0;
+}
+#endif /* ANTI_REPLAY_WINDOW */
+/*---------------------------------------------------------------------------*/
 int
 anti_replay_was_replayed(struct anti_replay_info *info)
 {
@@ -89,20 +135,20 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   if(packetbuf_holds_broadcast()) {
     /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW
+    return was_replayed(received_counter,
+        &info->last_broadcast_counter, &info->broadcast_window);
+#else /* ANTI_REPLAY_WINDOW */
+    return was_replayed(received_counter, &info->last_broadcast_counter);
+#endif /* ANTI_REPLAY_WINDOW */
   } else {
     /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW
+    return was_replayed(received_counter,
+        &info->last_unicast_counter, &info->unicast_window);
+#else /* ANTI_REPLAY_WINDOW */
+    return was_replayed(received_counter, &info->last_unicast_counter);
+#endif /* ANTI_REPLAY_WINDOW */
   }
 }
 /*---------------------------------------------------------------------------*/
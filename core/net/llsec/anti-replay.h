@@ -47,9 +47,34 @@
 
 #include "contiki.h"
 
+/*
+ * Number of frame counters below the highest one received that are
+ * still accepted if not received before, so that reordered frames
+ * are not taken for replays. 0, 32 or 64. With 0, only frames with a
+ * higher counter than the last one received are accepted.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW
+#define ANTI_REPLAY_WINDOW ANTI_REPLAY_CONF_WINDOW
+#else /* ANTI_REPLAY_CONF_WINDOW */
+#define ANTI_REPLAY_WINDOW 0
+#endif /* ANTI_REPLAY_CONF_WINDOW */
+
+#if ANTI_REPLAY_WINDOW == 64
+typedef uint64_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW == 32
+typedef uint32_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW
+#error "ANTI_REPLAY_CONF_WINDOW must be 0, 32 or 64"
+#endif /* ANTI_REPLAY_WINDOW */
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW
+  /* Bit i is set if counter last_..._counter - i was received */
+  anti_replay_window_t broadcast_window;
+  anti_replay_window_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW */
 };
 
 /**
@@ -48,6 +48,8 @@
 #include "lib/aes-128.h"
 #include <string.h>
 
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
 /*---------------------------------------------------------------------------*/
 static void
 set_nonce(uint8_t *nonce,
@@ -69,31 +71,60 @@ set_nonce(uint8_t *nonce,
   nonce[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* Turns the first block of the CBC-MAC into the counter block A_0 */
+static void
+set_counter_block(uint8_t *a, const uint8_t *b_0)
+{
+  memcpy(a, b_0, AES_128_BLOCK_SIZE);
+  a[0] = CCM_STAR_ENCRYPTION_FLAGS;
+  a[15] = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* XORs m[0] ... m[m_len - 1], m_len <= 16, with K_{counter} */
 static void
-ctr_step(const uint8_t *extended_source_address,
-    uint8_t pos,
+ctr_step(const uint8_t *a_0,
+    uint8_t counter,
     uint8_t *m_and_result,
-    uint8_t m_len,
-    uint8_t counter)
+    uint8_t m_len)
 {
   uint8_t a[AES_128_BLOCK_SIZE];
   uint8_t i;
   
-  set_nonce(a, CCM_STAR_ENCRYPTION_FLAGS, extended_source_address, counter);
+  memcpy(a, a_0, AES_128_BLOCK_SIZE);
+  a[15] = counter;
   AES_128.encrypt(a);
   
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
+  for(i = 0; i < m_len; i++) {
+    m_and_result[i] ^= a[i];
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Feeds m[0] ... m[m_len - 1], m_len <= 16, into the CBC-MAC */
 static void
-mic(const uint8_t *extended_source_address,
+mic_step(uint8_t *x, const uint8_t *m, uint8_t m_len)
+{
+  uint8_t i;
+  
+  for(i = 0; i < m_len; i++) {
+    x[i] ^= m[i];
+  }
+  AES_128.encrypt(x);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Generates the MIC and, unless only_mic is set, en- or decrypts the
+ * payload in the same pass. Both the CBC-MAC and the counter blocks
+ * are derived from a single nonce.
+ */
+static void
+process(const uint8_t *extended_source_address,
     uint8_t *result,
-    uint8_t mic_len)
+    uint8_t mic_len,
+    int only_mic,
+    int forward)
 {
   uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t a_0[AES_128_BLOCK_SIZE];
   uint8_t pos;
   uint8_t i;
   uint8_t a_len;
@@ -101,6 +132,7 @@ mic(const uint8_t *extended_source_address,
 #if LLSEC802154_USES_ENCRYPTION
   uint8_t shall_encrypt;
   uint8_t m_len;
+  uint8_t block_len;
   uint8_t *m;
   
   shall_encrypt = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) & (1 << 2);
@@ -122,6 +154,7 @@ mic(const uint8_t *extended_source_address,
       extended_source_address,
       0);
 #endif /* LLSEC802154_USES_ENCRYPTION */
+  set_counter_block(a_0, x);
   AES_128.encrypt(x);
   
   a = packetbuf_hdrptr();
@@ -135,11 +168,8 @@ mic(const uint8_t *extended_source_address,
     
     pos = 14;
     while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
+      mic_step(x, a + pos, MIN(a_len - pos, AES_128_BLOCK_SIZE));
       pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
     }
   }
   
@@ -148,42 +178,66 @@ mic(const uint8_t *extended_source_address,
     m = a + a_len;
     pos = 0;
     while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
+      block_len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+      if(only_mic) {
+        mic_step(x, m + pos, block_len);
+      } else if(forward) {
+        mic_step(x, m + pos, block_len);
+        ctr_step(a_0, (pos >> 4) + 1, m + pos, block_len);
+      } else {
+        ctr_step(a_0, (pos >> 4) + 1, m + pos, block_len);
+        mic_step(x, m + pos, block_len);
       }
       pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
     }
   }
 #endif /* LLSEC802154_USES_ENCRYPTION */
   
-  ctr_step(extended_source_address, 0, x, AES_128_BLOCK_SIZE, 0);
+  ctr_step(a_0, 0, x, mic_len);
   
   memcpy(result, x, mic_len);
 }
 /*---------------------------------------------------------------------------*/
 static void
+mic(const uint8_t *extended_source_address,
+    uint8_t *result,
+    uint8_t mic_len)
+{
+  process(extended_source_address, result, mic_len, 1, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
 ctr(const uint8_t *extended_source_address)
 {
+  uint8_t a_0[AES_128_BLOCK_SIZE];
   uint8_t m_len;
   uint8_t *m;
   uint8_t pos;
-  uint8_t counter;
   
   m_len = packetbuf_datalen();
   m = (uint8_t *) packetbuf_dataptr();
   
+  set_nonce(a_0, CCM_STAR_ENCRYPTION_FLAGS, extended_source_address, 0);
   pos = 0;
-  counter = 1;
   while(pos < m_len) {
-    ctr_step(extended_source_address, pos, m, m_len, counter++);
+    ctr_step(a_0, (pos >> 4) + 1, m + pos, MIN(m_len - pos, AES_128_BLOCK_SIZE));
     pos += AES_128_BLOCK_SIZE;
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+aead(const uint8_t *extended_source_address,
+    uint8_t *result,
+    uint8_t mic_len,
+    int forward)
+{
+  process(extended_source_address, result, mic_len, 0, forward);
+}
+/*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
   mic,
-  ctr
+  ctr,
+  aead
 };
 /*---------------------------------------------------------------------------*/
 
@@ -76,6 +76,22 @@ struct ccm_star_driver {
    * \brief XORs the frame in the packetbuf with the key stream.
    */
   void (* ctr)(const uint8_t *extended_source_address);
+  
+  /**
+   * \brief         Generates a MIC over the frame in the packetbuf and
+   *                XORs the frame with the key stream in a single pass.
+   * \param result  The generated MIC will be put here
+   * \param mic_len  <= 16; set to LLSEC802154_MIC_LENGTH to be compliant
+   * \param forward 1 when securing an outgoing frame, 0 when unsecuring
+   *                an incoming one
+   *
+   *                Same as calling mic() and then ctr() when forward is
+   *                set, and ctr() and then mic() otherwise.
+   */
+  void (* aead)(const uint8_t *extended_source_address,
+      uint8_t *result,
+      uint8_t mic_len,
+      int forward);
 };
 
 extern const struct ccm_star_driver CCM_STAR;
@@ -62,6 +62,22 @@
 
 typedef void (* llsec_on_bootstrapped_t)(void);
 
+/*
+ * LLSEC_CONF_INPUT_CALLBACK names a function that LLSEC drivers call
+ * for each incoming frame they pass to NETSTACK_NETWORK, i.e., once
+ * the frame is authentic and fresh. The bulk mode of ContikiMAC uses
+ * it, so that forged or replayed frames do not keep the radio on.
+ */
+#ifdef LLSEC_CONF_INPUT_CALLBACK
+#define LLSEC_INPUT_CALLBACK LLSEC_CONF_INPUT_CALLBACK
+#elif CONTIKIMAC_CONF_BULK
+#define LLSEC_INPUT_CALLBACK contikimac_bulk_input
+#endif
+
+#ifdef LLSEC_INPUT_CALLBACK
+void LLSEC_INPUT_CALLBACK(void);
+#endif /* LLSEC_INPUT_CALLBACK */
+
 /**
  * The structure of a link layer security driver.
  */
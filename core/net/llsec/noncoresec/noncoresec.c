@@ -54,8 +54,6 @@
 #include "lib/aes-128.h"
 #include <string.h>
 
-#define WITH_ENCRYPTION (LLSEC802154_SECURITY_LEVEL & (1 << 2))
-
 #ifdef NONCORESEC_CONF_KEY
 #define NONCORESEC_KEY NONCORESEC_CONF_KEY
 #else /* NONCORESEC_CONF_KEY */
@@ -116,10 +114,7 @@ on_frame_created(void)
   dataptr = packetbuf_dataptr();
   data_len = packetbuf_datalen();
   
-  CCM_STAR.mic(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH);
-#if WITH_ENCRYPTION
-  CCM_STAR.ctr(get_extended_address(&linkaddr_node_addr));
-#endif /* WITH_ENCRYPTION */
+  CCM_STAR.aead(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH, 1);
   packetbuf_set_datalen(data_len + LLSEC802154_MIC_LENGTH);
   
   return 1;
@@ -145,10 +140,7 @@ input(void)
   
   packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
   
-#if WITH_ENCRYPTION
-  CCM_STAR.ctr(get_extended_address(sender));
-#endif /* WITH_ENCRYPTION */
-  CCM_STAR.mic(get_extended_address(sender), generated_mic, LLSEC802154_MIC_LENGTH);
+  CCM_STAR.aead(get_extended_address(sender), generated_mic, LLSEC802154_MIC_LENGTH, 0);
   
   received_mic = ((uint8_t *) packetbuf_dataptr()) + packetbuf_datalen();
   if(memcmp(generated_mic, received_mic, LLSEC802154_MIC_LENGTH) != 0) {
@@ -191,6 +183,9 @@ input(void)
     }
   }
   
+#ifdef LLSEC_INPUT_CALLBACK
+  LLSEC_INPUT_CALLBACK();
+#endif /* LLSEC_INPUT_CALLBACK */
   NETSTACK_NETWORK.input();
 }
 /*---------------------------------------------------------------------------*/
@@ -70,6 +70,9 @@ on_frame_created(void)
 static void
 input(void)
 {
+#ifdef LLSEC_INPUT_CALLBACK
+  LLSEC_INPUT_CALLBACK();
+#endif /* LLSEC_INPUT_CALLBACK */
   NETSTACK_NETWORK.input();
 }
 /*---------------------------------------------------------------------------*/
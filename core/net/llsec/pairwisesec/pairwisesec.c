@@ -0,0 +1,653 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ *
+ *         Neighbors agree on a session key in a three-way handshake.
+ *         A node broadcasts a HELLO with a random challenge. A neighbor
+ *         answers with a HELLOACK that carries its own challenge. The
+ *         node then confirms with an ACK. The session key is the
+ *         concatenation of both challenges, encrypted with the secret
+ *         that the two neighbors share. The secret is the concatenation
+ *         of their extended addresses, the smaller one first, encrypted
+ *         with the master key. HELLOs are secured with the network key,
+ *         which is derived from the master key, HELLOACKs and ACKs with
+ *         the new session key. An established session key replaces the
+ *         previous one only once the handshake is complete.
+ *
+ *         Each node picks a random group key at bootstrap, with which it
+ *         secures its broadcast frames. HELLOACKs and ACKs hand it over,
+ *         masked with the new session key.
+ *
+ *         Each handshake yields keys that were never used before, so
+ *         the frame counters of a neighbor start anew with them. Frames
+ *         recorded under an earlier session, e.g., before a reboot, do
+ *         not authenticate under the new keys.
+ *
+ *         The master key is erased PAIRWISESEC_CONF_MASTER_KEY_LIFETIME
+ *         after bootstrapping, as in LEAP, also from the AES driver. From then on, the node keeps
+ *         the secrets of the neighbors it has met by then, with which it
+ *         can still renew session keys, but accepts no new neighbors.
+ *
+ *         Neighbor table entries hold the secret, the session key and
+ *         the frame counters of a neighbor. An entry is only created
+ *         for a HELLO or a HELLOACK, never evicts other neighbors before
+ *         the handshake is complete, and is locked thereafter. Frames to
+ *         and from neighbors without a session key are dropped, and
+ *         make the node send a HELLO, at most once per
+ *         PAIRWISESEC_CONF_HELLO_INTERVAL.
+ *
+ *         Challenges and group keys come from random_rand(). They are
+ *         only fresh across reboots if the platform seeds random_init()
+ *         with values that differ from boot to boot.
+ *
+ *         Setting a key is skipped when the AES driver already holds
+ *         it. To also avoid expanding the keys of a few neighbors over
+ *         and over when frames to them alternate, use
+ *         aes_128_ttable_driver with AES_128_TTABLE_CONF_CACHED_KEYS.
+ */
+
+/**
+ * \addtogroup pairwisesec
+ * @{
+ */
+
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/ccm-star.h"
+#include "net/mac/frame802154.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/nbr-table.h"
+#include "net/linkaddr.h"
+#include "lib/aes-128.h"
+#include "lib/random.h"
+#include "sys/ctimer.h"
+#include <string.h>
+
+#ifdef PAIRWISESEC_CONF_MASTER_KEY
+#define PAIRWISESEC_MASTER_KEY PAIRWISESEC_CONF_MASTER_KEY
+#else /* PAIRWISESEC_CONF_MASTER_KEY */
+#define PAIRWISESEC_MASTER_KEY { 0x00 , 0x01 , 0x02 , 0x03 , \
+                                 0x04 , 0x05 , 0x06 , 0x07 , \
+                                 0x08 , 0x09 , 0x0A , 0x0B , \
+                                 0x0C , 0x0D , 0x0E , 0x0F }
+#endif /* PAIRWISESEC_CONF_MASTER_KEY */
+
+/* How long the master key is kept after bootstrapping, 0 for ever */
+#ifdef PAIRWISESEC_CONF_MASTER_KEY_LIFETIME
+#define MASTER_KEY_LIFETIME PAIRWISESEC_CONF_MASTER_KEY_LIFETIME
+#else /* PAIRWISESEC_CONF_MASTER_KEY_LIFETIME */
+#define MASTER_KEY_LIFETIME (60 * CLOCK_SECOND)
+#endif /* PAIRWISESEC_CONF_MASTER_KEY_LIFETIME */
+
+/* The minimum time between two HELLOs */
+#ifdef PAIRWISESEC_CONF_HELLO_INTERVAL
+#define HELLO_INTERVAL PAIRWISESEC_CONF_HELLO_INTERVAL
+#else /* PAIRWISESEC_CONF_HELLO_INTERVAL */
+#define HELLO_INTERVAL (5 * CLOCK_SECOND)
+#endif /* PAIRWISESEC_CONF_HELLO_INTERVAL */
+
+#define SECURITY_HEADER_LENGTH 5
+#define CHALLENGE_LENGTH 8
+#define HELLO_LENGTH (1 + CHALLENGE_LENGTH)
+#define HELLOACK_LENGTH (1 + CHALLENGE_LENGTH + AES_128_KEY_LENGTH)
+#define ACK_LENGTH (1 + AES_128_KEY_LENGTH)
+/* Commands are not encrypted, since the key of a HELLOACK depends on
+   its payload. Group keys are masked instead. */
+#define COMMAND_SECURITY_LEVEL LLSEC802154_SECURITY_LEVEL_MIC
+
+/* Command frame identifiers of the handshake */
+#define HELLO_IDENTIFIER    0x0A
+#define HELLOACK_IDENTIFIER 0x0B
+#define ACK_IDENTIFIER      0x0C
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+struct neighbor {
+  struct anti_replay_info anti_replay_info;
+  /* secret from which the session keys are derived */
+  uint8_t secret[AES_128_KEY_LENGTH];
+  /* session key, valid if established is set */
+  uint8_t key[AES_128_KEY_LENGTH];
+  /* session key sent in a HELLOACK, valid if pending is set */
+  uint8_t pending_key[AES_128_KEY_LENGTH];
+  /* key of the neighbor's broadcast frames, valid if established is set */
+  uint8_t group_key[AES_128_KEY_LENGTH];
+  uint8_t established;
+  uint8_t pending;
+};
+
+/* key from which all other keys are derived, until erased */
+static uint8_t master_key[AES_128_KEY_LENGTH] = PAIRWISESEC_MASTER_KEY;
+static uint8_t has_master_key = 1;
+/* key of HELLOs */
+static uint8_t network_key[AES_128_KEY_LENGTH];
+/* key of this node's broadcast frames */
+static uint8_t group_key[AES_128_KEY_LENGTH];
+/* key that AES_128 currently holds, NULL if unknown */
+static uint8_t *current_key;
+/* challenge of the last HELLO, valid if hello_sent is set */
+static uint8_t hello_challenge[CHALLENGE_LENGTH];
+static uint8_t hello_sent;
+static struct ctimer hello_timer;
+static struct timer hello_holdoff;
+#if MASTER_KEY_LIFETIME
+static struct ctimer erase_timer;
+#endif /* MASTER_KEY_LIFETIME */
+NBR_TABLE(struct neighbor, neighbors);
+
+/*---------------------------------------------------------------------------*/
+static const uint8_t *
+get_extended_address(const linkaddr_t *addr)
+#if LINKADDR_SIZE == 2
+{
+  /* workaround for short addresses: derive EUI64 as in RFC 6282 */
+  static linkaddr_extended_t template = { { 0x00 , 0x00 , 0x00 ,
+                                            0xFF , 0xFE , 0x00 , 0x00 , 0x00 } };
+  
+  template.u16[3] = LLSEC802154_HTONS(addr->u16);
+  
+  return template.u8;
+}
+#else /* LINKADDR_SIZE == 2 */
+{
+  return addr->u8;
+}
+#endif /* LINKADDR_SIZE == 2 */
+/*---------------------------------------------------------------------------*/
+static void
+use_key(uint8_t *key)
+{
+  if(key != current_key) {
+    AES_128.set_key(key);
+    current_key = key;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+use_temporary_key(uint8_t *key)
+{
+  AES_128.set_key(key);
+  current_key = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Encrypts block with the master key to derive a key */
+static void
+derive_key(uint8_t *block)
+{
+  use_key(master_key);
+  AES_128.encrypt(block);
+}
+/*---------------------------------------------------------------------------*/
+/* Gets the secret shared with addr, from n if known. Returns 0 if the
+   master key is already erased and the secret is not known. */
+static int
+get_secret(uint8_t *secret, const linkaddr_t *addr, struct neighbor *n)
+{
+  const linkaddr_t *first;
+  const linkaddr_t *second;
+  
+  if(n) {
+    memcpy(secret, n->secret, AES_128_KEY_LENGTH);
+    return 1;
+  }
+  if(!has_master_key) {
+    return 0;
+  }
+  
+  if(memcmp(addr->u8, linkaddr_node_addr.u8, LINKADDR_SIZE) < 0) {
+    first = addr;
+    second = &linkaddr_node_addr;
+  } else {
+    first = &linkaddr_node_addr;
+    second = addr;
+  }
+  memcpy(secret, get_extended_address(first), 8);
+  memcpy(secret + 8, get_extended_address(second), 8);
+  derive_key(secret);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Derives a session key from the challenges of a handshake */
+static void
+derive_session_key(uint8_t *key, uint8_t *secret,
+                   const uint8_t *initiator_challenge,
+                   const uint8_t *responder_challenge)
+{
+  memcpy(key, initiator_challenge, CHALLENGE_LENGTH);
+  memcpy(key + CHALLENGE_LENGTH, responder_challenge, CHALLENGE_LENGTH);
+  use_temporary_key(secret);
+  AES_128.encrypt(key);
+}
+/*---------------------------------------------------------------------------*/
+/* XORs a group key with a pad that is derived from the session key.
+   The initiator and the responder use different pads. */
+static void
+mask_group_key(uint8_t *dst, const uint8_t *src,
+               uint8_t *session_key, uint8_t identifier)
+{
+  uint8_t pad[AES_128_KEY_LENGTH];
+  uint8_t i;
+  
+  memset(pad, 0, AES_128_KEY_LENGTH);
+  pad[0] = identifier;
+  use_temporary_key(session_key);
+  AES_128.encrypt(pad);
+  for(i = 0; i < AES_128_KEY_LENGTH; i++) {
+    dst[i] = src[i] ^ pad[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate_random_bytes(uint8_t *bytes, uint8_t len)
+{
+  uint16_t r;
+  uint8_t i;
+  
+  for(i = 0; i < len; i += 2) {
+    r = random_rand();
+    bytes[i] = r >> 8;
+    bytes[i + 1] = r;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Makes the session key and the group key of n valid, once the
+   handshake is complete */
+static int
+establish(struct neighbor *n, uint8_t *key,
+          const uint8_t *masked_group_key, uint8_t identifier)
+{
+  if(!nbr_table_lock(neighbors, n)) {
+    nbr_table_remove(neighbors, n);
+    PRINTF("pairwisesec: could not lock\n");
+    return 0;
+  }
+  memcpy(n->key, key, AES_128_KEY_LENGTH);
+  mask_group_key(n->group_key, masked_group_key, key, identifier);
+  n->established = 1;
+  n->pending = 0;
+  /* The key is new, so only frames after the one that completed the
+     handshake are fresh */
+  anti_replay_init_info(&n->anti_replay_info);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Prepares a command frame, whose payload the caller fills in */
+static uint8_t *
+prepare_command(uint8_t identifier, uint8_t len)
+{
+  uint8_t *dataptr;
+  
+  packetbuf_clear();
+  dataptr = packetbuf_dataptr();
+  dataptr[0] = identifier;
+  packetbuf_set_datalen(len);
+  return dataptr + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_command(const linkaddr_t *receiver)
+{
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, receiver);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_CMDFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, COMMAND_SECURITY_LEVEL);
+  anti_replay_set_counter();
+  NETSTACK_MAC.send(NULL, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_hello(void *ptr)
+{
+  timer_set(&hello_holdoff, HELLO_INTERVAL);
+  generate_random_bytes(hello_challenge, CHALLENGE_LENGTH);
+  hello_sent = 1;
+  memcpy(prepare_command(HELLO_IDENTIFIER, HELLO_LENGTH),
+         hello_challenge, CHALLENGE_LENGTH);
+  send_command(&linkaddr_null);
+}
+/*---------------------------------------------------------------------------*/
+/* Schedules a HELLO, as soon as HELLO_INTERVAL allows */
+static void
+request_hello(void)
+{
+  if(!ctimer_expired(&hello_timer)) {
+    return;
+  }
+  ctimer_set(&hello_timer,
+             timer_expired(&hello_holdoff) ? 0 : timer_remaining(&hello_holdoff),
+             send_hello, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#if MASTER_KEY_LIFETIME
+static void
+erase_master_key(void *ptr)
+{
+  /* The AES driver may keep the key or its round keys, too */
+  AES_128.forget_key(master_key);
+  current_key = NULL;
+  memset(master_key, 0, AES_128_KEY_LENGTH);
+  has_master_key = 0;
+  PRINTF("pairwisesec: erased the master key\n");
+}
+#endif /* MASTER_KEY_LIFETIME */
+/*---------------------------------------------------------------------------*/
+static int
+is_command(uint8_t identifier)
+{
+  return packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_CMDFRAME
+      && packetbuf_datalen() > 0
+      && ((uint8_t *)packetbuf_dataptr())[0] == identifier;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, LLSEC802154_SECURITY_LEVEL);
+  anti_replay_set_counter();
+  NETSTACK_MAC.send(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+on_frame_created(void)
+{
+  struct neighbor *n;
+  uint8_t *dataptr;
+  uint8_t data_len;
+  
+  if(packetbuf_holds_broadcast()) {
+    use_key(is_command(HELLO_IDENTIFIER) ? network_key : group_key);
+  } else {
+    n = nbr_table_get_from_lladdr(neighbors,
+        packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(is_command(HELLOACK_IDENTIFIER)) {
+      if(!n || !n->pending) {
+        return 0;
+      }
+      use_key(n->pending_key);
+    } else {
+      if(!n || !n->established) {
+        PRINTF("pairwisesec: no session key with the receiver\n");
+        request_hello();
+        return 0;
+      }
+      use_key(n->key);
+    }
+  }
+  
+  dataptr = packetbuf_dataptr();
+  data_len = packetbuf_datalen();
+  
+  CCM_STAR.aead(get_extended_address(&linkaddr_node_addr), dataptr + data_len, LLSEC802154_MIC_LENGTH, 1);
+  packetbuf_set_datalen(data_len + LLSEC802154_MIC_LENGTH);
+  
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Checks the MIC of the received frame with the key AES_128 holds */
+static int
+is_authentic(const linkaddr_t *sender)
+{
+  uint8_t generated_mic[LLSEC802154_MIC_LENGTH];
+  uint8_t *received_mic;
+  
+  CCM_STAR.aead(get_extended_address(sender), generated_mic, LLSEC802154_MIC_LENGTH, 0);
+  
+  received_mic = ((uint8_t *) packetbuf_dataptr()) + packetbuf_datalen();
+  if(memcmp(generated_mic, received_mic, LLSEC802154_MIC_LENGTH) != 0) {
+    PRINTF("pairwisesec: received nonauthentic frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+on_hello(const linkaddr_t *sender, const uint8_t *challenge)
+{
+  uint8_t secret[AES_128_KEY_LENGTH];
+  uint8_t responder_challenge[CHALLENGE_LENGTH];
+  struct neighbor *n;
+  uint8_t *payload;
+  
+  use_key(network_key);
+  if(!is_authentic(sender)) {
+    return;
+  }
+  
+  n = nbr_table_get_from_lladdr(neighbors, sender);
+  if(!get_secret(secret, sender, n)) {
+    PRINTF("pairwisesec: HELLO from a new neighbor after erasing the master key\n");
+    return;
+  }
+  if(!n) {
+    /* A neighbor that never completes the handshake must not push
+       out others */
+    n = nbr_table_add_lladdr_no_evict(neighbors, sender);
+    if(!n) {
+      PRINTF("pairwisesec: could not get nbr_table_item\n");
+      return;
+    }
+    memcpy(n->secret, secret, AES_128_KEY_LENGTH);
+  }
+  
+  /* The established key, if any, stays valid until the ACK */
+  generate_random_bytes(responder_challenge, CHALLENGE_LENGTH);
+  derive_session_key(n->pending_key, secret, challenge, responder_challenge);
+  n->pending = 1;
+  payload = prepare_command(HELLOACK_IDENTIFIER, HELLOACK_LENGTH);
+  memcpy(payload, responder_challenge, CHALLENGE_LENGTH);
+  mask_group_key(payload + CHALLENGE_LENGTH, group_key,
+                 n->pending_key, HELLOACK_IDENTIFIER);
+  send_command(sender);
+}
+/*---------------------------------------------------------------------------*/
+static void
+on_helloack(const linkaddr_t *sender, const uint8_t *challenge,
+            const uint8_t *masked_group_key)
+{
+  uint8_t secret[AES_128_KEY_LENGTH];
+  uint8_t key[AES_128_KEY_LENGTH];
+  struct neighbor *n;
+  
+  if(!hello_sent) {
+    return;
+  }
+  n = nbr_table_get_from_lladdr(neighbors, sender);
+  if(!get_secret(secret, sender, n)) {
+    return;
+  }
+  derive_session_key(key, secret, hello_challenge, challenge);
+  if(n && n->established && !memcmp(n->key, key, AES_128_KEY_LENGTH)) {
+    PRINTF("pairwisesec: duplicate HELLOACK\n");
+    return;
+  }
+  
+  use_temporary_key(key);
+  if(!is_authentic(sender)) {
+    return;
+  }
+  
+  if(!n) {
+    n = nbr_table_add_lladdr(neighbors, sender);
+    if(!n) {
+      PRINTF("pairwisesec: could not get nbr_table_item\n");
+      return;
+    }
+    memcpy(n->secret, secret, AES_128_KEY_LENGTH);
+  }
+  if(!establish(n, key, masked_group_key, HELLOACK_IDENTIFIER)) {
+    return;
+  }
+  mask_group_key(prepare_command(ACK_IDENTIFIER, ACK_LENGTH), group_key,
+                 n->key, ACK_IDENTIFIER);
+  send_command(sender);
+}
+/*---------------------------------------------------------------------------*/
+static void
+on_ack(const linkaddr_t *sender, const uint8_t *masked_group_key)
+{
+  struct neighbor *n;
+  
+  n = nbr_table_get_from_lladdr(neighbors, sender);
+  if(!n || !n->pending) {
+    return;
+  }
+  use_key(n->pending_key);
+  if(!is_authentic(sender)) {
+    return;
+  }
+  establish(n, n->pending_key, masked_group_key, ACK_IDENTIFIER);
+}
+/*---------------------------------------------------------------------------*/
+/* Replying overwrites packetbuf, so the handlers get copies */
+static void
+input_command(void)
+{
+  linkaddr_t sender;
+  uint8_t payload[HELLOACK_LENGTH - 1];
+  
+  linkaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  /* Lengths are checked below, surplus bytes are ignored */
+  memcpy(payload, (uint8_t *)packetbuf_dataptr() + 1, sizeof(payload));
+  if(is_command(HELLO_IDENTIFIER)
+      && packetbuf_holds_broadcast()
+      && packetbuf_datalen() == HELLO_LENGTH) {
+    on_hello(&sender, payload);
+  } else if(is_command(HELLOACK_IDENTIFIER)
+      && !packetbuf_holds_broadcast()
+      && packetbuf_datalen() == HELLOACK_LENGTH) {
+    on_helloack(&sender, payload, payload + CHALLENGE_LENGTH);
+  } else if(is_command(ACK_IDENTIFIER)
+      && !packetbuf_holds_broadcast()
+      && packetbuf_datalen() == ACK_LENGTH) {
+    on_ack(&sender, payload);
+  } else {
+    PRINTF("pairwisesec: received unknown command\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  const linkaddr_t *sender;
+  struct neighbor *n;
+  uint8_t is_command_frame;
+  
+  is_command_frame
+      = packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_CMDFRAME;
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL)
+      != (is_command_frame ? COMMAND_SECURITY_LEVEL : LLSEC802154_SECURITY_LEVEL)) {
+    PRINTF("pairwisesec: received frame with wrong security level\n");
+    return;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  if(linkaddr_cmp(sender, &linkaddr_node_addr)) {
+    PRINTF("pairwisesec: frame from ourselves\n");
+    return;
+  }
+  if(packetbuf_datalen() < LLSEC802154_MIC_LENGTH) {
+    return;
+  }
+  
+  packetbuf_set_datalen(packetbuf_datalen() - LLSEC802154_MIC_LENGTH);
+  
+  if(is_command_frame) {
+    input_command();
+    return;
+  }
+  
+  n = nbr_table_get_from_lladdr(neighbors, sender);
+  if(!n || !n->established) {
+    PRINTF("pairwisesec: no session key with the sender\n");
+    request_hello();
+    return;
+  }
+  
+  use_key(packetbuf_holds_broadcast() ? n->group_key : n->key);
+  if(!is_authentic(sender)) {
+    return;
+  }
+  
+  if(anti_replay_was_replayed(&n->anti_replay_info)) {
+    PRINTF("pairwisesec: received replayed frame %"PRIu32"\n",
+        anti_replay_get_counter());
+    return;
+  }
+  
+#ifdef LLSEC_INPUT_CALLBACK
+  LLSEC_INPUT_CALLBACK();
+#endif /* LLSEC_INPUT_CALLBACK */
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_overhead(void)
+{
+  return SECURITY_HEADER_LENGTH + LLSEC802154_MIC_LENGTH;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bootstrap(llsec_on_bootstrapped_t on_bootstrapped)
+{
+  memset(network_key, 0xff, AES_128_KEY_LENGTH);
+  derive_key(network_key);
+  generate_random_bytes(group_key, AES_128_KEY_LENGTH);
+  nbr_table_register(neighbors, NULL);
+#if MASTER_KEY_LIFETIME
+  ctimer_set(&erase_timer, MASTER_KEY_LIFETIME, erase_master_key, NULL);
+#endif /* MASTER_KEY_LIFETIME */
+  request_hello();
+  on_bootstrapped();
+}
+/*---------------------------------------------------------------------------*/
+const struct llsec_driver pairwisesec_driver = {
+  "pairwisesec",
+  bootstrap,
+  send,
+  on_frame_created,
+  input,
+  get_overhead
+};
+/*---------------------------------------------------------------------------*/
+
+/** @} */
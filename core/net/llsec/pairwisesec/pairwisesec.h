@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ */
+
+/**
+ * \addtogroup llsec
+ * @{
+ */
+
+/**
+ * \defgroup pairwisesec LLSEC driver using pairwise keys (PAIRWISESEC)
+ *
+ * Unicast frames are secured with a session key that only the sender
+ * and the receiver share, broadcast frames with a group key of the
+ * sender. Neighbors establish both in a handshake, which is secured
+ * with keys derived from a preloaded master key. The master key is
+ * erased after PAIRWISESEC_CONF_MASTER_KEY_LIFETIME.
+ *
+ * The handshake starts at bootstrap, so platforms need to call
+ * NETSTACK_LLSEC.bootstrap().
+ *
+ * Each neighbor has its own keys, so the AES driver changes keys more
+ * often than with a single network-wide key. With aes_128_ttable_driver,
+ * set AES_128_TTABLE_CONF_CACHED_KEYS to the number of neighbors that
+ * frames alternate between, plus one, so that their round keys stay
+ * cached.
+ *
+ * @{
+ */
+
+#ifndef PAIRWISESEC_H_
+#define PAIRWISESEC_H_
+
+#include "net/llsec/llsec.h"
+
+extern const struct llsec_driver pairwisesec_driver;
+
+#endif /* PAIRWISESEC_H_ */
+
+/** @} */
+/** @} */
@@ -38,12 +38,18 @@
  */
 
 #include "net/mac/contikimac/contikimac-framer.h"
+#include "net/mac/contikimac/contikimac.h"
 #include "net/packetbuf.h"
 #include "net/netstack.h"
 #include <string.h>
 
 #define CONTIKIMAC_ID 0x00
 
+/* With an adaptive check rate, the high nibble of the id carries the
+   check rate level of the sender. */
+#define CONTIKIMAC_ID_MASK 0x0f
+#define CHECK_RATE_LEVEL_SHIFT 4
+
 /* SHORTEST_PACKET_SIZE is the shortest packet that ContikiMAC
    allows. Packets have to be a certain size to be able to be detected
    by two consecutive CCA checks, and here is where we define this
@@ -99,6 +105,9 @@ create(void)
   }
   chdr = packetbuf_hdrptr();
   chdr->id = CONTIKIMAC_ID;
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  chdr->id |= contikimac_check_rate_level() << CHECK_RATE_LEVEL_SHIFT;
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
   chdr->len = 0;
   
   hdr_len = DECORATED_FRAMER.create();
@@ -163,7 +172,7 @@ parse(void)
   }
   
   chdr = packetbuf_dataptr();
-  if(chdr->id != CONTIKIMAC_ID) {
+  if((chdr->id & CONTIKIMAC_ID_MASK) != CONTIKIMAC_ID) {
     PRINTF("contikimac-framer: CONTIKIMAC_ID is missing\n");
     return FRAMER_FAILED;
   }
@@ -175,6 +184,11 @@ parse(void)
   
   packetbuf_set_datalen(chdr->len);
   chdr->len = 0;
+
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  contikimac_neighbor_check_rate_level(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                                       chdr->id >> CHECK_RATE_LEVEL_SHIFT);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
   
   return hdr_len + sizeof(struct hdr);
 }
@@ -101,6 +101,33 @@
 #define SYNC_CYCLE_STARTS                    1
 #endif
 
+/* With CONTIKIMAC_ADAPTIVE_CHECK_RATE, the channel is checked
+   2^level times per CYCLE_TIME, with the level raised by traffic to
+   or from us, up to ADAPTIVE_MAX_LEVEL, and lowered again by one
+   every ADAPTIVE_DECAY_TIME without traffic. The extra checks split
+   each cycle evenly, so that the check at the start of a cycle stays
+   where neighbors expect it. */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_MAX_LEVEL
+#define ADAPTIVE_MAX_LEVEL                 CONTIKIMAC_CONF_ADAPTIVE_MAX_LEVEL
+#else
+#define ADAPTIVE_MAX_LEVEL                 2
+#endif
+
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_DECAY_TIME
+#define ADAPTIVE_DECAY_TIME                CONTIKIMAC_CONF_ADAPTIVE_DECAY_TIME
+#else
+#define ADAPTIVE_DECAY_TIME                (4 * CLOCK_SECOND)
+#endif
+
+/* With ADAPTIVE_WITH_RPL, nodes close to the RPL root, which forward
+   the traffic of their sub-DODAG, do not go below a minimum level:
+   ADAPTIVE_MAX_LEVEL at the root, and one less per hop below it. */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_WITH_RPL
+#define ADAPTIVE_WITH_RPL                  CONTIKIMAC_CONF_ADAPTIVE_WITH_RPL
+#else
+#define ADAPTIVE_WITH_RPL                  UIP_CONF_IPV6_RPL
+#endif
+
 /* Are we currently receiving a burst? */
 static int we_are_receiving_burst = 0;
 
@@ -108,6 +135,39 @@ static int we_are_receiving_burst = 0;
    next packet of a burst when FRAME_PENDING is set. */
 #define INTER_PACKET_DEADLINE               CLOCK_SECOND / 32
 
+/* With CONTIKIMAC_CONF_BULK, both ends of a unicast transmission with
+   the frame pending bit set keep their radio on for BULK_TIME after
+   it, and send to each other without a wake-up strobe meanwhile. The
+   sender sets the bit when it has more frames for the receiver, e.g.,
+   further 6LoWPAN fragments or packets queued by the MAC layer. These,
+   and the replies to them, then share a single rendezvous instead of
+   paying for one each. */
+#ifdef CONTIKIMAC_CONF_BULK
+#define WITH_BULK                          CONTIKIMAC_CONF_BULK
+#else
+#define WITH_BULK                          0
+#endif
+
+#ifdef CONTIKIMAC_CONF_BULK_TIME
+#define BULK_TIME                          CONTIKIMAC_CONF_BULK_TIME
+#else
+#define BULK_TIME                          (CLOCK_SECOND / 8)
+#endif
+
+#if WITH_BULK
+/* Are we keeping the radio on after a transmission to or from
+   bulk_neighbor? */
+static volatile uint8_t bulk_listening;
+static linkaddr_t bulk_neighbor;
+static struct ctimer bulk_ctimer;
+/* Running while bulk_neighbor surely keeps its radio on as well, as
+   it started its BULK_TIME at about the same time as we did. */
+static struct timer bulk_neighbor_timer;
+/* Set while the LLSEC driver checks a new unicast frame, see
+   contikimac_bulk_input() */
+static uint8_t bulk_input_pending;
+#endif /* WITH_BULK */
+
 /* ContikiMAC performs periodic channel checks. Each channel check
    consists of two or more CCA checks. CCA_COUNT_MAX is the number of
    CCAs to be done for each periodic channel check. The default is
@@ -172,8 +232,13 @@ static int we_are_receiving_burst = 0;
 #define STROBE_TIME                        (CYCLE_TIME + 2 * CHECK_TIME)
 
 /* GUARD_TIME is the time before the expected phase of a neighbor that
-   a transmitted should begin transmitting packets. */
+   a transmitted should begin transmitting packets. With drift
+   correction in phase.c, it may be configured shorter. */
+#ifdef CONTIKIMAC_CONF_GUARD_TIME
+#define GUARD_TIME                         CONTIKIMAC_CONF_GUARD_TIME
+#else
 #define GUARD_TIME                         10 * CHECK_TIME + CHECK_TIME_TX
+#endif
 
 /* INTER_PACKET_INTERVAL is the interval between two successive packet transmissions */
 #ifdef CONTIKIMAC_CONF_INTER_PACKET_INTERVAL
@@ -193,7 +258,11 @@ static int we_are_receiving_burst = 0;
 
 /* MAX_PHASE_STROBE_TIME is the time that we transmit repeated packets
    to a neighbor for which we have a phase lock. */
+#ifdef CONTIKIMAC_CONF_MAX_PHASE_STROBE_TIME
+#define MAX_PHASE_STROBE_TIME              CONTIKIMAC_CONF_MAX_PHASE_STROBE_TIME
+#else
 #define MAX_PHASE_STROBE_TIME              RTIMER_ARCH_SECOND / 60
+#endif
 
 #define ACK_LEN 3
 
@@ -227,6 +296,22 @@ static struct compower_activity current_packet;
 
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+#if ADAPTIVE_WITH_RPL
+#include "net/rpl/rpl.h"
+#endif /* ADAPTIVE_WITH_RPL */
+
+/* The check rate level of the current cycle, and the level to use
+   from the start of the next one. */
+static volatile uint8_t check_rate_level, next_check_rate_level;
+static struct ctimer check_rate_timer;
+/* The time between the current check and the next one */
+static rtimer_clock_t subcycle_time;
+#define CURRENT_CYCLE_TIME                 subcycle_time
+#else /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+#define CURRENT_CYCLE_TIME                 CYCLE_TIME
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
 #ifndef MIN
@@ -251,6 +336,11 @@ on(void)
 static void
 off(void)
 {
+#if WITH_BULK
+  if(bulk_listening && !we_are_sending) {
+    return;
+  }
+#endif /* WITH_BULK */
   if(contikimac_is_on && radio_is_on != 0 &&
      contikimac_keep_radio_on == 0) {
     radio_is_on = 0;
@@ -258,6 +348,38 @@ off(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_BULK
+static void
+bulk_off(void *ptr)
+{
+  bulk_listening = 0;
+  if(!we_are_sending && !we_are_receiving_burst) {
+    off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bulk_start(const linkaddr_t *neighbor)
+{
+  bulk_listening = 1;
+  linkaddr_copy(&bulk_neighbor, neighbor);
+  timer_set(&bulk_neighbor_timer, BULK_TIME / 2);
+  ctimer_set(&bulk_ctimer, BULK_TIME, bulk_off, NULL);
+  on();
+}
+/*---------------------------------------------------------------------------*/
+/* Called by the LLSEC driver once it accepted an incoming frame */
+void
+contikimac_bulk_input(void)
+{
+  if(bulk_input_pending) {
+    bulk_input_pending = 0;
+    /* The sender announced more frames for us */
+    bulk_start(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  }
+}
+#endif /* WITH_BULK */
+/*---------------------------------------------------------------------------*/
 static volatile rtimer_clock_t cycle_start;
 static char powercycle(struct rtimer *t, void *ptr);
 static void
@@ -330,6 +452,10 @@ powercycle(struct rtimer *t, void *ptr)
   static volatile rtimer_clock_t sync_cycle_start;
   static volatile uint8_t sync_cycle_phase;
 #endif
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  static rtimer_clock_t base_cycle_start;
+  static uint8_t subcycle;
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
 
   PT_BEGIN(&pt);
 
@@ -338,12 +464,22 @@ powercycle(struct rtimer *t, void *ptr)
 #else
   cycle_start = RTIMER_NOW();
 #endif
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  base_cycle_start = cycle_start;
+  subcycle = 0;
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
 
   while(1) {
     static uint8_t packet_seen;
     static rtimer_clock_t t0;
     static uint8_t count;
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+    if(subcycle == 0) {
+      /* The check rate level only changes at the start of a cycle */
+      check_rate_level = next_check_rate_level;
+      cycle_start = base_cycle_start;
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
 #if SYNC_CYCLE_STARTS
     /* Compute cycle start when RTIMER_ARCH_SECOND is not a multiple
        of CHANNEL_CHECK_RATE */
@@ -361,6 +497,18 @@ powercycle(struct rtimer *t, void *ptr)
 #else
     cycle_start += CYCLE_TIME;
 #endif
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+      base_cycle_start = cycle_start;
+    } else {
+      cycle_start = base_cycle_start +
+        (rtimer_clock_t)(((unsigned long)CYCLE_TIME * subcycle) >> check_rate_level);
+    }
+    subcycle = (subcycle + 1) & ((1 << check_rate_level) - 1);
+    subcycle_time = base_cycle_start - cycle_start +
+      (rtimer_clock_t)(((unsigned long)CYCLE_TIME *
+                        (subcycle == 0 ? 1 << check_rate_level : subcycle))
+                       >> check_rate_level);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
 
     packet_seen = 0;
 
@@ -443,7 +591,7 @@ powercycle(struct rtimer *t, void *ptr)
       }
     }
 
-    if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CYCLE_TIME - CHECK_TIME * 4)) {
+    if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CURRENT_CYCLE_TIME - CHECK_TIME * 4)) {
       /* Schedule the next powercycle interrupt, or sleep the mcu
 	 until then.  Sleeping will not exit from this interrupt, so
 	 ensure an occasional wake cycle or foreground processing will
@@ -451,14 +599,14 @@ powercycle(struct rtimer *t, void *ptr)
 #if RDC_CONF_MCU_SLEEP
       static uint8_t sleepcycle;
       if((sleepcycle++ < 16) && !we_are_sending && !radio_is_on) {
-        rtimer_arch_sleep(CYCLE_TIME - (RTIMER_NOW() - cycle_start));
+        rtimer_arch_sleep(CURRENT_CYCLE_TIME - (RTIMER_NOW() - cycle_start));
       } else {
         sleepcycle = 0;
-        schedule_powercycle_fixed(t, CYCLE_TIME + cycle_start);
+        schedule_powercycle_fixed(t, CURRENT_CYCLE_TIME + cycle_start);
         PT_YIELD(&pt);
       }
 #else
-      schedule_powercycle_fixed(t, CYCLE_TIME + cycle_start);
+      schedule_powercycle_fixed(t, CURRENT_CYCLE_TIME + cycle_start);
       PT_YIELD(&pt);
 #endif
     }
@@ -467,6 +615,69 @@ powercycle(struct rtimer *t, void *ptr)
   PT_END(&pt);
 }
 /*---------------------------------------------------------------------------*/
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+static uint8_t
+min_check_rate_level(void)
+{
+#if ADAPTIVE_WITH_RPL
+  rpl_dag_t *dag;
+  rpl_rank_t hops;
+
+  dag = rpl_get_any_dag();
+  if(dag != NULL && dag->instance != NULL &&
+     dag->instance->min_hoprankinc > 0) {
+    /* The root has rank min_hoprankinc */
+    hops = dag->rank / dag->instance->min_hoprankinc;
+    if(hops > 0 && hops <= ADAPTIVE_MAX_LEVEL) {
+      return ADAPTIVE_MAX_LEVEL + 1 - hops;
+    }
+  }
+#endif /* ADAPTIVE_WITH_RPL */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_rate_decay(void *ptr)
+{
+  uint8_t min_level;
+
+  min_level = min_check_rate_level();
+  if(next_check_rate_level > min_level) {
+    next_check_rate_level--;
+  } else {
+    next_check_rate_level = min_level;
+  }
+  ctimer_set(&check_rate_timer, ADAPTIVE_DECAY_TIME, check_rate_decay, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_rate_traffic(void)
+{
+  if(next_check_rate_level < ADAPTIVE_MAX_LEVEL) {
+    next_check_rate_level++;
+  }
+  ctimer_set(&check_rate_timer, ADAPTIVE_DECAY_TIME, check_rate_decay, NULL);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+contikimac_check_rate_level(void)
+{
+  /* Neighbors that lock on our phase may only rely on checks that we
+     do now and from the next cycle. */
+  return MIN(check_rate_level, next_check_rate_level);
+}
+/*---------------------------------------------------------------------------*/
+void
+contikimac_neighbor_check_rate_level(const linkaddr_t *neighbor,
+                                     uint8_t level)
+{
+#if WITH_PHASE_OPTIMIZATION
+  /* The neighbor keeps its level at least until its level decays */
+  phase_set_rate_level(neighbor, level, ADAPTIVE_DECAY_TIME);
+#endif /* WITH_PHASE_OPTIMIZATION */
+}
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+/*---------------------------------------------------------------------------*/
 static int
 broadcast_rate_drop(void)
 {
@@ -545,6 +756,10 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0],
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[1]);
 #endif /* NETSTACK_CONF_WITH_IPV6 */
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+    /* Check more often for the reply */
+    check_rate_traffic();
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
   }
   is_reliable = packetbuf_attr(PACKETBUF_ATTR_RELIABLE)
 #if NETSTACK_CONF_WITH_RIME
@@ -563,6 +778,15 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   transmit_len = packetbuf_totlen();
   NETSTACK_RADIO.prepare(packetbuf_hdrptr(), transmit_len);
   
+#if WITH_BULK
+  if(!is_broadcast && bulk_listening &&
+     !timer_expired(&bulk_neighbor_timer) &&
+     linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &bulk_neighbor)) {
+    /* The receiver still listens after our last exchange */
+    is_receiver_awake = 1;
+  }
+#endif /* WITH_BULK */
+
   if(!is_broadcast && !is_receiver_awake) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
@@ -756,6 +980,15 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     ret = MAC_TX_OK;
   }
 
+#if WITH_BULK
+  if(!is_broadcast && ret == MAC_TX_OK &&
+     packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
+    bulk_start(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  } else if(bulk_listening) {
+    on();
+  }
+#endif /* WITH_BULK */
+
 #if WITH_PHASE_OPTIMIZATION
   if(is_known_receiver && got_strobe_ack) {
     PRINTF("no miss %d wake-ups %d\n",
@@ -821,7 +1054,12 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       }
       
       packetbuf_set_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED, 1);
-      queuebuf_update_from_packetbuf(curr->buf);
+      if(!queuebuf_update_from_packetbuf(curr->buf)) {
+        /* The queuebuf would keep the frame as it was before framing */
+        PRINTF("contikimac: could not update queuebuf\n");
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+        return;
+      }
     }
     curr = next;
   } while(next != NULL);
@@ -897,6 +1135,12 @@ input_packet(void)
         ctimer_stop(&ct);
       }
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+      if(!packetbuf_holds_broadcast()) {
+        check_rate_traffic();
+      }
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
 #if RDC_WITH_DUPLICATE_DETECTION
       /* Check for duplicate packet. */
       if(mac_sequence_is_duplicate()) {
@@ -922,7 +1166,17 @@ input_packet(void)
 #endif /* CONTIKIMAC_CONF_COMPOWER */
 
       PRINTDEBUG("contikimac: data (%u)\n", packetbuf_datalen());
+#if WITH_BULK
+      /* Keep the radio on for the sender only if it announced more
+         frames, and only if the frame is new and authentic, so that
+         forged or replayed frames cannot deny us sleep */
+      bulk_input_pending = !packetbuf_holds_broadcast() &&
+        packetbuf_attr(PACKETBUF_ATTR_PENDING);
+#endif /* WITH_BULK */
       NETSTACK_MAC.input();
+#if WITH_BULK
+      bulk_input_pending = 0;
+#endif /* WITH_BULK */
       return;
     } else {
       PRINTDEBUG("contikimac: data not for us\n");
@@ -938,6 +1192,11 @@ init(void)
   radio_is_on = 0;
   PT_INIT(&pt);
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+  check_rate_level = next_check_rate_level = 0;
+  ctimer_set(&check_rate_timer, ADAPTIVE_DECAY_TIME, check_rate_decay, NULL);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
   rtimer_set(&rt, RTIMER_NOW() + CYCLE_TIME, 1,
              (void (*)(struct rtimer *, void *))powercycle, NULL);
 
@@ -43,7 +43,31 @@
 #include "sys/rtimer.h"
 #include "net/mac/rdc.h"
 #include "dev/radio.h"
+#include "net/linkaddr.h"
+
+/* With CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE, ContikiMAC checks the
+   channel more often while there is traffic, up to 2^level times per
+   cycle. The level is announced in the ContikiMAC header, so all
+   nodes must use contikimac_framer in this mode. */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#define CONTIKIMAC_ADAPTIVE_CHECK_RATE CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#else
+#define CONTIKIMAC_ADAPTIVE_CHECK_RATE 0
+#endif
 
 extern const struct rdc_driver contikimac_driver;
 
+#if CONTIKIMAC_ADAPTIVE_CHECK_RATE
+/* The check rate level to announce to neighbors */
+uint8_t contikimac_check_rate_level(void);
+/* Called by the framer with the check rate level a neighbor announced */
+void contikimac_neighbor_check_rate_level(const linkaddr_t *neighbor,
+                                          uint8_t level);
+#endif /* CONTIKIMAC_ADAPTIVE_CHECK_RATE */
+
+#if CONTIKIMAC_CONF_BULK
+/* Called by the LLSEC driver with each incoming frame it accepted */
+void contikimac_bulk_input(void);
+#endif /* CONTIKIMAC_CONF_BULK */
+
 #endif /* CONTIKIMAC_H */
@@ -47,6 +47,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/nbr-table.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -84,6 +85,52 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* Deficit round robin across neighbor queues: the number of bytes a
+   neighbor may send per turn, on top of what it left unused in its
+   previous turns. With 0, the whole queue of a neighbor is handed to
+   the RDC as soon as its timer fires. */
+#ifdef CSMA_CONF_DRR_QUANTUM
+#define CSMA_DRR_QUANTUM CSMA_CONF_DRR_QUANTUM
+#else
+#define CSMA_DRR_QUANTUM 0
+#endif /* CSMA_CONF_DRR_QUANTUM */
+
+/* The maximum number of packets sent to a neighbor in one turn */
+#ifdef CSMA_CONF_DRR_MAX_BURST
+#define CSMA_DRR_MAX_BURST CSMA_CONF_DRR_MAX_BURST
+#else
+#define CSMA_DRR_MAX_BURST 4
+#endif /* CSMA_CONF_DRR_MAX_BURST */
+
+/* Set the frame pending bit on all but the last of the packets handed
+   to the RDC at once, so that the receiver keeps its radio on for the
+   rest of the burst. The last one gets the bit as well when more
+   packets stay queued for the receiver. */
+#ifdef CSMA_CONF_BURST
+#define CSMA_BURST CSMA_CONF_BURST
+#else
+#define CSMA_BURST 0
+#endif /* CSMA_CONF_BURST */
+
+/* Look up neighbor queues in a hash table instead of walking the
+   neighbor list */
+#ifdef CSMA_CONF_NEIGHBOR_HASH
+#define CSMA_NEIGHBOR_HASH CSMA_CONF_NEIGHBOR_HASH
+#else
+#define CSMA_NEIGHBOR_HASH 0
+#endif /* CSMA_CONF_NEIGHBOR_HASH */
+
+/* The number of hash buckets, a power of two */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE 8
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+
+#if CSMA_NEIGHBOR_HASH && (CSMA_NEIGHBOR_HASH_SIZE & (CSMA_NEIGHBOR_HASH_SIZE - 1))
+#error CSMA_CONF_NEIGHBOR_HASH_SIZE must be a power of two.
+#endif
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -94,10 +141,19 @@ struct qbuf_metadata {
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
   struct neighbor_queue *next;
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue *hash_next;
+#endif /* CSMA_NEIGHBOR_HASH */
   linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+#if CSMA_DRR_QUANTUM
+  uint8_t ready;
+  uint16_t deficit;
+  /* The packets handed to the RDC in the current turn */
+  struct rdc_buf_list burst[CSMA_DRR_MAX_BURST];
+#endif /* CSMA_DRR_QUANTUM */
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -124,10 +180,73 @@ LIST(neighbor_list);
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 
+#if CSMA_NEIGHBOR_HASH
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+#endif /* CSMA_NEIGHBOR_HASH */
+
+#if CSMA_STATS
+struct csma_stats csma_stats;
+/* The statistics of unicast neighbors */
+NBR_TABLE(struct csma_stats, csma_neighbor_stats);
+
+#define STATS_ADD(s, field, value) do {       \
+    struct csma_stats *neighbor_ = (s);        \
+    csma_stats.field += (value);               \
+    if(neighbor_ != NULL) {                    \
+      neighbor_->field += (value);             \
+    }                                          \
+  } while(0)
+#else /* CSMA_STATS */
+#define STATS_ADD(s, field, value)
+#endif /* CSMA_STATS */
+
+#if CSMA_DRR_QUANTUM
+static struct ctimer drr_timer;
+/* The neighbor whose packets are being handed to the RDC */
+static struct neighbor_queue *drr_serving;
+#endif /* CSMA_DRR_QUANTUM */
+
+/*---------------------------------------------------------------------------*/
+#if CSMA_NEIGHBOR_HASH
+static struct neighbor_queue **
+neighbor_bucket(const linkaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h ^= addr->u8[i];
+  }
+  return &neighbor_hash[h & (CSMA_NEIGHBOR_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_hash_remove(struct neighbor_queue *n)
+{
+  struct neighbor_queue **p;
+
+  for(p = neighbor_bucket(&n->addr); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == n) {
+      *p = n->hash_next;
+      return;
+    }
+  }
+}
+#endif /* CSMA_NEIGHBOR_HASH */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
+#if CSMA_NEIGHBOR_HASH
+  struct neighbor_queue *n = *neighbor_bucket(addr);
+  while(n != NULL) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+    n = n->hash_next;
+  }
+#else /* CSMA_NEIGHBOR_HASH */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
@@ -135,9 +254,57 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
     }
     n = list_item_next(n);
   }
+#endif /* CSMA_NEIGHBOR_HASH */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_STATS
+static struct csma_stats *
+neighbor_stats(const linkaddr_t *addr)
+{
+  struct csma_stats *s;
+
+  if(linkaddr_cmp(addr, &linkaddr_null)) {
+    /* Broadcasts only count in the totals */
+    return NULL;
+  }
+  s = nbr_table_get_from_lladdr(csma_neighbor_stats, addr);
+  if(s == NULL) {
+    /* Statistics must not push out neighbors that RPL or ND use */
+    s = nbr_table_add_lladdr_no_evict(csma_neighbor_stats, addr);
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+struct csma_stats *
+csma_stats_neighbor_head(void)
+{
+  return nbr_table_head(csma_neighbor_stats);
+}
+/*---------------------------------------------------------------------------*/
+struct csma_stats *
+csma_stats_neighbor_next(struct csma_stats *s)
+{
+  return nbr_table_next(csma_neighbor_stats, s);
+}
+/*---------------------------------------------------------------------------*/
+const linkaddr_t *
+csma_stats_neighbor_lladdr(struct csma_stats *s)
+{
+  return nbr_table_get_lladdr(csma_neighbor_stats, s);
+}
+#endif /* CSMA_STATS */
+/*---------------------------------------------------------------------------*/
+int
+csma_queue_length(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n = neighbor_queue_from_addr(addr);
+  if(n == NULL) {
+    return 0;
+  }
+  return list_length(n->queued_packet_list);
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -156,16 +323,152 @@ default_timebase(void)
 }
 /*---------------------------------------------------------------------------*/
 static void
+free_neighbor(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+#if CSMA_NEIGHBOR_HASH
+  neighbor_hash_remove(n);
+#endif /* CSMA_NEIGHBOR_HASH */
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
+/*---------------------------------------------------------------------------*/
+#if CSMA_BURST || CSMA_DRR_QUANTUM
+static void
+set_pending(struct rdc_buf_list *q, int pending)
+{
+  /* Frames that the RDC already created keep the bit they were sent
+     with */
+  if(queuebuf_attr(q->buf, PACKETBUF_ATTR_PENDING) != pending &&
+     !queuebuf_attr(q->buf, PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+    queuebuf_to_packetbuf(q->buf);
+    packetbuf_set_attr(PACKETBUF_ATTR_PENDING, pending);
+    queuebuf_update_attr_from_packetbuf(q->buf);
+  }
+}
+#endif /* CSMA_BURST || CSMA_DRR_QUANTUM */
+/*---------------------------------------------------------------------------*/
+#if CSMA_BURST
+static void
+mark_burst(struct rdc_buf_list *list, int more)
+{
+  struct rdc_buf_list *q;
+
+  /* All but the last packet announce that more frames follow, and so
+     does the last one if more packets stay queued after it */
+  for(q = list; q != NULL; q = list_item_next(q)) {
+    set_pending(q, list_item_next(q) != NULL || more);
+  }
+}
+#endif /* CSMA_BURST */
+/*---------------------------------------------------------------------------*/
+#if CSMA_DRR_QUANTUM
+static void drr_serve(void *ptr);
+
+static void
+drr_ready(struct neighbor_queue *n)
+{
+  n->ready = 1;
+  ctimer_set(&drr_timer, 0, drr_serve, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+drr_serve(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q;
+  uint16_t len;
+  int count;
+
+  /* Neighbors move to the end of the list after their turn, so the
+     first ready neighbor is the next one in round-robin order */
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(n->ready) {
+      break;
+    }
+  }
+  if(n == NULL) {
+    return;
+  }
+  n->ready = 0;
+  n->deficit += CSMA_DRR_QUANTUM;
+
+  /* Hand the RDC the packets at the head of the queue that the
+     deficit pays for */
+  count = 0;
+  for(q = list_head(n->queued_packet_list);
+      q != NULL && count < CSMA_DRR_MAX_BURST; q = list_item_next(q)) {
+    len = queuebuf_datalen(q->buf);
+    if(len > n->deficit) {
+      break;
+    }
+    n->deficit -= len;
+    n->burst[count].buf = q->buf;
+    n->burst[count].ptr = q->ptr;
+    n->burst[count].next = NULL;
+    if(count > 0) {
+      n->burst[count - 1].next = &n->burst[count];
+    }
+    count++;
+  }
+
+  if(count > 0) {
+    PRINTF("csma: turn of %d packets, queue len %d, deficit %u\n", count,
+           list_length(n->queued_packet_list), n->deficit);
+#if CSMA_BURST
+    mark_burst(n->burst, q != NULL);
+#else /* CSMA_BURST */
+    if(q != NULL) {
+      /* More packets wait for the neighbor's next turn */
+      set_pending(&n->burst[count - 1], 1);
+    }
+#endif /* CSMA_BURST */
+    drr_serving = n;
+    NETSTACK_RDC.send_list(packet_sent, n, n->burst);
+    drr_serving = NULL;
+    if(list_head(n->queued_packet_list) == NULL) {
+      free_neighbor(n);
+      n = NULL;
+    }
+  } else {
+    /* The head packet is larger than the deficit: wait for the next
+       round */
+    n->ready = 1;
+  }
+  if(n != NULL) {
+    list_remove(neighbor_list, n);
+    list_add(neighbor_list, n);
+  }
+
+  /* Give the next ready neighbor its turn */
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(n->ready) {
+      ctimer_set(&drr_timer, 0, drr_serve, NULL);
+      break;
+    }
+  }
+}
+#endif /* CSMA_DRR_QUANTUM */
+/*---------------------------------------------------------------------------*/
+static void
 transmit_packet_list(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
     struct rdc_buf_list *q = list_head(n->queued_packet_list);
     if(q != NULL) {
+#if CSMA_DRR_QUANTUM
+      /* Wait for the neighbor's turn */
+      drr_ready(n);
+#else /* CSMA_DRR_QUANTUM */
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+#if CSMA_BURST
+      mark_burst(q, 0);
+#endif /* CSMA_BURST */
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
+#endif /* CSMA_DRR_QUANTUM */
     }
   }
 }
@@ -187,14 +490,23 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_DRR_QUANTUM
+      /* The next packet is sent in the neighbor's next turn */
+      drr_ready(n);
+#else /* CSMA_DRR_QUANTUM */
       /* Set a timer for next transmissions */
       ctimer_set(&n->transmit_timer, default_timebase(),
                  transmit_packet_list, n);
+#endif /* CSMA_DRR_QUANTUM */
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+#if CSMA_DRR_QUANTUM
+      if(n == drr_serving) {
+        /* The RDC may still walk the burst: drr_serve() frees it */
+        return;
+      }
+#endif /* CSMA_DRR_QUANTUM */
+      free_neighbor(n);
     }
   }
 }
@@ -211,6 +523,9 @@ packet_sent(void *ptr, int status, int num_transmissions)
   int num_tx;
   int backoff_exponent;
   int backoff_transmissions;
+#if CSMA_STATS
+  struct csma_stats *s;
+#endif /* CSMA_STATS */
 
   n = ptr;
   if(n == NULL) {
@@ -240,6 +555,15 @@ packet_sent(void *ptr, int status, int num_transmissions)
 
   if(q != NULL) {
     metadata = (struct qbuf_metadata *)q->ptr;
+#ifdef CSMA_SNIFFER
+    CSMA_SNIFFER(q->buf, status, n->transmissions);
+#endif /* CSMA_SNIFFER */
+#if CSMA_STATS
+    s = neighbor_stats(&n->addr);
+    if(status == MAC_TX_COLLISION) {
+      STATS_ADD(s, collisions, num_transmissions);
+    }
+#endif /* CSMA_STATS */
 
     if(metadata != NULL) {
       sent = metadata->sent;
@@ -285,6 +609,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
 
         if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
+#if CSMA_DRR_QUANTUM
+          /* Not ready again before the backoff expires */
+          n->ready = 0;
+#endif /* CSMA_DRR_QUANTUM */
           ctimer_set(&n->transmit_timer, time,
                      transmit_packet_list, n);
           /* This is needed to correctly attribute energy that we spent
@@ -293,6 +621,8 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          STATS_ADD(s, dropped, 1);
+          STATS_ADD(s, transmissions, num_tx);
           free_packet(n, q);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -302,6 +632,12 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: rexmit failed %d: %d\n", n->transmissions, status);
         }
+        if(status == MAC_TX_OK) {
+          STATS_ADD(s, sent, 1);
+        } else {
+          STATS_ADD(s, dropped, 1);
+        }
+        STATS_ADD(s, transmissions, num_tx);
         free_packet(n, q);
         mac_call_sent_callback(sent, cptr, status, num_tx);
       }
@@ -346,10 +682,18 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_DRR_QUANTUM
+      n->ready = 0;
+      n->deficit = 0;
+#endif /* CSMA_DRR_QUANTUM */
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
       list_add(neighbor_list, n);
+#if CSMA_NEIGHBOR_HASH
+      n->hash_next = *neighbor_bucket(addr);
+      *neighbor_bucket(addr) = n;
+#endif /* CSMA_NEIGHBOR_HASH */
     }
   }
 
@@ -360,6 +704,11 @@ send_packet(mac_callback_t sent, void *ptr)
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
         if(q->ptr != NULL) {
+          if(packetbuf_is_reference()) {
+            /* The packet stays queued after we return, but referenced
+               data (e.g., 6lowpan fragments in uip_buf) may not. */
+            packetbuf_compact();
+          }
           q->buf = queuebuf_new_from_packetbuf();
           if(q->buf != NULL) {
             struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
@@ -381,11 +730,16 @@ send_packet(mac_callback_t sent, void *ptr)
               list_add(n->queued_packet_list, q);
             }
 
+            STATS_ADD(neighbor_stats(addr), queued, 1);
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
             if(list_head(n->queued_packet_list) == q) {
+#if CSMA_DRR_QUANTUM
+              drr_ready(n);
+#else /* CSMA_DRR_QUANTUM */
               ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
+#endif /* CSMA_DRR_QUANTUM */
             }
             return;
           }
@@ -396,9 +750,12 @@ send_packet(mac_callback_t sent, void *ptr)
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
-      if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+      if(list_length(n->queued_packet_list) == 0
+#if CSMA_DRR_QUANTUM
+         && n != drr_serving
+#endif /* CSMA_DRR_QUANTUM */
+         ) {
+        free_neighbor(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -407,6 +764,7 @@ send_packet(mac_callback_t sent, void *ptr)
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+  STATS_ADD(neighbor_stats(addr), dropped, 1);
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
@@ -443,6 +801,9 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+#if CSMA_STATS
+  nbr_table_register(csma_neighbor_stats, NULL);
+#endif /* CSMA_STATS */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -41,11 +41,63 @@
 #ifndef CSMA_H_
 #define CSMA_H_
 
+#include "net/linkaddr.h"
 #include "net/mac/mac.h"
 #include "dev/radio.h"
 
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else
+#define CSMA_STATS 0
+#endif /* CSMA_CONF_STATS */
+
+/*
+ * CSMA_CONF_SNIFFER names a function that csma calls after each
+ * transmission of a queued packet, e.g., to log the frames a node
+ * sends. It gets the queuebuf of the packet, the status the RDC
+ * reported and the number of transmissions so far. A sniffer that
+ * keeps the packet takes a share of the queuebuf with
+ * queuebuf_share() rather than copying it, so that the packet stays
+ * in a single buffer while csma retransmits it.
+ */
+#ifdef CSMA_CONF_SNIFFER
+#define CSMA_SNIFFER CSMA_CONF_SNIFFER
+struct queuebuf;
+void CSMA_SNIFFER(struct queuebuf *buf, int status, int transmissions);
+#endif /* CSMA_CONF_SNIFFER */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
 
+#if CSMA_STATS
+/**
+ * The CSMA statistics, in total and per unicast neighbor. The average
+ * number of transmissions per packet is transmissions / (sent +
+ * dropped). A neighbor only gets statistics if the neighbor table
+ * has room for it without removing another neighbor; otherwise its
+ * packets only count in the totals.
+ */
+struct csma_stats {
+  uint16_t queued;        /**< Packets put in a neighbor queue */
+  uint16_t sent;          /**< Packets acknowledged or broadcast */
+  uint16_t dropped;       /**< Packets dropped because the queue was
+                               full or after the last transmission */
+  uint16_t collisions;    /**< Transmissions that found the channel busy */
+  uint16_t transmissions; /**< Transmissions of the sent and dropped
+                               packets */
+};
+
+extern struct csma_stats csma_stats;
+
+/** Iterate over the statistics of the neighbors */
+struct csma_stats *csma_stats_neighbor_head(void);
+struct csma_stats *csma_stats_neighbor_next(struct csma_stats *s);
+/** The link-layer address of the neighbor the statistics belong to */
+const linkaddr_t *csma_stats_neighbor_lladdr(struct csma_stats *s);
+#endif /* CSMA_STATS */
+
+/** The number of packets queued for a neighbor */
+int csma_queue_length(const linkaddr_t *addr);
+
 #endif /* CSMA_H_ */
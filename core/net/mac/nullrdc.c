@@ -306,7 +306,8 @@ packet_input(void)
     {
       frame802154_t info154;
       frame802154_parse(original_dataptr, original_datalen, &info154);
-      if(info154.fcf.frame_type == FRAME802154_DATAFRAME &&
+      if((info154.fcf.frame_type == FRAME802154_DATAFRAME ||
+          info154.fcf.frame_type == FRAME802154_CMDFRAME) &&
          info154.fcf.ack_required != 0 &&
          linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
                       &linkaddr_node_addr)) {
@@ -50,13 +50,40 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* With PHASE_DRIFT_CORRECT, the clock drift of each neighbor is
+   estimated with a least-squares fit over the last PHASE_DRIFT_SAMPLES
+   phases, recorded at least PHASE_DRIFT_SAMPLE_INTERVAL apart. */
+#ifdef PHASE_CONF_DRIFT_SAMPLES
+#define PHASE_DRIFT_SAMPLES PHASE_CONF_DRIFT_SAMPLES
+#else
+#define PHASE_DRIFT_SAMPLES 4
+#endif
+
+#ifdef PHASE_CONF_DRIFT_SAMPLE_INTERVAL
+#define PHASE_DRIFT_SAMPLE_INTERVAL PHASE_CONF_DRIFT_SAMPLE_INTERVAL
+#else
+#define PHASE_DRIFT_SAMPLE_INTERVAL (30 * CLOCK_SECOND)
+#endif
+
+#if PHASE_DRIFT_CORRECT
+struct phase_sample {
+  rtimer_clock_t time;
+  clock_time_t clock;
+};
+#endif /* PHASE_DRIFT_CORRECT */
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
-  rtimer_clock_t drift;
+  struct phase_sample samples[PHASE_DRIFT_SAMPLES];
+  uint8_t newest_sample, sample_count;
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
+#if PHASE_RATE_LEVEL
+  uint8_t rate_level;
+  struct timer rate_level_timer;
+#endif /* PHASE_RATE_LEVEL */
 };
 
 struct phase_queueitem {
@@ -67,7 +94,11 @@ struct phase_queueitem {
   struct rdc_buf_list *buf_list;
 };
 
-#define PHASE_DEFER_THRESHOLD 1
+#ifdef PHASE_CONF_DEFER_THRESHOLD
+#define PHASE_DEFER_THRESHOLD PHASE_CONF_DEFER_THRESHOLD
+#else
+#define PHASE_DEFER_THRESHOLD 0
+#endif
 #define PHASE_QUEUESIZE       8
 
 #define MAX_NOACKS            16
@@ -87,6 +118,75 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+static void
+add_sample(struct phase *e, rtimer_clock_t time)
+{
+  struct phase_sample *previous;
+  clock_time_t now;
+
+  now = clock_time();
+  previous = &e->samples[(e->newest_sample + PHASE_DRIFT_SAMPLES - 1) %
+                         PHASE_DRIFT_SAMPLES];
+  if(e->sample_count < 2 ||
+     now - previous->clock >= PHASE_DRIFT_SAMPLE_INTERVAL) {
+    e->newest_sample = (e->newest_sample + 1) % PHASE_DRIFT_SAMPLES;
+    if(e->sample_count < PHASE_DRIFT_SAMPLES) {
+      e->sample_count++;
+    }
+  }
+  /* Otherwise, the newest sample is too close to the previous one to
+     tell anything about the drift, and is replaced. */
+  e->samples[e->newest_sample].time = time;
+  e->samples[e->newest_sample].clock = now;
+}
+/*---------------------------------------------------------------------------*/
+/* Predict how far the phase of the neighbor has moved from the newest
+   sample by now, in rtimer ticks. The phase offsets of the samples are
+   taken modulo cycle_time, relative to the newest sample, and fitted
+   against the clock time at which they were recorded. */
+static int32_t
+predict_drift(struct phase *e, rtimer_clock_t cycle_time)
+{
+  struct phase_sample *newest, *sample;
+  int64_t sum_x, sum_y, sum_xx, sum_xy, dx, dxy;
+  int32_t x, y;
+  uint8_t i, n;
+
+  n = e->sample_count;
+  newest = &e->samples[e->newest_sample];
+  sample = &e->samples[(e->newest_sample + PHASE_DRIFT_SAMPLES - n + 1) %
+                       PHASE_DRIFT_SAMPLES];
+  if(n < 2 ||
+     newest->clock - sample->clock < PHASE_DRIFT_SAMPLE_INTERVAL) {
+    return 0;
+  }
+
+  sum_x = sum_y = sum_xx = sum_xy = 0;
+  for(i = 0; i < n; i++) {
+    sample = &e->samples[(e->newest_sample + PHASE_DRIFT_SAMPLES - i) %
+                         PHASE_DRIFT_SAMPLES];
+    x = (int32_t)(sample->clock - newest->clock);
+    y = (rtimer_clock_t)(sample->time - newest->time) % cycle_time;
+    if(y > cycle_time / 2) {
+      y -= cycle_time;
+    }
+    sum_x += x;
+    sum_y += y;
+    sum_xx += (int64_t)x * x;
+    sum_xy += (int64_t)x * y;
+  }
+
+  dx = n * sum_xx - sum_x * sum_x;
+  dxy = n * sum_xy - sum_x * sum_y;
+  if(dx <= 0) {
+    return 0;
+  }
+  x = (int32_t)(clock_time() - newest->clock);
+  return (int32_t)((sum_y + dxy * (n * x - sum_x) / dx) / n);
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -98,15 +198,27 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
+      add_sample(e, time);
 #endif
       e->time = time;
+#if PHASE_RATE_LEVEL
+      /* The neighbor just received a packet, which holds its check
+         rate for another lifetime. */
+      timer_restart(&e->rate_level_timer);
+#endif /* PHASE_RATE_LEVEL */
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
        before we drop it from the phase list. */
     if(mac_status == MAC_TX_NOACK) {
       PRINTF("phase noacks %d to %d.%d\n", e->noacks, neighbor->u8[0], neighbor->u8[1]);
+#if PHASE_RATE_LEVEL
+      if(e->rate_level > 0) {
+        /* We may have aimed for a check the neighbor no longer does */
+        nbr_table_remove(nbr_phase, e);
+        return;
+      }
+#endif /* PHASE_RATE_LEVEL */
       e->noacks++;
       if(e->noacks == 1) {
         timer_set(&e->noacks_timer, MAX_NOACKS_TIME);
@@ -126,9 +238,13 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       if(e) {
         e->time = time;
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+      e->newest_sample = e->sample_count = 0;
+      add_sample(e, time);
 #endif
       e->noacks = 0;
+#if PHASE_RATE_LEVEL
+      e->rate_level = 0;
+#endif /* PHASE_RATE_LEVEL */
       }
     }
   }
@@ -185,15 +301,27 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
 
     sync = (e == NULL) ? now : e->time;
 
-#if PHASE_DRIFT_CORRECT
-    {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
+#if PHASE_RATE_LEVEL
+    if(e->rate_level > 0) {
+      uint8_t level;
+
+      if(timer_expired(&e->rate_level_timer)) {
+        /* The neighbor may have lowered its check rate since, and the
+           recorded phase may not be one of its remaining checks. */
+        nbr_table_remove(nbr_phase, e);
+        return PHASE_UNKNOWN;
       }
+      /* Aim for the next of the 2^level checks per cycle, as long as
+         they are further apart than the guard time. */
+      for(level = e->rate_level;
+          level > 0 && (cycle_time >> level) <= 2 * guard_time;
+          level--);
+      cycle_time >>= level;
     }
+#endif /* PHASE_RATE_LEVEL */
+
+#if PHASE_DRIFT_CORRECT
+    sync += predict_drift(e, cycle_time);
 #endif
 
     /* Check if cycle_time is a power of two */
@@ -230,7 +358,8 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
 
     expected = now + wait - guard_time;
     if(!RTIMER_CLOCK_LT(expected, now)) {
-      /* Wait until the receiver is expected to be awake */
+      /* Wait until the receiver is expected to be awake. Unless the
+         packet could not be queued, this is less than a clock tick. */
       while(RTIMER_CLOCK_LT(RTIMER_NOW(), expected));
     }
     return PHASE_SEND_NOW;
@@ -238,6 +367,30 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
   return PHASE_UNKNOWN;
 }
 /*---------------------------------------------------------------------------*/
+#if PHASE_RATE_LEVEL
+void
+phase_set_rate_level(const linkaddr_t *neighbor, uint8_t level,
+                     clock_time_t lifetime)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e == NULL || level == e->rate_level) {
+    return;
+  }
+  if(level < e->rate_level) {
+    /* The recorded phase may have been one of the checks the neighbor
+       no longer does. */
+    PRINTF("phase rate level %d of %d.%d, drop\n", level,
+           neighbor->u8[0], neighbor->u8[1]);
+    nbr_table_remove(nbr_phase, e);
+    return;
+  }
+  e->rate_level = level;
+  timer_set(&e->rate_level_timer, lifetime);
+}
+#endif /* PHASE_RATE_LEVEL */
+/*---------------------------------------------------------------------------*/
 void
 phase_init(void)
 {
@@ -47,6 +47,17 @@
 #include "lib/memb.h"
 #include "net/netstack.h"
 
+/* Keep track of the check rate level of neighbors that check the
+   channel 2^level times per cycle, as ContikiMAC does with an
+   adaptive check rate. */
+#ifdef PHASE_CONF_RATE_LEVEL
+#define PHASE_RATE_LEVEL PHASE_CONF_RATE_LEVEL
+#elif defined(CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE)
+#define PHASE_RATE_LEVEL CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#else
+#define PHASE_RATE_LEVEL 0
+#endif
+
 typedef enum {
   PHASE_UNKNOWN,
   PHASE_SEND_NOW,
@@ -62,5 +73,9 @@ phase_status_t phase_wait(const linkaddr_t *neighbor,
 void phase_update(const linkaddr_t *neighbor,
                   rtimer_clock_t time, int mac_status);
 void phase_remove(const linkaddr_t *neighbor);
+#if PHASE_RATE_LEVEL
+void phase_set_rate_level(const linkaddr_t *neighbor, uint8_t level,
+                          clock_time_t lifetime);
+#endif /* PHASE_RATE_LEVEL */
 
 #endif /* PHASE_H */
@@ -62,6 +62,38 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH
+/* Hash index over the keys, using open addressing with linear probing.
+ * Each slot holds a neighbor index plus one, or zero if the slot is
+ * empty. The number of slots is a power of two that is at least twice
+ * the number of neighbors, so that probe sequences stay short. */
+#if NBR_TABLE_MAX_NEIGHBORS <= 4
+#define HASH_SIZE 8
+#elif NBR_TABLE_MAX_NEIGHBORS <= 8
+#define HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define HASH_SIZE 256
+#elif NBR_TABLE_MAX_NEIGHBORS <= 256
+#define HASH_SIZE 512
+#else
+#error NBR_TABLE_WITH_HASH supports at most 256 neighbors
+#endif
+
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t hash_slot_t;
+#else
+typedef uint16_t hash_slot_t;
+#endif
+
+static hash_slot_t hash_slots[HASH_SIZE];
+#endif /* NBR_TABLE_WITH_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -104,17 +136,90 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_WITH_HASH
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static int
+hash_from_lladdr(const linkaddr_t *lladdr)
+{
+  uint16_t h = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 5) + h + lladdr->u8[i];
+  }
+  return (h ^ (h >> 8)) & (HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Add the key at a neighbor index to the hash index */
+static void
+hash_add(int index)
+{
+  int slot = hash_from_lladdr(&key_from_index(index)->lladdr);
+
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) & (HASH_SIZE - 1);
+  }
+  hash_slots[slot] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the key at a neighbor index from the hash index */
+static void
+hash_remove(int index)
+{
+  int slot, next, home;
+
+  slot = hash_from_lladdr(&key_from_index(index)->lladdr);
+  while(hash_slots[slot] != index + 1) {
+    if(hash_slots[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) & (HASH_SIZE - 1);
+  }
+
+  /* Shift back the entries that follow in the probe sequence, so that
+   * no lookup stops at the hole we leave */
+  next = slot;
+  while(1) {
+    next = (next + 1) & (HASH_SIZE - 1);
+    if(hash_slots[next] == 0) {
+      break;
+    }
+    home = hash_from_lladdr(&key_from_index(hash_slots[next] - 1)->lladdr);
+    /* Move the entry unless its home slot lies cyclically in (slot, next] */
+    if(((next - home) & (HASH_SIZE - 1)) >= ((next - slot) & (HASH_SIZE - 1))) {
+      hash_slots[slot] = hash_slots[next];
+      slot = next;
+    }
+  }
+  hash_slots[slot] = 0;
+}
+#endif /* NBR_TABLE_WITH_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
   nbr_table_key_t *key;
+#if NBR_TABLE_WITH_HASH
+  int slot;
+#endif /* NBR_TABLE_WITH_HASH */
+
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_HASH
+  slot = hash_from_lladdr(lladdr);
+  while(hash_slots[slot] != 0) {
+    key = key_from_index(hash_slots[slot] - 1);
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return hash_slots[slot] - 1;
+    }
+    slot = (slot + 1) & (HASH_SIZE - 1);
+  }
+#else /* NBR_TABLE_WITH_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -122,6 +227,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_WITH_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -157,14 +263,14 @@ nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int val
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
-nbr_table_allocate(void)
+nbr_table_allocate(int evict)
 {
   nbr_table_key_t *key;
   int least_used_count = 0;
   nbr_table_key_t *least_used_key = NULL;
 
   key = memb_alloc(&neighbor_addr_mem);
-  if(key != NULL) {
+  if(key != NULL || !evict) {
     return key;
   } else { /* No more space, try to free a neighbor.
             * The replacement policy is the following: remove neighbor that is:
@@ -216,6 +322,10 @@ nbr_table_allocate(void)
       }
       /* Empty used map */
       used_map[index_from_key(least_used_key)] = 0;
+#if NBR_TABLE_WITH_HASH
+      /* Remove neighbor from hash index */
+      hash_remove(index_from_key(least_used_key));
+#endif /* NBR_TABLE_WITH_HASH */
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
       /* Return associated key */
@@ -267,9 +377,8 @@ nbr_table_next(nbr_table_t *table, nbr_table_item_t *item)
   return item;
 }
 /*---------------------------------------------------------------------------*/
-/* Add a neighbor indexed with its link-layer address */
-nbr_table_item_t *
-nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
+static nbr_table_item_t *
+add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, int evict)
 {
   int index;
   nbr_table_item_t *item;
@@ -283,7 +392,7 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
   if((index = index_from_lladdr(lladdr)) == -1) {
      /* Neighbor not yet in table, let's try to allocate one */
-    key = nbr_table_allocate();
+    key = nbr_table_allocate(evict);
 
     /* No space available for new entry */
     if(key == NULL) {
@@ -298,6 +407,11 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+
+#if NBR_TABLE_WITH_HASH
+    /* Add neighbor to hash index */
+    hash_add(index);
+#endif /* NBR_TABLE_WITH_HASH */
   }
 
   /* Get item in the current table */
@@ -310,6 +424,21 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
   return item;
 }
 /*---------------------------------------------------------------------------*/
+/* Add a neighbor indexed with its link-layer address */
+nbr_table_item_t *
+nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
+{
+  return add_lladdr(table, lladdr, 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor indexed with its link-layer address, unless that
+   would remove another neighbor to make room for it */
+nbr_table_item_t *
+nbr_table_add_lladdr_no_evict(nbr_table_t *table, const linkaddr_t *lladdr)
+{
+  return add_lladdr(table, lladdr, 0);
+}
+/*---------------------------------------------------------------------------*/
 /* Get an item from its link-layer address */
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
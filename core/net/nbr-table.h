@@ -46,6 +46,16 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Keep a hash index over the link-layer addresses of the neighbors, so
+ * that looking up a neighbor does not require a scan of all neighbors.
+ * Costs one or two bytes of RAM per hash slot, with at least twice as
+ * many hash slots as neighbors. */
+#ifdef NBR_TABLE_CONF_WITH_HASH
+#define NBR_TABLE_WITH_HASH NBR_TABLE_CONF_WITH_HASH
+#else /* NBR_TABLE_CONF_WITH_HASH */
+#define NBR_TABLE_WITH_HASH 0
+#endif /* NBR_TABLE_CONF_WITH_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -85,6 +95,7 @@ nbr_table_item_t *nbr_table_next(nbr_table_t *table, nbr_table_item_t *item);
 /** \name Neighbor tables: add and get data */
 /** @{ */
 nbr_table_item_t *nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
+nbr_table_item_t *nbr_table_add_lladdr_no_evict(nbr_table_t *table, const linkaddr_t *lladdr);
 nbr_table_item_t *nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr);
 /** @} */
 
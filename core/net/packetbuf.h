@@ -226,7 +226,8 @@ void *packetbuf_reference_ptr(void);
  *             portion of the packetbuf so that becomes consecutive to
  *             the header. It also copies external data that has
  *             previously been referenced with packetbuf_reference()
- *             into the packetbuf.
+ *             into the packetbuf, after which the packetbuf no longer
+ *             references the external data.
  *
  *             This function is called by the Rime code before a
  *             packet is to be sent by a device driver. This assures
@@ -64,6 +64,8 @@ struct queuebuf {
   int line;
   clock_time_t time;
 #endif /* QUEUEBUF_DEBUG */
+  /* The number of holders of the queuebuf, see queuebuf_share() */
+  uint8_t refs;
 #if WITH_SWAP
   enum {IN_RAM, IN_CFS} location;
   union {
@@ -77,22 +79,37 @@ struct queuebuf {
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+  uint16_t len;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
   uint8_t data[PACKETBUF_SIZE];
+};
+
+#if QUEUEBUF_SMALL_NUM > 0
+/* The queuebuf data of a short packet, used as a struct queuebuf_data
+   of which only the first QUEUEBUF_SMALL_SIZE data bytes exist */
+struct queuebuf_small_data {
   uint16_t len;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint8_t data[QUEUEBUF_SMALL_SIZE];
 };
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 
 struct queuebuf_ref {
+  uint8_t refs;
   uint16_t len;
   uint8_t *ref;
   uint8_t hdr[PACKETBUF_HDR_SIZE];
   uint8_t hdrlen;
 };
 
-MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
+MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM + QUEUEBUF_SMALL_NUM);
 MEMB(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+#if QUEUEBUF_SMALL_NUM > 0
+MEMB(bufsmallmem, struct queuebuf_small_data, QUEUEBUF_SMALL_NUM);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 
 #if WITH_SWAP
 
@@ -137,14 +154,20 @@ LIST(queuebuf_list);
 #define PRINTF(...)
 #endif
 
-#ifdef QUEUEBUF_CONF_STATS
-#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
+#if QUEUEBUF_STATS
+#include <stdio.h>
+
+/* Print the number of queuebufs in use each time it changes, as an
+   annotation for the simulator */
+#ifdef QUEUEBUF_CONF_STATS_ANNOTATE
+#define QUEUEBUF_STATS_ANNOTATE QUEUEBUF_CONF_STATS_ANNOTATE
 #else
-#define QUEUEBUF_STATS 0
-#endif /* QUEUEBUF_CONF_STATS */
+#define QUEUEBUF_STATS_ANNOTATE 1
+#endif /* QUEUEBUF_CONF_STATS_ANNOTATE */
 
-#if QUEUEBUF_STATS
 uint8_t queuebuf_len, queuebuf_ref_len, queuebuf_max_len;
+uint8_t queuebuf_small_len, queuebuf_peak_len;
+uint16_t queuebuf_full;
 #endif /* QUEUEBUF_STATS */
 
 #if WITH_SWAP
@@ -289,6 +312,41 @@ queuebuf_load_to_ram(struct queuebuf *b)
 }
 #endif /* WITH_SWAP */
 /*---------------------------------------------------------------------------*/
+/* Allocate RAM for a packet of len bytes, in a small buffer if it fits */
+static struct queuebuf_data *
+queuebuf_ram_alloc(uint16_t len)
+{
+#if QUEUEBUF_SMALL_NUM > 0
+  struct queuebuf_data *ptr;
+
+  if(len <= QUEUEBUF_SMALL_SIZE) {
+    ptr = memb_alloc(&bufsmallmem);
+    if(ptr != NULL) {
+#if QUEUEBUF_STATS
+      ++queuebuf_small_len;
+#endif /* QUEUEBUF_STATS */
+      return ptr;
+    }
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  return memb_alloc(&buframmem);
+}
+/*---------------------------------------------------------------------------*/
+static void
+queuebuf_ram_free(struct queuebuf_data *ptr)
+{
+#if QUEUEBUF_SMALL_NUM > 0
+  if(memb_inmemb(&bufsmallmem, ptr)) {
+    memb_free(&bufsmallmem, ptr);
+#if QUEUEBUF_STATS
+    --queuebuf_small_len;
+#endif /* QUEUEBUF_STATS */
+    return;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
+  memb_free(&buframmem, ptr);
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
 {
@@ -302,8 +360,11 @@ queuebuf_init(void)
   memb_init(&buframmem);
   memb_init(&bufmem);
   memb_init(&refbufmem);
+#if QUEUEBUF_SMALL_NUM > 0
+  memb_init(&bufsmallmem);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
 #if QUEUEBUF_STATS
-  queuebuf_max_len = QUEUEBUF_NUM;
+  queuebuf_max_len = QUEUEBUF_NUM + QUEUEBUF_SMALL_NUM;
 #endif /* QUEUEBUF_STATS */
 }
 /*---------------------------------------------------------------------------*/
@@ -313,7 +374,12 @@ queuebuf_numfree(void)
   if(packetbuf_is_reference()) {
     return memb_numfree(&refbufmem);
   } else {
+#if QUEUEBUF_SMALL_NUM > 0
+    /* Count the queuebufs that can hold a packet of any length */
+    return memb_numfree(&bufmem) - memb_numfree(&bufsmallmem);
+#else /* QUEUEBUF_SMALL_NUM > 0 */
     return memb_numfree(&bufmem);
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -334,11 +400,15 @@ queuebuf_new_from_packetbuf(void)
 #if QUEUEBUF_STATS
       ++queuebuf_ref_len;
 #endif /* QUEUEBUF_STATS */
+      rbuf->refs = 1;
       rbuf->len = packetbuf_datalen();
       rbuf->ref = packetbuf_reference_ptr();
       rbuf->hdrlen = packetbuf_copyto_hdr(rbuf->hdr);
     } else {
       PRINTF("queuebuf_new_from_packetbuf: could not allocate a reference queuebuf\n");
+#if QUEUEBUF_STATS
+      ++queuebuf_full;
+#endif /* QUEUEBUF_STATS */
     }
     return (struct queuebuf *)rbuf;
   } else {
@@ -351,7 +421,8 @@ queuebuf_new_from_packetbuf(void)
       buf->line = line;
       buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
-      buf->ram_ptr = memb_alloc(&buframmem);
+      buf->refs = 1;
+      buf->ram_ptr = queuebuf_ram_alloc(packetbuf_totlen());
 #if WITH_SWAP
       /* If the allocation failed, store the qbuf in swap files */
       if(buf->ram_ptr != NULL) {
@@ -367,6 +438,9 @@ queuebuf_new_from_packetbuf(void)
       if(buf->ram_ptr == NULL) {
         PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
         memb_free(&bufmem, buf);
+#if QUEUEBUF_STATS
+        ++queuebuf_full;
+#endif /* QUEUEBUF_STATS */
         return NULL;
       }
       buframptr = buf->ram_ptr;
@@ -387,8 +461,13 @@ queuebuf_new_from_packetbuf(void)
 
 #if QUEUEBUF_STATS
       ++queuebuf_len;
+      if(queuebuf_len > queuebuf_peak_len) {
+        queuebuf_peak_len = queuebuf_len;
+      }
       PRINTF("queuebuf len %d\n", queuebuf_len);
+#if QUEUEBUF_STATS_ANNOTATE
       printf("#A q=%d\n", queuebuf_len);
+#endif /* QUEUEBUF_STATS_ANNOTATE */
       if(queuebuf_len == queuebuf_max_len + 1) {
         queuebuf_free(buf);
         queuebuf_len--;
@@ -398,6 +477,9 @@ queuebuf_new_from_packetbuf(void)
 
     } else {
       PRINTF("queuebuf_new_from_packetbuf: could not allocate a queuebuf\n");
+#if QUEUEBUF_STATS
+      ++queuebuf_full;
+#endif /* QUEUEBUF_STATS */
     }
     return buf;
   }
@@ -415,10 +497,30 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 #endif
 }
 /*---------------------------------------------------------------------------*/
-void
+/*
+ * Returns zero, and leaves the queuebuf as it was, if the packet has
+ * outgrown its small buffer and no full-size buffer is free.
+ */
+int
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+#if QUEUEBUF_SMALL_NUM > 0
+  if(memb_inmemb(&bufsmallmem, buframptr) &&
+     packetbuf_totlen() > QUEUEBUF_SMALL_SIZE) {
+    /* The packet has outgrown its small buffer */
+    buframptr = memb_alloc(&buframmem);
+    if(buframptr == NULL) {
+      PRINTF("queuebuf_update_from_packetbuf: could not allocate queuebuf data\n");
+#if QUEUEBUF_STATS
+      ++queuebuf_full;
+#endif /* QUEUEBUF_STATS */
+      return 0;
+    }
+    queuebuf_ram_free(buf->ram_ptr);
+    buf->ram_ptr = buframptr;
+  }
+#endif /* QUEUEBUF_SMALL_NUM > 0 */
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
@@ -426,30 +528,39 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
     queuebuf_flush_tmpdata();
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
+    if(--buf->refs > 0) {
+      return;
+    }
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
-      memb_free(&buframmem, buf->ram_ptr);
+      queuebuf_ram_free(buf->ram_ptr);
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
-    memb_free(&buframmem, buf->ram_ptr);
+    queuebuf_ram_free(buf->ram_ptr);
 #endif
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
     --queuebuf_len;
+#if QUEUEBUF_STATS_ANNOTATE
     printf("#A q=%d\n", queuebuf_len);
+#endif /* QUEUEBUF_STATS_ANNOTATE */
 #endif /* QUEUEBUF_STATS */
 #if QUEUEBUF_DEBUG
     list_remove(queuebuf_list, buf);
 #endif /* QUEUEBUF_DEBUG */
   } else if(memb_inmemb(&refbufmem, buf)) {
+    if(--((struct queuebuf_ref *)buf)->refs > 0) {
+      return;
+    }
     memb_free(&refbufmem, buf);
 #if QUEUEBUF_STATS
     --queuebuf_ref_len;
@@ -457,6 +568,24 @@ queuebuf_free(struct queuebuf *buf)
   }
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Get another hold of a queuebuf instead of copying the packet into a
+ * new one, e.g. to keep it queued for logging while the MAC layer
+ * still retransmits it. The packet is freed when every holder has
+ * called queuebuf_free(). Updates of the packet are seen by all
+ * holders.
+ */
+struct queuebuf *
+queuebuf_share(struct queuebuf *buf)
+{
+  if(memb_inmemb(&bufmem, buf)) {
+    buf->refs++;
+  } else if(memb_inmemb(&refbufmem, buf)) {
+    ((struct queuebuf_ref *)buf)->refs++;
+  }
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_to_packetbuf(struct queuebuf *b)
 {
@@ -66,7 +66,11 @@
    If QUEUEBUFRAM_CONF_NUM is set lower than QUEUEBUF_NUM,
    swapping is enabled and queuebufs are stored either in RAM of CFS.
    If QUEUEBUFRAM_CONF_NUM is unset or >= to QUEUEBUF_NUM, all
-   queuebufs are in RAM and swapping is disabled. */
+   queuebufs are in RAM and swapping is disabled.
+   Swapped queuebufs are written to and read from CFS synchronously,
+   as CFS has no asynchronous interface. Sharing a queuebuf with
+   queuebuf_share(), and storing short packets in small buffers,
+   avoid swapping packets in the first place. */
 #ifdef QUEUEBUFRAM_CONF_NUM
   #if QUEUEBUFRAM_CONF_NUM>QUEUEBUF_NUM
     #error "QUEUEBUFRAM_CONF_NUM cannot be greater than QUEUEBUF_NUM"
@@ -79,12 +83,44 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_SMALL_NUM is the number of additional queuebufs that have
+   room for QUEUEBUF_SMALL_SIZE bytes of packet (header and data) only.
+   Short packets, e.g. acknowledgements, are stored in these before
+   taking a buffer of PACKETBUF_SIZE bytes. */
+#ifdef QUEUEBUF_CONF_SMALL_NUM
+#define QUEUEBUF_SMALL_NUM QUEUEBUF_CONF_SMALL_NUM
+#else
+#define QUEUEBUF_SMALL_NUM 0
+#endif
+
+#ifdef QUEUEBUF_CONF_SMALL_SIZE
+#define QUEUEBUF_SMALL_SIZE QUEUEBUF_CONF_SMALL_SIZE
+#else
+#define QUEUEBUF_SMALL_SIZE 48
+#endif
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
 #define QUEUEBUF_DEBUG 0
 #endif /* QUEUEBUF_CONF_DEBUG */
 
+#ifdef QUEUEBUF_CONF_STATS
+#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
+#else
+#define QUEUEBUF_STATS 0
+#endif /* QUEUEBUF_CONF_STATS */
+
+#if QUEUEBUF_STATS
+/* The number of queuebufs in use (copies and references), the
+   maximum number of queuebufs, the number of small buffers in use,
+   the highest number of queuebufs in use so far and the number of
+   packets that could not be queued. */
+extern uint8_t queuebuf_len, queuebuf_ref_len, queuebuf_max_len;
+extern uint8_t queuebuf_small_len, queuebuf_peak_len;
+extern uint16_t queuebuf_full;
+#endif /* QUEUEBUF_STATS */
+
 struct queuebuf;
 
 void queuebuf_init(void);
@@ -96,10 +132,11 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
 void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
-void queuebuf_update_from_packetbuf(struct queuebuf *b);
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
+struct queuebuf *queuebuf_share(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
 int queuebuf_datalen(struct queuebuf *b);
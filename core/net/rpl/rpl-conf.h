@@ -207,4 +207,18 @@
 #define RPL_INSERT_HBH_OPTION       1
 #endif
 
+/*
+ * Incremental parent selection
+ * Keeps the candidate parents of each DAG in a heap ordered by the
+ * path cost of the objective function, so that selecting a parent
+ * does not compare all parents. Only the parent whose information
+ * changed is re-sorted. Requires an objective function that
+ * implements parent_cost(); otherwise all parents are compared.
+ */
+#ifdef RPL_CONF_PARENT_HEAP
+#define RPL_PARENT_HEAP             RPL_CONF_PARENT_HEAP
+#else
+#define RPL_PARENT_HEAP             0
+#endif
+
 #endif /* RPL_CONF_H */
@@ -566,6 +566,135 @@ rpl_free_dag(rpl_dag_t *dag)
   }
   dag->used = 0;
 }
+#if RPL_PARENT_HEAP
+/*---------------------------------------------------------------------------*/
+/* The candidate parents of each DAG form a binary min-heap by path cost. */
+static uint16_t
+heap_cost(rpl_parent_t *p)
+{
+  if(p->rank == INFINITE_RANK) {
+    return 0xffff;
+  }
+  return p->dag->instance->of->parent_cost(p);
+}
+/*---------------------------------------------------------------------------*/
+static int
+heap_contains(rpl_parent_t *p)
+{
+  return p->dag != NULL && p->heap_index < p->dag->parent_heap_len &&
+    p->dag->parent_heap[p->heap_index] == p;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_set(rpl_dag_t *dag, int i, rpl_parent_t *p)
+{
+  dag->parent_heap[i] = p;
+  p->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_up(rpl_dag_t *dag, int i)
+{
+  rpl_parent_t *p;
+  int up;
+
+  p = dag->parent_heap[i];
+  while(i > 0) {
+    up = (i - 1) / 2;
+    if(dag->parent_heap[up]->heap_cost <= p->heap_cost) {
+      break;
+    }
+    heap_set(dag, i, dag->parent_heap[up]);
+    i = up;
+  }
+  heap_set(dag, i, p);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_down(rpl_dag_t *dag, int i)
+{
+  rpl_parent_t *p;
+  int down;
+
+  p = dag->parent_heap[i];
+  while((down = 2 * i + 1) < dag->parent_heap_len) {
+    if(down + 1 < dag->parent_heap_len &&
+       dag->parent_heap[down + 1]->heap_cost < dag->parent_heap[down]->heap_cost) {
+      down++;
+    }
+    if(p->heap_cost <= dag->parent_heap[down]->heap_cost) {
+      break;
+    }
+    heap_set(dag, i, dag->parent_heap[down]);
+    i = down;
+  }
+  heap_set(dag, i, p);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove_at(rpl_dag_t *dag, int i)
+{
+  rpl_parent_t *last;
+
+  last = dag->parent_heap[--dag->parent_heap_len];
+  if(i < dag->parent_heap_len) {
+    heap_set(dag, i, last);
+    heap_sift_up(dag, i);
+    heap_sift_down(dag, last->heap_index);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(rpl_parent_t *p)
+{
+  if(heap_contains(p)) {
+    heap_remove_at(p->dag, p->heap_index);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Sorts a parent into the heap of its DAG after its information changed. */
+static void
+heap_update(rpl_parent_t *p)
+{
+  rpl_dag_t *dag;
+
+  dag = p->dag;
+  if(dag == NULL || dag->instance == NULL || dag->instance->of == NULL ||
+     dag->instance->of->parent_cost == NULL) {
+    return;
+  }
+  if(!heap_contains(p)) {
+    if(dag->parent_heap_len >= NBR_TABLE_MAX_NEIGHBORS) {
+      return;
+    }
+    heap_set(dag, dag->parent_heap_len++, p);
+  }
+  p->heap_cost = heap_cost(p);
+  heap_sift_up(dag, p->heap_index);
+  heap_sift_down(dag, p->heap_index);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the parent with the lowest path cost. */
+static rpl_parent_t *
+heap_top(rpl_dag_t *dag)
+{
+  rpl_parent_t *p;
+
+  while(dag->parent_heap_len > 0) {
+    p = dag->parent_heap[0];
+    if(p->dag != dag || p->heap_index != 0) {
+      /* The parent was reused for another DAG or neighbor. */
+      heap_remove_at(dag, 0);
+    } else if(p->heap_cost != heap_cost(p)) {
+      /* Its metrics changed without an event for it yet. */
+      heap_update(p);
+    } else {
+      return p;
+    }
+  }
+  return NULL;
+}
+#endif /* RPL_PARENT_HEAP */
 /*---------------------------------------------------------------------------*/
 rpl_parent_t *
 rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
@@ -579,6 +708,13 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
   PRINT6ADDR(addr);
   PRINTF("\n");
   if(lladdr != NULL) {
+#if RPL_PARENT_HEAP
+    /* Adding resets an existing parent; take it out of its heap first. */
+    p = nbr_table_get_from_lladdr(rpl_parents, (linkaddr_t *)lladdr);
+    if(p != NULL) {
+      heap_remove(p);
+    }
+#endif /* RPL_PARENT_HEAP */
     /* Add parent in rpl_parents */
     p = nbr_table_add_lladdr(rpl_parents, (linkaddr_t *)lladdr);
     if(p == NULL) {
@@ -598,6 +734,9 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
+#if RPL_PARENT_HEAP
+      heap_update(p);
+#endif /* RPL_PARENT_HEAP */
     }
   }
 
@@ -743,6 +882,24 @@ best_parent(rpl_dag_t *dag)
 
   best = NULL;
 
+#if RPL_PARENT_HEAP
+  if(dag->instance->of->parent_cost != NULL) {
+    best = heap_top(dag);
+    if(best == NULL || best->rank == INFINITE_RANK) {
+      return NULL;
+    }
+    p = dag->preferred_parent;
+    if(p != NULL && p != best && p->dag == dag && p->rank != INFINITE_RANK) {
+      /* Let the objective function apply its hysteresis. */
+      best = dag->instance->of->best_parent(p, best);
+      if(best == p) {
+        RPL_STAT(rpl_stats.parent_switch_suppressed++);
+      }
+    }
+    return best;
+  }
+#endif /* RPL_PARENT_HEAP */
+
   p = nbr_table_head(rpl_parents);
   while(p != NULL) {
     if(p->dag != dag || p->rank == INFINITE_RANK) {
@@ -779,6 +936,9 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
+#if RPL_PARENT_HEAP
+  heap_remove(parent);
+#endif /* RPL_PARENT_HEAP */
   nbr_table_remove(rpl_parents, parent);
 }
 /*---------------------------------------------------------------------------*/
@@ -834,7 +994,13 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   PRINT6ADDR(rpl_get_parent_ipaddr(parent));
   PRINTF("\n");
 
+#if RPL_PARENT_HEAP
+  heap_remove(parent);
+#endif /* RPL_PARENT_HEAP */
   parent->dag = dag_dst;
+#if RPL_PARENT_HEAP
+  heap_update(parent);
+#endif /* RPL_PARENT_HEAP */
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
@@ -1151,6 +1317,10 @@ rpl_process_parent_event(rpl_instance_t *instance, rpl_parent_t *p)
 
   return_value = 1;
 
+#if RPL_PARENT_HEAP
+  heap_update(p);
+#endif /* RPL_PARENT_HEAP */
+
   if(!acceptable_rank(p->dag, p->rank)) {
     /* The candidate parent is no longer valid: the rank increase resulting
        from the choice of it as a parent would be too high. */
@@ -246,6 +246,7 @@ struct rpl_stats {
   uint16_t loop_errors;
   uint16_t loop_warnings;
   uint16_t root_repairs;
+  uint16_t parent_switch_suppressed;
 };
 typedef struct rpl_stats rpl_stats_t;
 
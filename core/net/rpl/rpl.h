@@ -116,6 +116,11 @@ struct rpl_parent {
   rpl_rank_t rank;
   uint8_t dtsn;
   uint8_t flags;
+#if RPL_PARENT_HEAP
+  /* path cost when the parent was last sorted into the heap */
+  uint16_t heap_cost;
+  uint8_t heap_index;
+#endif /* RPL_PARENT_HEAP */
 };
 typedef struct rpl_parent rpl_parent_t;
 /*---------------------------------------------------------------------------*/
@@ -142,6 +147,11 @@ struct rpl_dag {
   rpl_rank_t rank;
   struct rpl_instance *instance;
   rpl_prefix_t prefix_info;
+#if RPL_PARENT_HEAP
+  /* candidate parents, the one with the lowest path cost first */
+  rpl_parent_t *parent_heap[NBR_TABLE_MAX_NEIGHBORS];
+  uint8_t parent_heap_len;
+#endif /* RPL_PARENT_HEAP */
 };
 typedef struct rpl_dag rpl_dag_t;
 typedef struct rpl_instance rpl_instance_t;
@@ -180,6 +190,12 @@ typedef struct rpl_instance rpl_instance_t;
  *  Updates the metric container for outgoing DIOs in a certain DAG.
  *  If the objective function of the DAG does not use metric containers, 
  *  the function should set the object type to RPL_DAG_MC_NONE.
+ *
+ * parent_cost(parent)
+ *
+ *  Returns the cost of the path through a parent, which best_parent()
+ *  compares apart from hysteresis. Optional; used to keep the parents
+ *  sorted when RPL_CONF_PARENT_HEAP is set.
  */
 struct rpl_of {
   void (*reset)(struct rpl_dag *);
@@ -189,6 +205,7 @@ struct rpl_of {
   rpl_rank_t (*calculate_rank)(rpl_parent_t *, rpl_rank_t);
   void (*update_metric_container)( rpl_instance_t *);
   rpl_ocp_t ocp;
+  uint16_t (*parent_cost)(rpl_parent_t *);
 };
 typedef struct rpl_of rpl_of_t;
 
@@ -82,6 +82,18 @@
 #define CLOCK_SECOND (clock_time_t)32
 #endif
 
+/**
+ * Check if a clock time value is less than another clock time value,
+ * taking wrap-around of the clock into account. The two values must
+ * be less than half the range of clock_time_t apart.
+ *
+ * \hideinitializer
+ */
+#ifndef CLOCK_LT
+#define CLOCK_LT(a, b) \
+  ((clock_time_t)((a) - (b)) > ((clock_time_t)~(clock_time_t)0 >> 1))
+#endif /* CLOCK_LT */
+
 /**
  * Initialize the clock library.
  *
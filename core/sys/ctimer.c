@@ -58,6 +58,149 @@ static char initialized;
 #define PRINTF(...)
 #endif
 
+#if CTIMER_CONF_QUEUE
+/*
+ * The pending callback timers are kept on ctimer_list, sorted by
+ * expiration time, and a single event timer wakes up the ctimer
+ * process when the first of them expires. The process pointer of the
+ * embedded event timer is set to the ctimer process while a callback
+ * timer is pending, so that etimer_expired() and
+ * etimer_expiration_time() still work on it.
+ */
+#define EXPIRATION(c) ((c)->etimer.timer.start + (c)->etimer.timer.interval)
+
+static struct etimer queue_timer;
+/*---------------------------------------------------------------------------*/
+PROCESS(ctimer_process, "Ctimer process");
+/*---------------------------------------------------------------------------*/
+/* Set the event timer to the expiration time of the first callback
+   timer, allowing for the slack. */
+static void
+schedule(void)
+{
+  struct ctimer *c;
+  clock_time_t now, expiration;
+
+  if(!initialized) {
+    return;
+  }
+  c = list_head(ctimer_list);
+  if(c == NULL) {
+    etimer_stop(&queue_timer);
+    return;
+  }
+
+  now = clock_time();
+  expiration = EXPIRATION(c) + CTIMER_SLACK;
+  PROCESS_CONTEXT_BEGIN(&ctimer_process);
+  etimer_set(&queue_timer, CLOCK_LT(now, expiration) ? expiration - now : 0);
+  PROCESS_CONTEXT_END(&ctimer_process);
+}
+/*---------------------------------------------------------------------------*/
+/* Insert the callback timer in the list, after any timers that
+   expire at the same time. */
+static void
+add_timer(struct ctimer *c)
+{
+  struct ctimer *t, *prev;
+
+  list_remove(ctimer_list, c);
+  c->etimer.p = &ctimer_process;
+
+  prev = NULL;
+  for(t = list_head(ctimer_list);
+      t != NULL && !CLOCK_LT(EXPIRATION(c), EXPIRATION(t));
+      t = t->next) {
+    prev = t;
+  }
+  list_insert(ctimer_list, prev, c);
+
+  if(prev == NULL) {
+    schedule();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ctimer_process, ev, data)
+{
+  struct ctimer *c;
+  PROCESS_BEGIN();
+
+  initialized = 1;
+  schedule();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    /* Call all callback timers that have expired, which with slack
+       may be several timers that expired at different times. */
+    while((c = list_head(ctimer_list)) != NULL &&
+          timer_expired(&c->etimer.timer)) {
+      list_remove(ctimer_list, c);
+      c->etimer.p = PROCESS_NONE;
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
+      }
+      PROCESS_CONTEXT_END(c->p);
+    }
+    schedule();
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_init(void)
+{
+  initialized = 0;
+  list_init(ctimer_list);
+  process_start(&ctimer_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_set(struct ctimer *c, clock_time_t t,
+	   void (*f)(void *), void *ptr)
+{
+  PRINTF("ctimer_set %p %u\n", c, (unsigned)t);
+  c->p = PROCESS_CURRENT();
+  c->f = f;
+  c->ptr = ptr;
+  timer_set(&c->etimer.timer, t);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_reset(struct ctimer *c)
+{
+  timer_reset(&c->etimer.timer);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_restart(struct ctimer *c)
+{
+  timer_restart(&c->etimer.timer);
+  add_timer(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_stop(struct ctimer *c)
+{
+  if(c == list_head(ctimer_list)) {
+    list_remove(ctimer_list, c);
+    schedule();
+  } else {
+    list_remove(ctimer_list, c);
+  }
+  c->etimer.next = NULL;
+  c->etimer.p = PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+int
+ctimer_expired(struct ctimer *c)
+{
+  return c->etimer.p == PROCESS_NONE;
+}
+#else /* CTIMER_CONF_QUEUE */
 /*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
 PROCESS_THREAD(ctimer_process, ev, data)
@@ -164,5 +307,6 @@ ctimer_expired(struct ctimer *c)
   }
   return 1;
 }
+#endif /* CTIMER_CONF_QUEUE */
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -56,6 +56,29 @@
 
 #include "sys/etimer.h"
 
+/**
+ * When CTIMER_CONF_QUEUE is set, the callback timers are kept in a
+ * list sorted by expiration time and are driven by a single event
+ * timer, instead of each callback timer using an event timer of its
+ * own. This reduces the number of event timers and events in the
+ * system.
+ */
+#ifndef CTIMER_CONF_QUEUE
+#define CTIMER_CONF_QUEUE 0
+#endif /* CTIMER_CONF_QUEUE */
+
+/**
+ * The number of clock ticks that a callback timer may be delayed
+ * beyond its expiration time so that it can be called in the same
+ * wake-up as other callback timers. A callback timer is never called
+ * before it has expired. Only used with CTIMER_CONF_QUEUE.
+ */
+#ifdef CTIMER_CONF_SLACK
+#define CTIMER_SLACK CTIMER_CONF_SLACK
+#else /* CTIMER_CONF_SLACK */
+#define CTIMER_SLACK 0
+#endif /* CTIMER_CONF_SLACK */
+
 struct ctimer {
   struct ctimer *next;
   struct etimer etimer;
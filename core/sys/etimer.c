@@ -54,6 +54,216 @@ static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_CONF_HEAP
+/*
+ * The active timers are kept in a pairing heap ordered by expiration
+ * time, with timerlist pointing to the root. Each timer links to its
+ * first child and next sibling, and prev points to the left sibling
+ * or, for a first child, to the parent. A timer is in the heap if and
+ * only if its p field is not PROCESS_NONE.
+ */
+
+/* Non-zero if timer a expires before timer b. The comparison is
+   correct as long as the timers expire within half the range of
+   clock_time_t from each other. */
+#define EXPIRATION(t) ((t)->timer.start + (t)->timer.interval)
+#define EXPIRES_BEFORE(a, b) CLOCK_LT(EXPIRATION(a), EXPIRATION(b))
+
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if(EXPIRES_BEFORE(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  /* Make b the first child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/* Merge a list of siblings into a single heap, using the standard
+   two-pass pairing. */
+static struct etimer *
+merge_pairs(struct etimer *first)
+{
+  struct etimer *a, *b, *pairs;
+
+  /* First pass: meld the siblings pairwise from left to right,
+     collecting the results in reverse order. */
+  pairs = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    if(b != NULL) {
+      first = b->next;
+      a = meld(a, b);
+    } else {
+      first = NULL;
+      a->next = a->prev = NULL;
+    }
+    a->next = pairs;
+    pairs = a;
+  }
+
+  /* Second pass: meld the pairs from right to left. */
+  a = NULL;
+  while(pairs != NULL) {
+    b = pairs;
+    pairs = pairs->next;
+    b->next = NULL;
+    a = meld(a, b);
+  }
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_insert(struct etimer *t)
+{
+  t->child = t->next = t->prev = NULL;
+  timerlist = meld(timerlist, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  if(t == timerlist) {
+    timerlist = merge_pairs(t->child);
+  } else {
+    /* Unlink t and its subtree from its parent or left sibling. */
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    timerlist = meld(timerlist, merge_pairs(t->child));
+  }
+  t->child = t->next = t->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the first timer owned by process p, in preorder. */
+static struct etimer *
+heap_find_process(struct process *p)
+{
+  struct etimer *t;
+
+  t = timerlist;
+  while(t != NULL) {
+    if(t->p == p) {
+      return t;
+    }
+    if(t->child != NULL) {
+      t = t->child;
+    } else {
+      /* Move on to the next sibling of t or of its nearest ancestor. */
+      while(t != NULL && t->next == NULL) {
+        while(t->prev != NULL && t->prev->child != t) {
+          t = t->prev;
+        }
+        t = t->prev;
+      }
+      if(t != NULL) {
+        t = t->next;
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = EXPIRATION(timerlist);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t;
+
+  PROCESS_BEGIN();
+
+  timerlist = NULL;
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      while((t = heap_find_process(data)) != NULL) {
+        heap_remove(t);
+        t->p = PROCESS_NONE;
+      }
+      update_time();
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    /* The timers expire in order, so we only need to look at the root
+       of the heap. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        /* Reset the process ID of the event timer, to signal that the
+           etimer has expired. This is later checked in the
+           etimer_expired() function. */
+        heap_remove(t);
+        t->p = PROCESS_NONE;
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+    update_time();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  if(timer->p != PROCESS_NONE) {
+    /* Timer already in the heap, move it to its new position. */
+    heap_remove(timer);
+  }
+
+  timer->p = PROCESS_CURRENT();
+  heap_insert(timer);
+
+  update_time();
+}
+#else /* ETIMER_CONF_HEAP */
 static void
 update_time(void)
 {
@@ -92,6 +302,7 @@ PROCESS_THREAD(etimer_process, ev, data)
       struct process *p = data;
 
       while(timerlist != NULL && timerlist->p == p) {
+	timerlist->p = PROCESS_NONE;
 	timerlist = timerlist->next;
       }
 
@@ -99,6 +310,7 @@ PROCESS_THREAD(etimer_process, ev, data)
 	t = timerlist;
 	while(t->next != NULL) {
 	  if(t->next->p == p) {
+	    t->next->p = PROCESS_NONE;
 	    t->next = t->next->next;
 	  } else
 	    t = t->next;
@@ -172,6 +384,7 @@ add_timer(struct etimer *timer)
 
   update_time();
 }
+#endif /* ETIMER_CONF_HEAP */
 /*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
@@ -197,7 +410,17 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_CONF_HEAP
+  if(et->p != PROCESS_NONE) {
+    heap_remove(et);
+    et->timer.start += timediff;
+    heap_insert(et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_CONF_HEAP */
   et->timer.start += timediff;
+#endif /* ETIMER_CONF_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -234,6 +457,12 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_CONF_HEAP
+  if(et->p != PROCESS_NONE) {
+    heap_remove(et);
+    update_time();
+  }
+#else /* ETIMER_CONF_HEAP */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -257,6 +486,7 @@ etimer_stop(struct etimer *et)
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
+#endif /* ETIMER_CONF_HEAP */
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
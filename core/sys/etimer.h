@@ -65,6 +65,17 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * When ETIMER_CONF_HEAP is set, the active event timers are kept in a
+ * heap ordered by expiration time instead of an unsorted list. This
+ * makes setting, stopping and expiring a timer O(log n) rather than
+ * O(n) at the cost of two more pointers per event timer, and is
+ * useful on systems with many concurrent event timers.
+ */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +88,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_CONF_HEAP
+  struct etimer *child, *prev;
+#endif /* ETIMER_CONF_HEAP */
 };
 
 /**
@@ -44,6 +44,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
@@ -63,9 +64,32 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_CONF_PRIORITIES
+  process_num_events_t next;
+#endif /* PROCESS_CONF_PRIORITIES */
 };
 
+#if PROCESS_CONF_PRIORITIES
+/*
+ * With priorities, the event slots are linked into one FIFO list per
+ * priority level, and unused slots are kept on a free list. Bit n in
+ * ready_levels is set when the list for level n is non-empty, so that
+ * the most urgent level can be found without scanning the queues.
+ */
+#define NO_EVENT PROCESS_CONF_NUMEVENTS
+
+static process_num_events_t nevents, free_events;
+static process_num_events_t queue_head[PROCESS_PRIO_LEVELS];
+static process_num_events_t queue_tail[PROCESS_PRIO_LEVELS];
+static unsigned char ready_levels;
+
+/* The index of the least significant bit set in ready_levels. */
+static const unsigned char lowest_bit[16] = {
+  0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+#else /* PROCESS_CONF_PRIORITIES */
 static process_num_events_t nevents, fevent;
+#endif /* PROCESS_CONF_PRIORITIES */
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
 #if PROCESS_CONF_STATS
@@ -74,11 +98,40 @@ process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+/*
+ * Subscriptions to broadcast events. A slot is free when p is
+ * NULL. Bit n in subscribed_events is set when event n has at least
+ * one subscriber.
+ */
+struct subscription {
+  struct process *p;
+  process_event_t ev;
+};
+
+static struct subscription subscriptions[PROCESS_CONF_SUBSCRIPTIONS];
+static unsigned char subscribed_events[256 / 8];
+
+#define HAS_SUBSCRIBERS(ev) (subscribed_events[(ev) >> 3] & (1 << ((ev) & 7)))
+
+/*
+ * The kernel events, such as PROCESS_EVENT_EXITED, are always
+ * delivered to all processes, as system services like the etimer and
+ * tcpip processes rely on them to clean up after exited processes.
+ */
+#define IS_KERNEL_EVENT(ev) ((ev) >= PROCESS_EVENT_NONE && \
+                             (ev) < PROCESS_EVENT_MAX)
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_CONF_SUBSCRIPTIONS
+static void remove_subscriptions(struct process *p, process_event_t ev,
+                                 unsigned char all);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
 #define DEBUG 0
 #if DEBUG
@@ -157,6 +210,10 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+  remove_subscriptions(p, 0, 1);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -207,14 +264,32 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+#if PROCESS_CONF_PRIORITIES
+  process_num_events_t i;
+#endif /* PROCESS_CONF_PRIORITIES */
+
   lastevent = PROCESS_EVENT_MAX;
 
+#if PROCESS_CONF_PRIORITIES
+  nevents = 0;
+  ready_levels = 0;
+  for(i = 0; i < PROCESS_CONF_NUMEVENTS; i++) {
+    events[i].next = i + 1;
+  }
+  free_events = 0;
+#else /* PROCESS_CONF_PRIORITIES */
   nevents = fevent = 0;
+#endif /* PROCESS_CONF_PRIORITIES */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
 
   process_current = process_list = NULL;
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+  memset(subscriptions, 0, sizeof(subscriptions));
+  memset(subscribed_events, 0, sizeof(subscribed_events));
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 }
 /*---------------------------------------------------------------------------*/
 /*
@@ -259,20 +334,57 @@ do_event(void)
    */
 
   if(nevents > 0) {
-    
+#if PROCESS_CONF_PRIORITIES
+    static unsigned char level;
+    static process_num_events_t fevent;
+
+    /* Take the first event of the most urgent level that has events
+       waiting. */
+    level = lowest_bit[ready_levels];
+    fevent = queue_head[level];
+    queue_head[level] = events[fevent].next;
+    if(queue_head[level] == NO_EVENT) {
+      ready_levels &= ~(1 << level);
+    }
+#endif /* PROCESS_CONF_PRIORITIES */
+
     /* There are events that we should deliver. */
     ev = events[fevent].ev;
     
     data = events[fevent].data;
     receiver = events[fevent].p;
 
+#if PROCESS_CONF_PRIORITIES
+    /* Since we have seen the new event, we return its slot to the
+       free list and decrease the number of events. */
+    events[fevent].next = free_events;
+    free_events = fevent;
+#else /* PROCESS_CONF_PRIORITIES */
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_CONF_PRIORITIES */
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
+#if PROCESS_CONF_SUBSCRIPTIONS
+    /* Events that processes have subscribed to are delivered only to
+       the subscribers, in the order of their slots. */
+    if(receiver == PROCESS_BROADCAST && HAS_SUBSCRIBERS(ev)) {
+      static int i;
+
+      for(i = 0; i < PROCESS_CONF_SUBSCRIPTIONS; i++) {
+        p = subscriptions[i].p;
+        if(p != NULL && subscriptions[i].ev == ev) {
+          if(poll_requested) {
+            do_poll();
+          }
+          call_process(p, ev, data);
+        }
+      }
+    } else
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
     if(receiver == PROCESS_BROADCAST) {
       for(p = process_list; p != NULL; p = p->next) {
 
@@ -301,13 +413,21 @@ do_event(void)
 int
 process_run(void)
 {
+  process_num_events_t i;
+
   /* Process poll events. */
   if(poll_requested) {
     do_poll();
   }
 
-  /* Process one event from the queue */
-  do_event();
+  /* Process one event from the queue, or more if batching is
+     enabled. Poll handlers are called inbetween the events. */
+  for(i = 0; i < PROCESS_BATCH_EVENTS && nevents > 0; i++) {
+    if(i > 0 && poll_requested) {
+      do_poll();
+    }
+    do_event();
+  }
 
   return nevents + poll_requested;
 }
@@ -343,7 +463,32 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
+#if PROCESS_CONF_PRIORITIES
+  {
+    static unsigned char level;
+
+    snum = free_events;
+    free_events = events[snum].next;
+
+    if(p == PROCESS_BROADCAST) {
+      level = PROCESS_BROADCAST_PRIO;
+    } else {
+      level = p->prio;
+    }
+
+    /* Append the event to the queue of its priority level. */
+    events[snum].next = NO_EVENT;
+    if(ready_levels & (1 << level)) {
+      events[queue_tail[level]].next = snum;
+    } else {
+      queue_head[level] = snum;
+      ready_levels |= 1 << level;
+    }
+    queue_tail[level] = snum;
+  }
+#else /* PROCESS_CONF_PRIORITIES */
   snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
+#endif /* PROCESS_CONF_PRIORITIES */
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
@@ -379,6 +524,88 @@ process_poll(struct process *p)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITIES
+void
+process_set_priority(struct process *p, unsigned char prio)
+{
+  if(prio >= PROCESS_PRIO_LEVELS) {
+    prio = PROCESS_PRIO_LEVELS - 1;
+  }
+  p->prio = prio;
+}
+#endif /* PROCESS_CONF_PRIORITIES */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_SUBSCRIPTIONS
+static void
+remove_subscriptions(struct process *p, process_event_t ev, unsigned char all)
+{
+  int i, j;
+
+  for(i = 0; i < PROCESS_CONF_SUBSCRIPTIONS; i++) {
+    if(subscriptions[i].p == p && (all || subscriptions[i].ev == ev)) {
+      subscriptions[i].p = NULL;
+
+      /* Revert the event to ordinary broadcast delivery if this was
+         its last subscriber. */
+      for(j = 0; j < PROCESS_CONF_SUBSCRIPTIONS; j++) {
+        if(subscriptions[j].p != NULL &&
+           subscriptions[j].ev == subscriptions[i].ev) {
+          break;
+        }
+      }
+      if(j == PROCESS_CONF_SUBSCRIPTIONS) {
+        subscribed_events[subscriptions[i].ev >> 3] &=
+          ~(1 << (subscriptions[i].ev & 7));
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+process_subscribe(process_event_t ev)
+{
+  int i, free_slot;
+
+  if(PROCESS_CURRENT() == NULL) {
+    return PROCESS_ERR_FULL;
+  }
+  if(IS_KERNEL_EVENT(ev)) {
+    /* Delivered to every process anyway. */
+    return PROCESS_ERR_OK;
+  }
+
+  free_slot = -1;
+  for(i = 0; i < PROCESS_CONF_SUBSCRIPTIONS; i++) {
+    if(subscriptions[i].p == PROCESS_CURRENT() &&
+       subscriptions[i].ev == ev) {
+      /* Already subscribed. */
+      return PROCESS_ERR_OK;
+    }
+    if(subscriptions[i].p == NULL && free_slot < 0) {
+      free_slot = i;
+    }
+  }
+
+  if(free_slot < 0) {
+    PRINTF("process_subscribe: no free slot for event %d\n", ev);
+    return PROCESS_ERR_FULL;
+  }
+
+  subscriptions[free_slot].p = PROCESS_CURRENT();
+  subscriptions[free_slot].ev = ev;
+  subscribed_events[ev >> 3] |= 1 << (ev & 7);
+  return PROCESS_ERR_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(process_event_t ev)
+{
+  if(PROCESS_CURRENT() != NULL) {
+    remove_subscriptions(PROCESS_CURRENT(), ev, 0);
+  }
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
 {
@@ -88,6 +88,60 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priorities
+ *
+ * When PROCESS_CONF_PRIORITIES is set, every process has a priority
+ * level and events posted to a process are queued on the level of
+ * the receiving process. process_run() always dispatches the oldest
+ * event of the most urgent non-empty level. Events within a level are
+ * delivered in FIFO order. Broadcast events are queued on
+ * PROCESS_CONF_BROADCAST_PRIO.
+ *
+ * When PROCESS_CONF_PRIORITIES is not set, all events share a single
+ * FIFO queue and process_set_priority() has no effect.
+ * @{
+ */
+#ifndef PROCESS_CONF_PRIORITIES
+#define PROCESS_CONF_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+/** Priority level for time-critical processes, such as radio drivers */
+#define PROCESS_PRIO_HIGH     0
+/** Default priority level of all processes */
+#define PROCESS_PRIO_NORMAL   1
+/** Priority level for background processes */
+#define PROCESS_PRIO_LOW      2
+/** Number of priority levels */
+#define PROCESS_PRIO_LEVELS   3
+
+#ifdef PROCESS_CONF_BROADCAST_PRIO
+#define PROCESS_BROADCAST_PRIO PROCESS_CONF_BROADCAST_PRIO
+#else /* PROCESS_CONF_BROADCAST_PRIO */
+#define PROCESS_BROADCAST_PRIO PROCESS_PRIO_NORMAL
+#endif /* PROCESS_CONF_BROADCAST_PRIO */
+/** @} */
+
+/**
+ * The number of broadcast event subscriptions that can be active at
+ * the same time. Zero disables process_subscribe().
+ */
+#ifndef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_CONF_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
+/**
+ * The maximum number of events that process_run() dispatches before
+ * it returns to the caller. Poll handlers are still called between
+ * each event. Draining several events per call reduces the overhead
+ * of the main loop when the event queue is busy.
+ */
+#ifdef PROCESS_CONF_BATCH_EVENTS
+#define PROCESS_BATCH_EVENTS PROCESS_CONF_BATCH_EVENTS
+#else /* PROCESS_CONF_BATCH_EVENTS */
+#define PROCESS_BATCH_EVENTS 1
+#endif /* PROCESS_CONF_BATCH_EVENTS */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -298,16 +352,24 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
  *
  * \hideinitializer
  */
+#if PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIO_INITIALIZER , { 0 }, 0, 0, PROCESS_PRIO_NORMAL
+#else
+#define PROCESS_PRIO_INITIALIZER
+#endif
+
 #if PROCESS_CONF_NO_PROCESS_NAMES
 #define PROCESS(name, strname)				\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL,		        \
-                          process_thread_##name }
+                          process_thread_##name	\
+                          PROCESS_PRIO_INITIALIZER }
 #else
 #define PROCESS(name, strname)				\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL, strname,		\
-                          process_thread_##name }
+                          process_thread_##name	\
+                          PROCESS_PRIO_INITIALIZER }
 #endif
 
 /** @} */
@@ -323,6 +385,9 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PRIORITIES
+  unsigned char prio;
+#endif
 };
 
 /**
@@ -389,6 +454,24 @@ CCIF void process_post_synch(struct process *p,
  */
 CCIF void process_exit(struct process *p);
 
+/**
+ * \brief      Set the priority level of a process
+ * \param p    The process
+ * \param prio The priority level, PROCESS_PRIO_HIGH,
+ *             PROCESS_PRIO_NORMAL or PROCESS_PRIO_LOW
+ *
+ *             Events that are posted to the process after this call
+ *             are queued on the new priority level. Events that
+ *             already are in the queue are not moved.
+ *
+ *             This function does nothing unless
+ *             PROCESS_CONF_PRIORITIES is set.
+ */
+#if PROCESS_CONF_PRIORITIES
+CCIF void process_set_priority(struct process *p, unsigned char prio);
+#else
+#define process_set_priority(p, prio)
+#endif
 
 /**
  * Get a pointer to the currently running process.
@@ -452,6 +535,46 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+/**
+ * \brief      Subscribe the current process to a broadcast event
+ * \param ev   The event
+ * \retval PROCESS_ERR_OK The process is subscribed to the event.
+ * \retval PROCESS_ERR_FULL There are no free subscription slots.
+ *
+ *             Broadcast events are normally delivered to every
+ *             process in the system. Once at least one process has
+ *             subscribed to an event, broadcasts of that event are
+ *             delivered only to the subscribed processes, in the
+ *             order of the slots they hold in the subscription table,
+ *             which need not be the order in which they subscribed.
+ *             Events without subscribers are delivered to all
+ *             processes as before, so every process that handles a
+ *             subscribed event must subscribe to it.
+ *
+ *             The kernel events, PROCESS_EVENT_NONE up to
+ *             PROCESS_EVENT_MAX, such as PROCESS_EVENT_EXITED, are
+ *             always delivered to all processes. Subscribing to them
+ *             has no effect.
+ *
+ *             Subscriptions are removed when the process exits.
+ *
+ *             This function is available when
+ *             PROCESS_CONF_SUBSCRIPTIONS is non-zero.
+ */
+CCIF int process_subscribe(process_event_t ev);
+
+/**
+ * \brief      Unsubscribe the current process from a broadcast event
+ * \param ev   The event
+ *
+ *             When the last subscriber of an event unsubscribes,
+ *             broadcasts of the event are again delivered to all
+ *             processes.
+ */
+CCIF void process_unsubscribe(process_event_t ev);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 /** @} */
 
 /**
@@ -489,7 +612,8 @@ void process_init(void);
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes one event, or up to PROCESS_BATCH_EVENTS
+ * events if the event queue is busy. The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -52,9 +52,19 @@
 #ifndef SUBPROCESS_H_
 #define SUBPROCESS_H_
 
+/* A subprocess starts at the default priority, like a PROCESS(). */
+#if PROCESS_CONF_NO_PROCESS_NAMES
+#define SUBPROCESS_INITIALIZER(strname)					\
+  {NULL, NULL PROCESS_PRIO_INITIALIZER}
+#else
+#define SUBPROCESS_INITIALIZER(strname)					\
+  {NULL, strname, NULL PROCESS_PRIO_INITIALIZER}
+#endif
+
 #define SUBPROCESS_BEGIN(strname)					\
 {									\
-  static struct process subprocess_subprocess = {NULL, strname};	\
+  static struct process subprocess_subprocess =				\
+    SUBPROCESS_INITIALIZER(strname);					\
   subprocess_subprocess.thread = PROCESS_CURRENT()->thread;		\
   process_start(&subprocess_subprocess, NULL);				\
   PT_INIT(&subprocess_subprocess.pt);					\
@@ -524,9 +524,19 @@ encrypt(uint8_t *plaintext_and_result)
   RELEASE_LOCK();
 }
 /*---------------------------------------------------------------------------*/
+static void
+forget_key(uint8_t *key)
+{
+  uint8_t zeroes[16];
+  
+  memset(zeroes, 0, sizeof(zeroes));
+  set_key(zeroes);
+}
+/*---------------------------------------------------------------------------*/
 const struct aes_128_driver cc2420_aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  forget_key
 };
 /*---------------------------------------------------------------------------*/
 static void
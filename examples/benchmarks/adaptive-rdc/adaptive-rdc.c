@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the adaptive channel check rate of ContikiMAC.
+ *
+ *         A node sends REQUESTS echo requests to the RPL root, one per
+ *         SEND_INTERVAL, and reports the round-trip time of each. Both
+ *         nodes report their idle radio duty cycle, in permille, before
+ *         the requests and once the check rate has decayed after them.
+ *         regression-tests/11-ipv6/19-exp5438-contikimac-adaptive-check-rate.csc
+ *         runs it in Cooja with two motes, the root being node 1. Build
+ *         it with "make DEFINES=CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE=0" to
+ *         compare with the fixed check rate.
+ */
+
+#include "contiki.h"
+#include "contiki-lib.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+#include "sys/energest.h"
+
+#include <stdio.h>
+
+#define UDP_PORT 61620
+
+/* The last byte of the link-layer address of the root, which Cooja
+   sets to the node id */
+#define ROOT_ID 1
+#define IS_ROOT() (linkaddr_node_addr.u8[LINKADDR_SIZE - 1] == ROOT_ID)
+
+#define REQUESTS 20
+#define SEND_INTERVAL CLOCK_SECOND
+
+/* Long enough for the check rate to decay back to the base rate */
+#define SETTLE_TIME (30 * CLOCK_SECOND)
+#define MEASURE_TIME (10 * CLOCK_SECOND)
+
+static struct simple_udp_connection echo_connection;
+static clock_time_t sent_time;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(adaptive_rdc_process, "Adaptive check rate benchmark");
+AUTOSTART_PROCESSES(&adaptive_rdc_process);
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr,
+         uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr,
+         uint16_t receiver_port,
+         const uint8_t *data,
+         uint16_t datalen)
+{
+  if(IS_ROOT()) {
+    simple_udp_sendto(c, data, datalen, sender_addr);
+  } else {
+    printf("Reply %u RTT %lu ms\n", data[0],
+           (unsigned long)(clock_time() - sent_time) * 1000 / CLOCK_SECOND);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+radio_time(void)
+{
+  return energest_type_time(ENERGEST_TYPE_LISTEN) +
+    energest_type_time(ENERGEST_TYPE_TRANSMIT);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+total_time(void)
+{
+  return energest_type_time(ENERGEST_TYPE_CPU) +
+    energest_type_time(ENERGEST_TYPE_LPM);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(adaptive_rdc_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long radio, total;
+  static uint8_t round, seqno;
+  uip_ipaddr_t addr;
+
+  PROCESS_BEGIN();
+
+  uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  if(IS_ROOT()) {
+    uip_ds6_addr_add(&addr, 0, ADDR_MANUAL);
+    rpl_set_root(RPL_DEFAULT_INSTANCE, &addr);
+    uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+    rpl_set_prefix(rpl_get_any_dag(), &addr, 64);
+  }
+
+  simple_udp_register(&echo_connection, UDP_PORT,
+                      NULL, UDP_PORT,
+                      receiver);
+
+  /* Measure the idle radio duty cycle, in permille, before and after
+     the requests. The root only echoes them. */
+  for(round = 0; round < 2; round++) {
+    etimer_set(&et, 2 * SETTLE_TIME);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+    energest_flush();
+    radio = radio_time();
+    total = total_time();
+    etimer_set(&et, MEASURE_TIME);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    energest_flush();
+    printf("Idle duty cycle %s %lu\n", round == 0 ? "before" : "after",
+           (radio_time() - radio) * 1000 / (total_time() - total));
+
+    if(round == 0) {
+      for(seqno = 0; seqno < REQUESTS; seqno++) {
+        etimer_set(&et, SEND_INTERVAL);
+        PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+        if(!IS_ROOT()) {
+          uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+          sent_time = clock_time();
+          simple_udp_sendto(&echo_connection, &seqno, sizeof(seqno), &addr);
+        }
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for software AES-128.
+ *
+ *         The benchmark checks the byte-oriented and the table-driven
+ *         driver against the FIPS-197 test vector, and then measures
+ *         how many bytes per second each of them encrypts, and how long
+ *         setting the same key again takes.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define KEY_ITERATIONS 1000000UL
+
+extern const struct aes_128_driver aes_128_driver;
+
+/* FIPS-197, Appendix C.1 */
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t plaintext[AES_128_BLOCK_SIZE] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t ciphertext[AES_128_BLOCK_SIZE] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+PROCESS(bench_process, "AES-128 benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, const struct aes_128_driver *driver)
+{
+  uint8_t k[AES_128_KEY_LENGTH];
+  uint8_t other[AES_128_KEY_LENGTH];
+  uint8_t block[AES_128_BLOCK_SIZE];
+  unsigned long i, elapsed_encrypt, elapsed_key;
+  clock_time_t start;
+  int correct;
+
+  memcpy(k, key, AES_128_KEY_LENGTH);
+  driver->set_key(k);
+  memcpy(block, plaintext, AES_128_BLOCK_SIZE);
+  driver->encrypt(block);
+  correct = !memcmp(block, ciphertext, AES_128_BLOCK_SIZE);
+
+  /* A forgotten key has to be set up anew */
+  memset(other, 0xa5, AES_128_KEY_LENGTH);
+  driver->set_key(other);
+  driver->set_key(k);
+  driver->forget_key(k);
+  driver->set_key(k);
+  memcpy(block, plaintext, AES_128_BLOCK_SIZE);
+  driver->encrypt(block);
+  correct &= !memcmp(block, ciphertext, AES_128_BLOCK_SIZE);
+
+  start = clock_time();
+  for(i = 0; i < BENCH_BLOCKS; i++) {
+    driver->encrypt(block);
+  }
+  elapsed_encrypt = clock_time() - start;
+
+  start = clock_time();
+  for(i = 0; i < KEY_ITERATIONS; i++) {
+    driver->set_key(k);
+  }
+  elapsed_key = clock_time() - start;
+
+  if(elapsed_encrypt == 0) {
+    elapsed_encrypt = 1;
+  }
+  printf("%s: %s, %lu bytes/s, set_key %lu ns\n",
+         name, correct ? "correct" : "WRONG",
+         (unsigned long)((unsigned long long)BENCH_BLOCKS * AES_128_BLOCK_SIZE
+                         * CLOCK_SECOND / elapsed_encrypt),
+         elapsed_key * (1000000000UL / CLOCK_SECOND) / KEY_ITERATIONS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run("Byte-oriented AES", &aes_128_driver);
+  run("Table-driven AES", &aes_128_ttable_driver);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
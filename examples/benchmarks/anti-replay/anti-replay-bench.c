@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the anti-replay check.
+ *
+ *         The benchmark passes the frame counters of a stream of unicast
+ *         frames to the anti-replay check. Some frames are overtaken by
+ *         up to BENCH_MAX_DELAY later frames, as happens when a frame is
+ *         retransmitted while the next ones are sent from other queues,
+ *         and some frames arrive twice. Fresh frames taken for replays
+ *         have to be retransmitted end-to-end; duplicates must never be
+ *         accepted.
+ *
+ *         Afterwards, the benchmark replays frames that are older than
+ *         the first frame accepted from a newly added neighbor, none of
+ *         which must be accepted.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/llsec/anti-replay.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES         10000
+/* One frame in DELAY_EVERY is overtaken, one in DUPLICATE_EVERY arrives twice */
+#define DELAY_EVERY    8
+#define DUPLICATE_EVERY 16
+#define MAX_ARRIVALS   (FRAMES + FRAMES / DUPLICATE_EVERY * 2)
+/* Counter of the first frame from a newly added neighbor */
+#define FIRST_COUNTER  1000
+
+struct arrival {
+  uint32_t time;
+  uint32_t counter;
+  uint8_t is_duplicate;
+};
+
+static struct arrival arrivals[MAX_ARRIVALS];
+
+PROCESS(bench_process, "Anti-replay benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+compare_arrivals(const void *a, const void *b)
+{
+  const struct arrival *x = a;
+  const struct arrival *y = b;
+
+  if(x->time != y->time) {
+    return x->time < y->time ? -1 : 1;
+  }
+  return x->counter < y->counter ? -1 : x->counter > y->counter;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_counter(uint32_t counter)
+{
+  frame802154_frame_counter_t c;
+
+  c.u32 = LLSEC802154_HTONL(counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, c.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, c.u16[1]);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct anti_replay_info info;
+  linkaddr_t receiver;
+  uint32_t i, time;
+  int n, delayed, duplicates, rejected, accepted_duplicates, accepted_old;
+
+  PROCESS_BEGIN();
+
+  random_init(1);
+  n = 0;
+  delayed = duplicates = 0;
+  for(i = 1; i <= FRAMES; i++) {
+    /* leave room for frames that are overtaken */
+    time = i * BENCH_MAX_DELAY;
+    if(random_rand() % DELAY_EVERY == 0) {
+      time += (1 + random_rand() % BENCH_MAX_DELAY) * BENCH_MAX_DELAY;
+      delayed++;
+    }
+    arrivals[n].time = time;
+    arrivals[n].counter = i;
+    arrivals[n].is_duplicate = 0;
+    n++;
+    if(random_rand() % DUPLICATE_EVERY == 0 && n < MAX_ARRIVALS) {
+      arrivals[n] = arrivals[n - 1];
+      arrivals[n].time += (1 + random_rand() % (2 * BENCH_MAX_DELAY)) * BENCH_MAX_DELAY;
+      arrivals[n].is_duplicate = 1;
+      n++;
+      duplicates++;
+    }
+  }
+  qsort(arrivals, n, sizeof(struct arrival), compare_arrivals);
+
+  packetbuf_clear();
+  memset(&receiver, 0, sizeof(receiver));
+  receiver.u8[0] = 1;
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+
+  set_counter(arrivals[0].counter);
+  anti_replay_init_info(&info);
+  rejected = accepted_duplicates = 0;
+  for(i = 1; i < n; i++) {
+    set_counter(arrivals[i].counter);
+    if(anti_replay_was_replayed(&info)) {
+      if(!arrivals[i].is_duplicate) {
+        rejected++;
+      }
+    } else if(arrivals[i].is_duplicate) {
+      accepted_duplicates++;
+    }
+  }
+
+  printf("Anti-replay window %u: %d frames, %d overtaken, %d duplicates\n",
+         ANTI_REPLAY_WINDOW, FRAMES, delayed, duplicates);
+  printf("Fresh frames rejected: %d, duplicates accepted: %d\n",
+         rejected, accepted_duplicates);
+
+  set_counter(FIRST_COUNTER);
+  anti_replay_init_info(&info);
+  accepted_old = 0;
+  for(i = 0; i <= FIRST_COUNTER; i++) {
+    set_counter(i);
+    if(!anti_replay_was_replayed(&info)) {
+      accepted_old++;
+    }
+  }
+  printf("Frames older than the first one accepted: %d of %d\n",
+         accepted_old, FIRST_COUNTER + 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
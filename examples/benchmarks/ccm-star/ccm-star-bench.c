@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for CCM*.
+ *
+ *         The benchmark secures and unsecures a frame once with
+ *         separate MIC and CTR passes and once with the single-pass
+ *         aead(), checks that both give the same result, and measures
+ *         the time and the number of block cipher invocations per frame.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/ccm-star.h"
+#include "lib/aes-128.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define HDR_LEN    23
+#define ITERATIONS 100000UL
+
+extern const struct aes_128_driver aes_128_driver;
+
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+static const uint8_t extended_source_address[8] = {
+  0xac, 0xde, 0x48, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+static uint8_t frame[HDR_LEN + BENCH_PAYLOAD];
+static unsigned long aes_calls;
+
+PROCESS(bench_process, "CCM* benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+count_set_key(uint8_t *k)
+{
+  aes_128_driver.set_key(k);
+}
+/*---------------------------------------------------------------------------*/
+static void
+count_encrypt(uint8_t *block)
+{
+  aes_calls++;
+  aes_128_driver.encrypt(block);
+}
+/*---------------------------------------------------------------------------*/
+static void
+count_forget_key(uint8_t *k)
+{
+  aes_128_driver.forget_key(k);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver bench_aes_128_driver = {
+  count_set_key,
+  count_encrypt,
+  count_forget_key
+};
+/*---------------------------------------------------------------------------*/
+static void
+load_frame(const uint8_t *payload)
+{
+  memcpy(packetbuf_dataptr(), payload, BENCH_PAYLOAD);
+}
+/*---------------------------------------------------------------------------*/
+static void
+secure(int fused, uint8_t *mic)
+{
+  if(fused) {
+    CCM_STAR.aead(extended_source_address, mic, LLSEC802154_MIC_LENGTH, 1);
+  } else {
+    CCM_STAR.mic(extended_source_address, mic, LLSEC802154_MIC_LENGTH);
+    CCM_STAR.ctr(extended_source_address);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+unsecure(int fused, uint8_t *mic)
+{
+  if(fused) {
+    CCM_STAR.aead(extended_source_address, mic, LLSEC802154_MIC_LENGTH, 0);
+  } else {
+    CCM_STAR.ctr(extended_source_address);
+    CCM_STAR.mic(extended_source_address, mic, LLSEC802154_MIC_LENGTH);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, int fused,
+    uint8_t *ciphertext, uint8_t *mic)
+{
+  uint8_t rx_mic[LLSEC802154_MIC_LENGTH];
+  unsigned long i, elapsed_secure, elapsed_unsecure, calls;
+  clock_time_t start;
+  int intact;
+
+  aes_calls = 0;
+  start = clock_time();
+  for(i = 0; i < ITERATIONS; i++) {
+    load_frame(frame + HDR_LEN);
+    secure(fused, mic);
+  }
+  elapsed_secure = clock_time() - start;
+  calls = aes_calls / ITERATIONS;
+  memcpy(ciphertext, packetbuf_dataptr(), BENCH_PAYLOAD);
+
+  start = clock_time();
+  for(i = 0; i < ITERATIONS; i++) {
+    load_frame(ciphertext);
+    unsecure(fused, rx_mic);
+  }
+  elapsed_unsecure = clock_time() - start;
+  intact = !memcmp(packetbuf_dataptr(), frame + HDR_LEN, BENCH_PAYLOAD)
+      && !memcmp(rx_mic, mic, LLSEC802154_MIC_LENGTH);
+
+  printf("%s: secure %lu ns, unsecure %lu ns, %lu AES calls per frame, %s\n",
+         name,
+         elapsed_secure * (1000000000UL / CLOCK_SECOND) / ITERATIONS,
+         elapsed_unsecure * (1000000000UL / CLOCK_SECOND) / ITERATIONS,
+         calls, intact ? "intact" : "corrupt");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t ciphertext[2][BENCH_PAYLOAD];
+  static uint8_t mic[2][LLSEC802154_MIC_LENGTH];
+  uint8_t k[AES_128_KEY_LENGTH];
+  uint16_t i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(frame); i++) {
+    frame[i] = (uint8_t)i;
+  }
+  packetbuf_clear();
+  packetbuf_set_datalen(sizeof(frame));
+  memcpy(packetbuf_hdrptr(), frame, sizeof(frame));
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, 5);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, 0);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, LLSEC802154_SECURITY_LEVEL);
+  packetbuf_hdrreduce(HDR_LEN);
+
+  memcpy(k, key, AES_128_KEY_LENGTH);
+  AES_128.set_key(k);
+
+  printf("CCM*: %u byte header, %u byte payload\n", HDR_LEN, BENCH_PAYLOAD);
+  run("Separate MIC and CTR", 0, ciphertext[0], mic[0]);
+  run("Single pass", 1, ciphertext[1], mic[1]);
+  printf("Results %s\n",
+         !memcmp(ciphertext[0], ciphertext[1], BENCH_PAYLOAD)
+         && !memcmp(mic[0], mic[1], LLSEC802154_MIC_LENGTH)
+         ? "match" : "differ");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the Internet checksum.
+ *
+ *         The benchmark checks uip_chksum_add() against the checksum
+ *         that is summed two bytes at a time for all lengths up to
+ *         MAX_LEN at all alignments, and uip_chksum_replace() against
+ *         recomputing the checksum after rewriting addresses and a port
+ *         as ip64 does. It then reports the time to checksum packets
+ *         of 40 to 1280 bytes, and the time of a rewrite of 64- and
+ *         1024-byte datagrams with a full and with an incremental
+ *         checksum update.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip-chksum.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_LEN     1280
+/* The number of bytes to checksum for each packet size */
+#define BYTES       1000000000UL
+#define REWRITES    10000000UL
+
+static uint8_t buf[MAX_LEN + 16];
+static const uint16_t sizes[] = { 40, 64, 128, 256, 512, 1024, 1280 };
+static volatile uint16_t sink;
+
+PROCESS(bench_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint16_t
+reference(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  int i;
+
+  for(i = 0; i + 1 < len; i += 2) {
+    t = (data[i] << 8) + data[i + 1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  if(i < len) {
+    t = data[i] << 8;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+check_sums(void)
+{
+  unsigned long errors;
+  uint16_t sum;
+  int len, offset;
+
+  errors = 0;
+  for(offset = 0; offset < 8; offset++) {
+    for(len = 0; len <= MAX_LEN; len++) {
+      sum = random_rand();
+      if(uip_chksum_add(sum, &buf[offset], len) !=
+         reference(sum, &buf[offset], len)) {
+        errors++;
+      }
+    }
+  }
+  /* All ones is where the carries matter most. */
+  memset(buf, 0xff, sizeof(buf));
+  for(len = 0; len <= MAX_LEN; len++) {
+    if(uip_chksum_add(0xffff, &buf[len & 7], len) !=
+       reference(0xffff, &buf[len & 7], len)) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+/* A UDP datagram over IPv6: the addresses of the pseudo header, then
+   the UDP header and payload. */
+struct packet {
+  uint8_t addr[32];
+  uint8_t udp[MAX_LEN];
+  uint16_t len;
+};
+/*---------------------------------------------------------------------------*/
+static uint16_t
+full_chksum(struct packet *p)
+{
+  uint16_t sum;
+
+  sum = p->len + 17;
+  sum = uip_chksum_add(sum, p->addr, sizeof(p->addr));
+  sum = uip_chksum_add(sum, p->udp, p->len);
+  return uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_chksum(struct packet *p, uint16_t chksum)
+{
+  memcpy(&p->udp[6], &chksum, sizeof(chksum));
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_chksum(struct packet *p)
+{
+  uint16_t chksum;
+
+  memcpy(&chksum, &p->udp[6], sizeof(chksum));
+  return chksum;
+}
+/*---------------------------------------------------------------------------*/
+/* Rewrite the addresses and the source port, and update the checksum. */
+static void
+rewrite(struct packet *p, const uint8_t *addr, uint16_t port, int incremental)
+{
+  uint16_t old_sum, new_sum;
+
+  if(incremental) {
+    old_sum = uip_chksum_add(0, p->addr, sizeof(p->addr));
+    old_sum = uip_chksum_add(old_sum, p->udp, 2);
+    new_sum = uip_chksum_add(0, addr, sizeof(p->addr));
+    new_sum = uip_chksum_add(new_sum, &port, 2);
+  }
+  memcpy(p->addr, addr, sizeof(p->addr));
+  memcpy(p->udp, &port, 2);
+  if(incremental) {
+    set_chksum(p, uip_chksum_replace(get_chksum(p), old_sum, new_sum));
+  } else {
+    set_chksum(p, 0);
+    set_chksum(p, ~full_chksum(p));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_fill(uint8_t *data, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    data[i] = random_rand();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+check_rewrites(void)
+{
+  static struct packet p;
+  uint8_t addr[32];
+  unsigned long errors;
+  int i;
+
+  errors = 0;
+  for(i = 0; i < 100000; i++) {
+    p.len = 8 + random_rand() % (MAX_LEN - 8);
+    random_fill((uint8_t *)&p, sizeof(p.addr) + p.len);
+    if(i & 1) {
+      /* Payloads of zeroes give checksums of 0xffff */
+      memset(p.udp + 8, 0, p.len - 8);
+    }
+    set_chksum(&p, 0);
+    set_chksum(&p, ~full_chksum(&p));
+    random_fill(addr, sizeof(addr));
+    rewrite(&p, addr, random_rand(), 1);
+    /* A correct checksum sums to 0xffff */
+    if(full_chksum(&p) != 0xffff) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns(clock_time_t t, unsigned long n)
+{
+  return (unsigned long)(t * (1000000000.0 / CLOCK_SECOND) / n);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct packet p;
+  static const uint16_t udp_sizes[] = { 64, 1024 };
+  clock_time_t start;
+  unsigned long i, rounds;
+  uint8_t addr[2][32];
+  int s, offset, incremental;
+
+  PROCESS_BEGIN();
+
+  random_init(1);
+  random_fill(buf, sizeof(buf));
+
+  printf("Checksum: %s%s\n",
+         UIP_CHKSUM_WORD ? "word at a time" : "two bytes at a time",
+         UIP_CHKSUM_WORD && UIP_CHKSUM_SIMD ? ", SIMD" : "");
+  printf("Errors: %lu in sums, %lu in incremental updates\n",
+         check_sums(), check_rewrites());
+
+  random_fill(buf, sizeof(buf));
+  for(offset = 0; offset < 2; offset++) {
+    for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      rounds = BYTES / sizes[s];
+      start = clock_time();
+      for(i = 0; i < rounds; i++) {
+        sink = uip_chksum_add(i, &buf[offset], sizes[s]);
+      }
+      start = clock_time() - start;
+      printf("%4u bytes%s: %6lu ns, %5lu MB/s\n", sizes[s],
+             offset ? " (odd address)" : "               ",
+             ns(start, rounds),
+             (unsigned long)(rounds * sizes[s] /
+                             (start * (1000000.0 / CLOCK_SECOND) + 1)));
+    }
+  }
+
+  random_fill(addr[0], sizeof(addr));
+  for(s = 0; s < sizeof(udp_sizes) / sizeof(udp_sizes[0]); s++) {
+    for(incremental = 0; incremental < 2; incremental++) {
+      p.len = udp_sizes[s];
+      random_fill((uint8_t *)&p, sizeof(p.addr) + p.len);
+      rewrite(&p, addr[0], 0, 0);
+      start = clock_time();
+      for(i = 0; i < REWRITES; i++) {
+        rewrite(&p, addr[i & 1], i, incremental);
+      }
+      start = clock_time() - start;
+      printf("Rewrite of a %4u-byte UDP datagram, %s update: %lu ns%s\n",
+             p.len, incremental ? "incremental" : "full       ",
+             ns(start, REWRITES),
+             full_chksum(&p) == 0xffff ? "" : ", wrong checksum");
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for finding the connection of incoming packets.
+ *
+ *         The benchmark opens BENCH_UDP_CONNS UDP connections and
+ *         BENCH_TCP_CONNS TCP connections, as on a gateway that talks to
+ *         many nodes, and then feeds packets for all of them to uIP in
+ *         turn. The TCP segments carry an old sequence number, so that
+ *         uIP only answers with an ACK and the connections stay open. It
+ *         reports the time per packet, and checks that every packet
+ *         reached the connection it was addressed to.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PACKETS        1000000UL
+#define PAYLOAD_LEN    8
+#define PEER_PORT      5683
+#define UDP_PACKET_LEN (UIP_IPUDPH_LEN + PAYLOAD_LEN)
+#define TCP_PACKET_LEN (UIP_IPTCPH_LEN + PAYLOAD_LEN)
+
+#define TCP_ACK 0x10
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+static uip_ipaddr_t peer_addr, local_addr;
+
+static struct uip_udp_conn *udp_conns[BENCH_UDP_CONNS];
+static struct uip_conn *tcp_conns[BENCH_TCP_CONNS];
+static uint8_t udp_packets[BENCH_UDP_CONNS][UDP_PACKET_LEN];
+static uint8_t tcp_packets[BENCH_TCP_CONNS][TCP_PACKET_LEN];
+
+static struct uip_udp_conn *expected;
+static unsigned long delivered, errors;
+
+PROCESS(bench_process, "Connection demultiplexing benchmark");
+PROCESS(sink_process, "Connection demultiplexing sink");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == tcpip_event && uip_newdata() && uip_udp_conn != NULL &&
+       uip_conn == NULL) {
+      delivered++;
+      if(uip_udp_conn != expected) {
+        errors++;
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_ip(uint8_t proto, int len)
+{
+  memset(uip_buf, 0, UIP_LLH_LEN + len);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (len - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = proto;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &peer_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &local_addr);
+  uip_len = len;
+  uip_ext_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_udp(int i)
+{
+  make_ip(UIP_PROTO_UDP, UDP_PACKET_LEN);
+  UIP_UDP_BUF->srcport = UIP_HTONS(PEER_PORT);
+  UIP_UDP_BUF->destport = udp_conns[i]->lport;
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  UIP_UDP_BUF->udpchksum = 0;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  memcpy(udp_packets[i], &uip_buf[UIP_LLH_LEN], UDP_PACKET_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_tcp(int i)
+{
+  make_ip(UIP_PROTO_TCP, TCP_PACKET_LEN);
+  UIP_TCP_BUF->srcport = tcp_conns[i]->rport;
+  UIP_TCP_BUF->destport = tcp_conns[i]->lport;
+  UIP_TCP_BUF->seqno[0] = 0x12;
+  UIP_TCP_BUF->tcpoffset = (UIP_TCPH_LEN / 4) << 4;
+  UIP_TCP_BUF->flags = TCP_ACK;
+  UIP_TCP_BUF->wnd[0] = 0x10;
+  UIP_TCP_BUF->tcpchksum = 0;
+  UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+  memcpy(tcp_packets[i], &uip_buf[UIP_LLH_LEN], TCP_PACKET_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_packet(clock_time_t t)
+{
+  return (unsigned long)(t * (1000000000.0 / CLOCK_SECOND) / PACKETS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  uip_lladdr_t lladdr;
+  uip_ds6_addr_t *lladdr_local;
+  unsigned long i, tcp_errors;
+  clock_time_t start;
+  int n;
+
+  PROCESS_BEGIN();
+
+  tcpip_set_outputfunc(output);
+  process_start(&sink_process, NULL);
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[0] = 0x02;
+  lladdr.addr[sizeof(lladdr) - 1] = 0x02;
+  uip_ip6addr(&peer_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&peer_addr, &lladdr);
+  lladdr_local = uip_ds6_get_link_local(-1);
+  if(lladdr_local == NULL) {
+    printf("Error: no link-local address\n");
+    PROCESS_EXIT();
+  }
+  uip_ipaddr_copy(&local_addr, &lladdr_local->ipaddr);
+
+  PROCESS_CONTEXT_BEGIN(&sink_process);
+  for(n = 0; n < BENCH_UDP_CONNS; n++) {
+    udp_conns[n] = udp_new(NULL, 0, NULL);
+  }
+  for(n = 0; n < BENCH_TCP_CONNS; n++) {
+    tcp_conns[n] = tcp_connect(&peer_addr, UIP_HTONS(PEER_PORT + n), NULL);
+  }
+  PROCESS_CONTEXT_END(&sink_process);
+
+  for(n = 0; n < BENCH_UDP_CONNS; n++) {
+    if(udp_conns[n] == NULL) {
+      printf("Error: could not open UDP connection %d\n", n);
+      PROCESS_EXIT();
+    }
+    make_udp(n);
+  }
+  for(n = 0; n < BENCH_TCP_CONNS; n++) {
+    if(tcp_conns[n] == NULL) {
+      printf("Error: could not open TCP connection %d\n", n);
+      PROCESS_EXIT();
+    }
+    make_tcp(n);
+  }
+
+  printf("Connection lookup: %s, %d UDP and %d TCP connections\n",
+         UIP_CONN_HASH_SIZE ? "hash" : "scan",
+         BENCH_UDP_CONNS, BENCH_TCP_CONNS);
+
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    n = i % BENCH_UDP_CONNS;
+    memcpy(&uip_buf[UIP_LLH_LEN], udp_packets[n], UDP_PACKET_LEN);
+    uip_len = UDP_PACKET_LEN;
+    uip_ext_len = 0;
+    expected = udp_conns[n];
+    uip_input();
+  }
+  start = clock_time() - start;
+  printf("UDP: %lu ns per packet, %lu delivered, %lu errors\n",
+         ns_per_packet(start), delivered, errors);
+
+  tcp_errors = 0;
+  start = clock_time();
+  for(i = 0; i < PACKETS; i++) {
+    n = i % BENCH_TCP_CONNS;
+    memcpy(&uip_buf[UIP_LLH_LEN], tcp_packets[n], TCP_PACKET_LEN);
+    uip_len = TCP_PACKET_LEN;
+    uip_ext_len = 0;
+    uip_input();
+    /* uIP answers with an ACK from the connection */
+    if(uip_conn != tcp_conns[n] || uip_len == 0) {
+      tcp_errors++;
+    }
+  }
+  start = clock_time() - start;
+  uip_len = 0;
+  printf("TCP: %lu ns per packet, %lu errors\n",
+         ns_per_packet(start), tcp_errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
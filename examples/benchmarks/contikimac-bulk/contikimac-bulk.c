@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for bulk transfers over ContikiMAC.
+ *
+ *         The client transfers 1 KB to the server in blocks of
+ *         BLOCK_SIZE bytes, sent as several 6LoWPAN fragments each.
+ *         Like a CoAP blockwise transfer, every block waits for the
+ *         reply of the server to the previous one. The benchmark
+ *         reports the goodput of the transfers, which start after a
+ *         pause long enough for the radios to go back to sleep.
+ */
+
+#include "contiki.h"
+#include "contiki-lib.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT          61621
+/* The last byte of the link-layer address of the server, which Cooja
+   sets to the node id */
+#define SERVER_ID         2
+#define IS_SERVER()       (linkaddr_node_addr.u8[LINKADDR_SIZE - 1] == SERVER_ID)
+
+#define TRANSFERS         10
+#define TRANSFER_SIZE     1024
+#define BLOCK_SIZE        256
+
+#define START_TIME        (60 * CLOCK_SECOND)
+#define PAUSE_TIME        (5 * CLOCK_SECOND)
+#define RETRANSMIT_TIME   (4 * CLOCK_SECOND)
+
+static struct simple_udp_connection connection;
+static uint16_t offset;
+static uint8_t acked;
+
+PROCESS(bulk_process, "ContikiMAC bulk transfer benchmark");
+AUTOSTART_PROCESSES(&bulk_process);
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr,
+         uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr,
+         uint16_t receiver_port,
+         const uint8_t *data,
+         uint16_t datalen)
+{
+  uint16_t block;
+
+  if(datalen < sizeof(block)) {
+    return;
+  }
+  memcpy(&block, data, sizeof(block));
+  if(IS_SERVER()) {
+    /* Acknowledge the block */
+    simple_udp_sendto(c, &block, sizeof(block), sender_addr);
+  } else if(block == offset) {
+    acked = 1;
+    process_poll(&bulk_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_block(void)
+{
+  static uint8_t buf[BLOCK_SIZE];
+  uip_ipaddr_t addr;
+
+  memcpy(buf, &offset, sizeof(offset));
+  uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  simple_udp_sendto(&connection, buf, sizeof(buf), &addr);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bulk_process, ev, data)
+{
+  static struct etimer et;
+  static uint8_t transfer;
+  static clock_time_t start;
+  static unsigned long total_time;
+  clock_time_t elapsed;
+  uip_ipaddr_t addr;
+
+  PROCESS_BEGIN();
+
+  simple_udp_register(&connection, UDP_PORT, NULL, UDP_PORT, receiver);
+
+  if(IS_SERVER()) {
+    uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+    uip_ds6_addr_add(&addr, 0, ADDR_MANUAL);
+    rpl_set_root(RPL_DEFAULT_INSTANCE, &addr);
+    uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+    rpl_set_prefix(rpl_get_any_dag(), &addr, 64);
+    PROCESS_EXIT();
+  }
+
+  /* Let the client join the DODAG of the server */
+  etimer_set(&et, START_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  total_time = 0;
+  for(transfer = 1; transfer <= TRANSFERS; transfer++) {
+    etimer_set(&et, PAUSE_TIME);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+    start = clock_time();
+    for(offset = 0; offset < TRANSFER_SIZE; offset += BLOCK_SIZE) {
+      acked = 0;
+      while(!acked) {
+        send_block();
+        etimer_set(&et, RETRANSMIT_TIME);
+        PROCESS_WAIT_EVENT_UNTIL(acked || etimer_expired(&et));
+      }
+    }
+    elapsed = clock_time() - start;
+    total_time += elapsed;
+    printf("Transfer %u: %u bytes in %lu ms\n", transfer, TRANSFER_SIZE,
+           (unsigned long)elapsed * 1000 / CLOCK_SECOND);
+  }
+
+  printf("Bulk %s: goodput %lu bytes/s\n",
+         BENCH_BULK ? "on" : "off",
+         (unsigned long)TRANSFERS * TRANSFER_SIZE * CLOCK_SECOND / total_time);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the CSMA neighbor queue scheduling.
+ *
+ *         In every round, one neighbor queues a long series of large
+ *         packets. When the first of them has been sent, a few light
+ *         neighbors queue one small packet each. The frames CSMA
+ *         sends are captured. The benchmark reports how many frames
+ *         go out before the packet of a light neighbor, and how many
+ *         frames announce with the frame pending bit that another
+ *         frame follows.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/mac/mac.h"
+#include "dev/radio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS     50
+#define BULK_LEN   100
+#define LIGHT_LEN  30
+#define PACKETS    (BENCH_BULK_PACKETS + BENCH_LIGHT)
+
+/* The frame pending bit of the 802.15.4 frame control field */
+#define FCF_FRAME_PENDING 0x10
+
+static unsigned long frames_sent, frames_pending, frames_done;
+static unsigned long light_wait, light_wait_max, light_sent;
+/* The number of frames sent when the light packets were queued */
+static unsigned long light_queued;
+static uint8_t round_buf[PACKETBUF_SIZE];
+
+PROCESS(bench_process, "CSMA scheduling benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+capture_init(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_send(const void *payload, unsigned short payload_len)
+{
+  frames_sent++;
+  if(payload_len > 0 && (((const uint8_t *)payload)[0] & FCF_FRAME_PENDING)) {
+    frames_pending++;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  capture_init,
+  capture_prepare,
+  capture_transmit,
+  capture_send,
+  capture_read,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_get_value,
+  capture_set_value,
+  capture_get_object,
+  capture_set_object
+};
+/*---------------------------------------------------------------------------*/
+static void send_to(uint8_t neighbor, int len, void *ptr);
+
+static void
+sent(void *ptr, int status, int transmissions)
+{
+  unsigned long wait;
+  int i;
+
+  frames_done++;
+  if(ptr != NULL) {
+    /* A light packet: count the frames sent before it */
+    wait = frames_sent - light_queued - 1;
+    light_wait += wait;
+    if(wait > light_wait_max) {
+      light_wait_max = wait;
+    }
+    light_sent++;
+  } else if(frames_done == 1) {
+    /* The light neighbors queue their packets while the bulk
+       neighbor is being served */
+    light_queued = frames_sent;
+    for(i = 0; i < BENCH_LIGHT; i++) {
+      send_to(2 + i, LIGHT_LEN, &light_queued);
+    }
+  }
+  process_poll(&bench_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_to(uint8_t neighbor, int len, void *ptr)
+{
+  linkaddr_t addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[LINKADDR_SIZE - 1] = neighbor;
+  packetbuf_clear();
+  packetbuf_copyfrom(round_buf, len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+  NETSTACK_MAC.send(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int round;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("CSMA scheduling: quantum %u, burst %s, %u bulk packets, %u light neighbors\n",
+         BENCH_DRR_QUANTUM, BENCH_BURST ? "on" : "off",
+         BENCH_BULK_PACKETS, BENCH_LIGHT);
+
+  for(round = 0; round < ROUNDS; round++) {
+    frames_done = 0;
+    for(i = 0; i < BENCH_BULK_PACKETS; i++) {
+      send_to(1, BULK_LEN, NULL);
+    }
+    while(frames_done < PACKETS) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    }
+  }
+  printf("Frames: %lu sent, %lu with the frame pending bit\n",
+         frames_sent, frames_pending);
+  if(light_sent > 0) {
+    printf("Frames sent before a light packet: %lu.%02lu average, %lu max\n",
+           light_wait / light_sent, light_wait * 100 / light_sent % 100,
+           light_wait_max);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with "make DEFINES=BENCH_DRR_QUANTUM=0" to hand the whole
+ * queue of a neighbor to the RDC for comparison, and with
+ * "make DEFINES=BENCH_BURST=1" to set the frame pending bit on
+ * back-to-back frames.
+ */
+#ifndef BENCH_DRR_QUANTUM
+#define BENCH_DRR_QUANTUM 128
+#endif
+
+#ifndef BENCH_BURST
+#define BENCH_BURST 0
+#endif
+
+/* One neighbor with a long queue, and the light neighbors */
+#define BENCH_BULK_PACKETS 8
+#define BENCH_LIGHT 3
+
+#define CSMA_CONF_DRR_QUANTUM BENCH_DRR_QUANTUM
+#define CSMA_CONF_BURST BENCH_BURST
+#define CSMA_CONF_MAX_NEIGHBOR_QUEUES (1 + BENCH_LIGHT)
+
+#define QUEUEBUF_CONF_NUM (BENCH_BULK_PACKETS + BENCH_LIGHT)
+
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC csma_driver
+
+/* The frames CSMA sends are captured by the benchmark */
+#undef NETSTACK_CONF_RADIO
+#define NETSTACK_CONF_RADIO capture_radio_driver
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the CSMA neighbor queue lookup and statistics.
+ *
+ *         The benchmark queues a packet for each of a number of
+ *         neighbors and looks up the queue length of random neighbors
+ *         while all queues exist. It then lets CSMA send the packets,
+ *         with every fourth neighbor never acknowledging, and prints
+ *         the CSMA statistics.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/mac/csma.h"
+#include "dev/radio.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define LOOKUPS 1000000UL
+
+static unsigned long frames_sent, packets_done;
+
+PROCESS(bench_process, "CSMA lookup benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+capture_init(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_send(const void *payload, unsigned short payload_len)
+{
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+  frames_sent++;
+  /* Every fourth neighbor never acknowledges */
+  if(receiver->u8[LINKADDR_SIZE - 1] % 4 == 0) {
+    return RADIO_TX_NOACK;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  capture_init,
+  capture_prepare,
+  capture_transmit,
+  capture_send,
+  capture_read,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_get_value,
+  capture_set_value,
+  capture_get_object,
+  capture_set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_neighbor(linkaddr_t *addr, int id)
+{
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 1] = id + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+sent(void *ptr, int status, int transmissions)
+{
+  packets_done++;
+  process_poll(&bench_process);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+lookups_per_second(void)
+{
+  unsigned long i, errors;
+  clock_time_t start;
+  linkaddr_t addr;
+
+  errors = 0;
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; i++) {
+    make_neighbor(&addr, random_rand() % BENCH_NEIGHBORS);
+    if(csma_queue_length(&addr) != 1) {
+      errors++;
+    }
+  }
+  start = clock_time() - start;
+  if(errors > 0) {
+    printf("Error: %lu lookups returned the wrong queue\n", errors);
+  }
+  return start > 0 ? LOOKUPS * CLOCK_SECOND / start : 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t payload[50];
+  struct csma_stats *s;
+  const linkaddr_t *addr;
+  linkaddr_t neighbor;
+  unsigned long done;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("CSMA lookup: %s, %u neighbors\n",
+         BENCH_NEIGHBOR_HASH ? "hash table" : "linear search",
+         BENCH_NEIGHBORS);
+
+  /* The packets are sent once the process yields */
+  for(i = 0; i < BENCH_NEIGHBORS; i++) {
+    make_neighbor(&neighbor, i);
+    packetbuf_clear();
+    packetbuf_copyfrom(payload, sizeof(payload));
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &neighbor);
+    NETSTACK_MAC.send(sent, NULL);
+  }
+  printf("Queue lookups: %lu/s\n", lookups_per_second());
+
+  while(packets_done < BENCH_NEIGHBORS) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+  }
+
+  printf("Frames: %lu sent\n", frames_sent);
+  printf("Total: %u queued, %u sent, %u dropped, %u transmissions\n",
+         csma_stats.queued, csma_stats.sent, csma_stats.dropped,
+         csma_stats.transmissions);
+  done = 0;
+  for(s = csma_stats_neighbor_head(); s != NULL;
+      s = csma_stats_neighbor_next(s)) {
+    addr = csma_stats_neighbor_lladdr(s);
+    if(s->sent + s->dropped != 1 ||
+       (addr->u8[LINKADDR_SIZE - 1] % 4 == 0) != (s->dropped == 1)) {
+      printf("Error: wrong statistics for neighbor %u\n",
+             addr->u8[LINKADDR_SIZE - 1]);
+    }
+    done++;
+  }
+  printf("Neighbors with statistics: %lu\n", done);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for event timers.
+ *
+ *         With a number of long-running event timers active, the
+ *         benchmark measures how fast event timers can be set, and how
+ *         fast a burst of expired event timers is delivered.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+
+#ifndef BENCH_TIMERS
+#define BENCH_TIMERS     100
+#endif
+#define BURST_TIMERS     16
+#define SET_ITERATIONS   1000000UL
+#define EXPIRE_ROUNDS    20000UL
+
+static struct etimer timers[BENCH_TIMERS];
+static struct etimer burst[BURST_TIMERS];
+
+PROCESS(bench_process, "Etimer benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static unsigned long i, round;
+  static clock_time_t start;
+  static int expired;
+  int j;
+
+  PROCESS_BEGIN();
+
+  printf("Event timers: %s, %u active timers\n",
+         ETIMER_CONF_HEAP ? "heap" : "list", BENCH_TIMERS);
+
+  for(j = 0; j < BENCH_TIMERS; j++) {
+    etimer_set(&timers[j], 1000 * CLOCK_SECOND + random_rand() % CLOCK_SECOND);
+  }
+
+  /* Set: re-set randomly chosen active timers to new intervals. */
+  start = clock_time();
+  for(i = 0; i < SET_ITERATIONS; i++) {
+    etimer_set(&timers[random_rand() % BENCH_TIMERS],
+               1000 * CLOCK_SECOND + random_rand() % CLOCK_SECOND);
+  }
+  start = clock_time() - start;
+  printf("Set: %lu timers in %lu ms, %lu timers/s\n",
+         SET_ITERATIONS, (unsigned long)start,
+         start > 0 ? SET_ITERATIONS * CLOCK_SECOND / start : 0);
+
+  /* Expire: let bursts of timers expire at the same time. */
+  start = clock_time();
+  for(round = 0; round < EXPIRE_ROUNDS; round++) {
+    for(j = 0; j < BURST_TIMERS; j++) {
+      etimer_set(&burst[j], 0);
+    }
+    expired = 0;
+    while(expired < BURST_TIMERS) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      expired++;
+    }
+  }
+  start = clock_time() - start;
+  printf("Expire: %lu timers in %lu ms, %lu timers/s\n",
+         EXPIRE_ROUNDS * BURST_TIMERS, (unsigned long)start,
+         start > 0 ? EXPIRE_ROUNDS * BURST_TIMERS * CLOCK_SECOND / start : 0);
+
+  for(j = 0; j < BENCH_TIMERS; j++) {
+    etimer_stop(&timers[j]);
+  }
+  printf("Pending timers after stop: %d\n", etimer_pending());
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
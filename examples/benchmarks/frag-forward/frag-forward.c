@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for forwarding 6lowpan fragments on a router.
+ *
+ *         A number of neighbors send fragmented UDP datagrams at the
+ *         same time through the router, so that their fragments
+ *         arrive interleaved. The frames the router sends are
+ *         captured. The benchmark counts the fragments the router
+ *         receives before it sends the first fragment of a datagram,
+ *         then makes the router the destination of the datagrams and
+ *         feeds it the captured frames one datagram after the other to
+ *         check that the datagrams were forwarded intact.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "dev/radio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT      5678
+#define DATAGRAMS     50
+#define DATAGRAM_LEN  640
+/* The uncompressed datagram bytes in the first fragment and in the
+   following fragments. Both are multiples of eight. */
+#define FRAG1_LEN     88
+#define FRAGN_LEN     96
+#define FRAGMENTS     (1 + (DATAGRAM_LEN - FRAG1_LEN + FRAGN_LEN - 1) / FRAGN_LEN)
+/* Room for the router to send each datagram in twice as many frames */
+#define MAX_FRAMES    (2 * FRAGMENTS * DATAGRAMS * BENCH_SENDERS)
+#define MAX_FRAME_LEN 127
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF   ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static struct simple_udp_connection connection;
+static uint8_t datagram[BENCH_SENDERS][DATAGRAM_LEN];
+static linkaddr_t sender[BENCH_SENDERS];
+static uip_ipaddr_t destination;
+static unsigned long delivered, corrupt;
+
+/* The frames sent by the router and the datagram each belongs to */
+static uint8_t frames[MAX_FRAMES][MAX_FRAME_LEN];
+static uint8_t frame_len[MAX_FRAMES];
+static uint16_t frame_datagram[MAX_FRAMES];
+static unsigned long frames_sent, frames_received;
+
+/* The datagram whose fragment the router is processing */
+static uint16_t current;
+/* The number of fragments received when each datagram started to
+   arrive and when its first frame was sent, plus one */
+static unsigned long first_received[DATAGRAMS * BENCH_SENDERS];
+static unsigned long first_sent[DATAGRAMS * BENCH_SENDERS];
+
+PROCESS(bench_process, "Fragment forwarding benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+capture_init(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_prepare(const void *payload, unsigned short payload_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_send(const void *payload, unsigned short payload_len)
+{
+  if(frames_sent < MAX_FRAMES && payload_len <= MAX_FRAME_LEN) {
+    memcpy(frames[frames_sent], payload, payload_len);
+    frame_len[frames_sent] = payload_len;
+    frame_datagram[frames_sent] = current;
+    frames_sent++;
+  }
+  if(first_sent[current] == 0) {
+    first_sent[current] = frames_received;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+capture_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  capture_init,
+  capture_prepare,
+  capture_transmit,
+  capture_send,
+  capture_read,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_off,
+  capture_get_value,
+  capture_set_value,
+  capture_get_object,
+  capture_set_object
+};
+/*---------------------------------------------------------------------------*/
+static uint8_t
+payload_byte(int s, int seq, int i)
+{
+  return (uint8_t)(s * 31 + seq * 7 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  int i, s, seq;
+
+  s = sender_addr->u8[15] - 1;
+  seq = data[0] | (data[1] << 8);
+  for(i = 2; i < datalen; i++) {
+    if(data[i] != payload_byte(s, seq, i)) {
+      break;
+    }
+  }
+  if(datalen == DATAGRAM_LEN - UIP_IPUDPH_LEN && i == datalen) {
+    delivered++;
+  } else {
+    corrupt++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_datagram(int s, int seq)
+{
+  uint8_t *data;
+  int i;
+
+  /* Build the datagram in uip_buf to compute its UDP checksum. */
+  memset(uip_buf, 0, UIP_LLIPH_LEN + UIP_UDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (DATAGRAM_LEN - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (DATAGRAM_LEN - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, s + 1);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &destination);
+  UIP_UDP_BUF->srcport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(DATAGRAM_LEN - UIP_IPH_LEN);
+  data = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  data[0] = seq & 0xff;
+  data[1] = seq >> 8;
+  for(i = 2; i < DATAGRAM_LEN - UIP_IPUDPH_LEN; i++) {
+    data[i] = payload_byte(s, seq, i);
+  }
+  uip_len = DATAGRAM_LEN;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+  memcpy(datagram[s], &uip_buf[UIP_LLH_LEN], DATAGRAM_LEN);
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_fragment(int s, int seq, int fragment)
+{
+  uint8_t *frag;
+  uint16_t offset, len;
+
+  current = seq * BENCH_SENDERS + s;
+  frames_received++;
+  if(first_received[current] == 0) {
+    first_received[current] = frames_received;
+  }
+
+  packetbuf_clear();
+  frag = packetbuf_dataptr();
+  frag[1] = DATAGRAM_LEN & 0xff;
+  frag[2] = seq >> 8;
+  frag[3] = seq & 0xff;
+  if(fragment == 0) {
+    frag[0] = SICSLOWPAN_DISPATCH_FRAG1 | (DATAGRAM_LEN >> 8);
+    frag[SICSLOWPAN_FRAG1_HDR_LEN] = SICSLOWPAN_DISPATCH_IPV6;
+    memcpy(&frag[SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN],
+           datagram[s], FRAG1_LEN);
+    len = SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN + FRAG1_LEN;
+  } else {
+    offset = FRAG1_LEN + (fragment - 1) * FRAGN_LEN;
+    len = DATAGRAM_LEN - offset < FRAGN_LEN ? DATAGRAM_LEN - offset : FRAGN_LEN;
+    frag[0] = SICSLOWPAN_DISPATCH_FRAGN | (DATAGRAM_LEN >> 8);
+    frag[4] = offset >> 3;
+    memcpy(&frag[SICSLOWPAN_FRAGN_HDR_LEN], &datagram[s][offset], len);
+    len += SICSLOWPAN_FRAGN_HDR_LEN;
+  }
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender[s]);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+replay_datagram(uint16_t d)
+{
+  unsigned long i;
+
+  for(i = 0; i < frames_sent; i++) {
+    if(frame_datagram[i] == d) {
+      packetbuf_copyfrom(frames[i], frame_len[i]);
+      if(NETSTACK_FRAMER.parse() >= 0) {
+        NETSTACK_NETWORK.input();
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int seq;
+  static uip_ipaddr_t next_hop;
+  static uip_lladdr_t next_hop_lladdr;
+  unsigned long latency, forwarded;
+  clock_time_t start;
+  int s, i;
+
+  PROCESS_BEGIN();
+
+  printf("Fragment forwarding: %s, %u contexts, %u senders, %u fragments per datagram\n",
+         BENCH_FRAG_FORWARD ? "on" : "off", SICSLOWPAN_REASS_CONTEXTS,
+         BENCH_SENDERS, FRAGMENTS);
+
+  /* The datagrams are routed to a neighbor of the router */
+  memset(&next_hop_lladdr, 0, sizeof(next_hop_lladdr));
+  next_hop_lladdr.addr[sizeof(next_hop_lladdr) - 1] = 0x99;
+  uip_ip6addr(&next_hop, 0xfe80, 0, 0, 0, 0, 0, 0, 0x99);
+  uip_ds6_nbr_add(&next_hop, &next_hop_lladdr, 1, NBR_REACHABLE);
+  uip_ip6addr(&destination, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100);
+  uip_ds6_route_add(&destination, 128, &next_hop);
+
+  for(s = 0; s < BENCH_SENDERS; s++) {
+    memset(&sender[s], 0, sizeof(linkaddr_t));
+    sender[s].u8[LINKADDR_SIZE - 1] = s + 1;
+  }
+
+  start = clock_time();
+  for(seq = 0; seq < DATAGRAMS; seq++) {
+    for(s = 0; s < BENCH_SENDERS; s++) {
+      make_datagram(s, seq);
+    }
+    for(i = 0; i < FRAGMENTS; i++) {
+      for(s = 0; s < BENCH_SENDERS; s++) {
+        input_fragment(s, seq, i);
+      }
+    }
+  }
+  start = clock_time() - start;
+
+  latency = 0;
+  forwarded = 0;
+  for(i = 0; i < DATAGRAMS * BENCH_SENDERS; i++) {
+    if(first_sent[i] != 0) {
+      latency += first_sent[i] - first_received[i] + 1;
+      forwarded++;
+    }
+  }
+
+  printf("Frames: %lu received, %lu sent\n", frames_received, frames_sent);
+  printf("Fragments: %lu forwarded, %lu dropped; datagrams: %lu reassembled, %lu evicted\n",
+         (unsigned long)sicslowpan_stats.frag.forwarded,
+         (unsigned long)sicslowpan_stats.frag.drop,
+         (unsigned long)sicslowpan_stats.frag.reassembled,
+         (unsigned long)sicslowpan_stats.frag.evicted);
+  if(forwarded > 0) {
+    printf("Fragments received until the first one is sent: %lu.%02lu\n",
+           latency / forwarded, latency * 100 / forwarded % 100);
+  }
+  if(start > 0) {
+    printf("Fragments per second: %lu\n",
+           frames_received * CLOCK_SECOND / start);
+  }
+
+  /* Receive the forwarded datagrams to check them */
+  uip_ds6_addr_add(&destination, 0, ADDR_MANUAL);
+  simple_udp_register(&connection, UDP_PORT, NULL, UDP_PORT, receiver);
+  for(i = 0; i < DATAGRAMS * BENCH_SENDERS; i++) {
+    replay_datagram(i);
+  }
+
+  printf("Forwarded: %lu of %u datagrams, %lu intact, %lu corrupt\n",
+         forwarded, DATAGRAMS * BENCH_SENDERS, delivered, corrupt);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for IPv6 reassembly with concurrent senders.
+ *
+ *         A number of hosts send fragmented UDP datagrams at the same
+ *         time, as on the Ethernet side of a border router, so that
+ *         their fragments arrive interleaved. Every other sender sends
+ *         its fragments in reverse order and the first sender sends
+ *         every fragment twice. One fragment of the first datagram of
+ *         the second sender is lost. The benchmark counts the datagrams
+ *         that are delivered intact and measures how fast fragments are
+ *         processed.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ip/simple-udp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT      5678
+#define DATAGRAMS     2000
+#define DATAGRAM_LEN  1040
+/* The bytes of the fragmentable part in each fragment, a multiple of
+   eight */
+#define FRAG_LEN      256
+#define FRAGMENTS     ((DATAGRAM_LEN - UIP_IPH_LEN + FRAG_LEN - 1) / FRAG_LEN)
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF   ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define UIP_FRAG_BUF  ((struct uip_frag_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static struct simple_udp_connection connection;
+static uint8_t datagram[BENCH_SENDERS][DATAGRAM_LEN];
+static unsigned long delivered, corrupt;
+
+PROCESS(bench_process, "IPv6 reassembly benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+payload_byte(int s, int seq, int i)
+{
+  return (uint8_t)(s * 31 + seq * 7 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  int i, s, seq;
+
+  s = sender_addr->u8[15] - 1;
+  seq = data[0] | (data[1] << 8);
+  for(i = 2; i < datalen; i++) {
+    if(data[i] != payload_byte(s, seq, i)) {
+      break;
+    }
+  }
+  if(datalen == DATAGRAM_LEN - UIP_IPUDPH_LEN && i == datalen) {
+    delivered++;
+  } else {
+    corrupt++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_datagram(int s, int seq)
+{
+  uint8_t *data;
+  int i;
+
+  /* Build the datagram in uip_buf to compute its UDP checksum. */
+  memset(uip_buf, 0, UIP_LLIPH_LEN + UIP_UDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (DATAGRAM_LEN - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (DATAGRAM_LEN - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, s + 1);
+  uip_create_linklocal_allnodes_mcast(&UIP_IP_BUF->destipaddr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(DATAGRAM_LEN - UIP_IPH_LEN);
+  data = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  data[0] = seq & 0xff;
+  data[1] = seq >> 8;
+  for(i = 2; i < DATAGRAM_LEN - UIP_IPUDPH_LEN; i++) {
+    data[i] = payload_byte(s, seq, i);
+  }
+  uip_len = DATAGRAM_LEN;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+  memcpy(datagram[s], &uip_buf[UIP_LLH_LEN], DATAGRAM_LEN);
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_fragment(int s, int seq, int fragment)
+{
+  uint16_t offset, len;
+
+  offset = fragment * FRAG_LEN;
+  len = DATAGRAM_LEN - UIP_IPH_LEN - offset;
+  if(len > FRAG_LEN) {
+    len = FRAG_LEN;
+  }
+  memcpy(UIP_IP_BUF, datagram[s], UIP_IPH_LEN);
+  UIP_IP_BUF->proto = UIP_PROTO_FRAG;
+  UIP_IP_BUF->len[0] = (UIP_FRAGH_LEN + len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_FRAGH_LEN + len) & 0xff;
+  UIP_FRAG_BUF->next = UIP_PROTO_UDP;
+  UIP_FRAG_BUF->res = 0;
+  UIP_FRAG_BUF->offsetresmore =
+    uip_htons(offset | (fragment < FRAGMENTS - 1 ? 1 : 0));
+  UIP_FRAG_BUF->id = uip_htonl(seq);
+  memcpy(&uip_buf[UIP_LLIPH_LEN + UIP_FRAGH_LEN],
+         &datagram[s][UIP_IPH_LEN + offset], len);
+  uip_len = UIP_IPH_LEN + UIP_FRAGH_LEN + len;
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int seq;
+  clock_time_t start;
+  int s, i, fragment;
+
+  PROCESS_BEGIN();
+
+  printf("Reassembly: %u contexts, %u bytes, %u senders, %u fragments per datagram\n",
+         UIP_REASS_CONTEXTS, UIP_REASS_BUDGET, BENCH_SENDERS, FRAGMENTS);
+
+  tcpip_set_outputfunc(output);
+  simple_udp_register(&connection, UDP_PORT, NULL, UDP_PORT, receiver);
+
+  start = clock_time();
+  for(seq = 0; seq < DATAGRAMS; seq++) {
+    for(s = 0; s < BENCH_SENDERS; s++) {
+      make_datagram(s, seq);
+    }
+    for(i = 0; i < FRAGMENTS; i++) {
+      for(s = 0; s < BENCH_SENDERS; s++) {
+        fragment = (s & 1) ? FRAGMENTS - 1 - i : i;
+        if(s == 1 && seq == 0 && fragment == FRAGMENTS / 2) {
+          continue;
+        }
+        input_fragment(s, seq, fragment);
+        if(s == 0) {
+          input_fragment(s, seq, fragment);
+        }
+      }
+    }
+  }
+  start = clock_time() - start;
+
+  printf("Delivered: %lu of %u datagrams, %lu corrupt\n",
+         delivered, DATAGRAMS * BENCH_SENDERS, corrupt);
+  printf("Fragments: %lu received, %lu dropped\n",
+         (unsigned long)uip_stat.frag.recv,
+         (unsigned long)uip_stat.frag.drop);
+  printf("Datagrams: %lu reassembled, %lu timed out, %lu evicted\n",
+         (unsigned long)uip_stat.frag.reassembled,
+         (unsigned long)uip_stat.frag.timeout,
+         (unsigned long)uip_stat.frag.evicted);
+  if(start > 0) {
+    printf("Fragments per second: %lu\n",
+           (unsigned long)uip_stat.frag.recv * CLOCK_SECOND / start);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with e.g. "make DEFINES=BENCH_SENDERS=8" to change the number
+ * of hosts that send fragmented datagrams at the same time, with
+ * "make DEFINES=BENCH_REASS_CONTEXTS=1" to reassemble one datagram at
+ * a time for comparison, and with "make DEFINES=BENCH_REASS_BUDGET=2048"
+ * to let the contexts share less memory than they could fill.
+ */
+#ifndef BENCH_SENDERS
+#define BENCH_SENDERS 4
+#endif
+
+#ifndef BENCH_REASS_CONTEXTS
+#define BENCH_REASS_CONTEXTS 4
+#endif
+
+#undef UIP_CONF_IPV6_REASSEMBLY
+#define UIP_CONF_IPV6_REASSEMBLY 1
+#define UIP_CONF_IPV6_REASS_CONTEXTS BENCH_REASS_CONTEXTS
+#ifdef BENCH_REASS_BUDGET
+#define UIP_CONF_IPV6_REASS_BUDGET BENCH_REASS_BUDGET
+#endif
+
+#undef UIP_CONF_BUFFER_SIZE
+#define UIP_CONF_BUFFER_SIZE 1280
+
+#define UIP_CONF_STATISTICS 1
+
+#endif /* PROJECT_CONF_H_ */
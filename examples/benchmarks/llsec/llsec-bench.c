@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for link layer security drivers.
+ *
+ *         The benchmark secures unicast frames and passes them to the
+ *         input function of the same driver, alternating between
+ *         BENCH_LINKS links, and measures how many frames per second
+ *         noncoresec and pairwisesec get through. The two drivers take
+ *         turns, CHUNK frames at a time. The node plays both
+ *         ends of every link by changing its own link-layer address.
+ *
+ *         Before measuring, pairwisesec establishes a session on each
+ *         link. Its handshake frames go through a MAC driver that
+ *         loops them back to the other end of the link.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/linkaddr.h"
+#include "net/mac/frame802154.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/noncoresec/noncoresec.h"
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#include "lib/aes-128.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define HDR_LEN    23
+#define ITERATIONS 400000UL
+/* Number of frames a driver gets through in a row */
+#define CHUNK      20000UL
+
+static unsigned long delivered;
+/* default key of noncoresec */
+static uint8_t noncoresec_key[AES_128_KEY_LENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+/* driver under test, to which the MAC driver loops frames back */
+static const struct llsec_driver *driver;
+
+PROCESS(bench_process, "LLSEC benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+network_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+network_input(void)
+{
+  delivered++;
+}
+/*---------------------------------------------------------------------------*/
+const struct network_driver bench_network_driver = {
+  "bench",
+  network_init,
+  network_input
+};
+/*---------------------------------------------------------------------------*/
+static void
+bootstrapped(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_addr(linkaddr_t *addr, int link, int end)
+{
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 1] = 2 * link + end + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_frame(const linkaddr_t *sender, const linkaddr_t *receiver)
+{
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0x5a, BENCH_PAYLOAD);
+  packetbuf_set_datalen(BENCH_PAYLOAD);
+  packetbuf_hdralloc(HDR_LEN);
+  memset(packetbuf_hdrptr(), 0x41, HDR_LEN);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, receiver);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, LLSEC802154_SECURITY_LEVEL);
+  anti_replay_set_counter();
+}
+/*---------------------------------------------------------------------------*/
+/* Turns the created frame into a received one, as the framer leaves it */
+static void
+receive_frame(void)
+{
+  uint8_t frame[PACKETBUF_SIZE];
+  int len;
+
+  len = packetbuf_copyto(frame);
+  packetbuf_hdr_remove(HDR_LEN);
+  memcpy(packetbuf_dataptr(), frame, len);
+  packetbuf_set_datalen(len);
+  packetbuf_hdrreduce(HDR_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* Passes the frame to the other end of the link, even if broadcast */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  linkaddr_t self;
+
+  linkaddr_copy(&self, &linkaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &self);
+  packetbuf_hdralloc(HDR_LEN);
+  memset(packetbuf_hdrptr(), 0x41, HDR_LEN);
+  if(driver->on_frame_created()) {
+    receive_frame();
+    linkaddr_node_addr.u8[LINKADDR_SIZE - 1]
+        = ((self.u8[LINKADDR_SIZE - 1] - 1) ^ 1) + 1;
+    driver->input();
+    linkaddr_copy(&linkaddr_node_addr, &self);
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval
+};
+/*---------------------------------------------------------------------------*/
+/* Tries to secure a frame on the link, which fails until pairwisesec
+   has established a session and makes it send a HELLO */
+static int
+try_link(int link)
+{
+  linkaddr_t sender, receiver;
+
+  set_addr(&sender, link, 0);
+  set_addr(&receiver, link, 1);
+  linkaddr_copy(&linkaddr_node_addr, &sender);
+  make_frame(&sender, &receiver);
+  return driver->on_frame_created();
+}
+/*---------------------------------------------------------------------------*/
+/* Passes CHUNK frames through the driver and returns the time it took */
+static clock_time_t
+run_chunk(void)
+{
+  linkaddr_t sender, receiver;
+  unsigned long i;
+  clock_time_t start;
+  int link;
+
+  start = clock_time();
+  for(i = 0; i < CHUNK; i++) {
+    link = i % BENCH_LINKS;
+    set_addr(&sender, link, 0);
+    set_addr(&receiver, link, 1);
+
+    linkaddr_copy(&linkaddr_node_addr, &sender);
+    make_frame(&sender, &receiver);
+    driver->on_frame_created();
+    receive_frame();
+
+    linkaddr_copy(&linkaddr_node_addr, &receiver);
+    driver->input();
+  }
+  return clock_time() - start;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+rate(clock_time_t elapsed)
+{
+  return ITERATIONS * CLOCK_SECOND / (elapsed ? elapsed : 1);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static clock_time_t noncoresec_time, pairwisesec_time;
+  static unsigned long noncoresec_delivered, before, i;
+  static struct etimer et;
+  static int link;
+
+  PROCESS_BEGIN();
+
+  printf("LLSEC: %u links, %u byte payload\n", BENCH_LINKS, BENCH_PAYLOAD);
+  noncoresec_driver.bootstrap(bootstrapped);
+  driver = &pairwisesec_driver;
+  driver->bootstrap(bootstrapped);
+  for(link = 0; link < BENCH_LINKS; link++) {
+    while(!try_link(link)) {
+      etimer_set(&et, CLOCK_SECOND / 16);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    }
+  }
+  printf("pairwisesec: established %u sessions\n", BENCH_LINKS);
+
+  /* The drivers take turns, so that both see the same load on the host */
+  noncoresec_time = pairwisesec_time = 0;
+  delivered = noncoresec_delivered = 0;
+  for(i = 0; i < ITERATIONS; i += CHUNK) {
+    /* noncoresec expects AES_128 to keep its key */
+    AES_128.set_key(noncoresec_key);
+    driver = &noncoresec_driver;
+    before = delivered;
+    noncoresec_time += run_chunk();
+    noncoresec_delivered += delivered - before;
+
+    driver = &pairwisesec_driver;
+    pairwisesec_time += run_chunk();
+  }
+
+  printf("noncoresec: %lu frames/s, %lu of %lu delivered\n",
+         rate(noncoresec_time), noncoresec_delivered, ITERATIONS);
+  printf("pairwisesec: %lu frames/s, %lu of %lu delivered\n",
+         rate(pairwisesec_time), delivered - noncoresec_delivered, ITERATIONS);
+  printf("pairwisesec throughput: %lu%% of noncoresec\n",
+         (unsigned long)noncoresec_time * 100 / (pairwisesec_time ? pairwisesec_time : 1));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with e.g. "make DEFINES=BENCH_LINKS=1" to change the number of
+ * links that frames alternate between, and with
+ * "make DEFINES=AES_128_CONF=aes_128_ttable_driver,AES_128_TTABLE_CONF_CACHED_KEYS=9"
+ * to keep the expanded pairwise keys.
+ */
+#ifndef BENCH_LINKS
+#define BENCH_LINKS 4
+#endif
+
+#ifndef BENCH_PAYLOAD
+#define BENCH_PAYLOAD 80
+#endif
+
+#define LLSEC802154_CONF_SECURITY_LEVEL 6
+
+/* Sessions are established one link after the other */
+#define PAIRWISESEC_CONF_HELLO_INTERVAL (CLOCK_SECOND / 8)
+
+/* Handshake frames are looped back by the benchmark */
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC bench_mac_driver
+
+/* Frames are passed to the benchmark instead of 6LoWPAN */
+#undef NETSTACK_CONF_NETWORK
+#define NETSTACK_CONF_NETWORK bench_network_driver
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for neighbor table lookups.
+ *
+ *         The benchmark fills a neighbor table and measures how fast
+ *         neighbors are looked up by link-layer address, both for
+ *         neighbors that are in the table and for unknown neighbors.
+ *         It also checks that lookups stay correct when neighbors are
+ *         replaced.
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define LOOKUPS 2000000UL
+
+struct bench_item {
+  int id;
+};
+
+NBR_TABLE(struct bench_item, bench_table);
+
+PROCESS(bench_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *lladdr, int id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 2] = id >> 8;
+  lladdr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+lookups_per_second(int first_id)
+{
+  unsigned long i, found;
+  clock_time_t start;
+  linkaddr_t lladdr;
+
+  found = 0;
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; i++) {
+    make_lladdr(&lladdr, first_id + random_rand() % NBR_TABLE_MAX_NEIGHBORS);
+    if(nbr_table_get_from_lladdr(bench_table, &lladdr) != NULL) {
+      found++;
+    }
+  }
+  start = clock_time() - start;
+  if(found != 0 && found != LOOKUPS) {
+    printf("Error: %lu of %lu lookups succeeded\n", found, LOOKUPS);
+  }
+  return start > 0 ? LOOKUPS * CLOCK_SECOND / start : 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  linkaddr_t lladdr;
+  struct bench_item *item;
+  int i, errors;
+
+  PROCESS_BEGIN();
+
+  nbr_table_register(bench_table, NULL);
+
+  printf("Neighbor table: %s, %u neighbors\n",
+         NBR_TABLE_WITH_HASH ? "hash index" : "linear search",
+         NBR_TABLE_MAX_NEIGHBORS);
+
+  /* Fill the table twice over, so that the first half of the
+     neighbors is replaced by the second half. */
+  for(i = 0; i < 2 * NBR_TABLE_MAX_NEIGHBORS; i++) {
+    make_lladdr(&lladdr, i);
+    item = nbr_table_add_lladdr(bench_table, &lladdr);
+    if(item != NULL) {
+      item->id = i;
+    }
+  }
+
+  errors = 0;
+  for(i = 0; i < 2 * NBR_TABLE_MAX_NEIGHBORS; i++) {
+    make_lladdr(&lladdr, i);
+    item = nbr_table_get_from_lladdr(bench_table, &lladdr);
+    if(i < NBR_TABLE_MAX_NEIGHBORS ? item != NULL :
+       item == NULL || item->id != i) {
+      errors++;
+    }
+  }
+  printf("Consistency check: %d errors\n", errors);
+
+  printf("Hits: %lu lookups/s\n",
+         lookups_per_second(NBR_TABLE_MAX_NEIGHBORS));
+  printf("Misses: %lu lookups/s\n",
+         lookups_per_second(2 * NBR_TABLE_MAX_NEIGHBORS));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
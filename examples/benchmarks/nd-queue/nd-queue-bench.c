@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for queuing packets during address resolution.
+ *
+ *         A burst of UDP datagrams is sent to an on-link neighbor
+ *         whose link-layer address is not known yet, as when CoAP
+ *         requests go out to a new node. The neighbor then answers the
+ *         neighbor solicitation with a neighbor advertisement, which
+ *         lets the queued datagrams go out. This is repeated for a
+ *         number of neighbors in turn. The benchmark counts the
+ *         datagrams that are sent, and checks that each neighbor gets
+ *         them in the order they were queued.
+ *
+ *         In every other round, the link-layer address of the neighbor
+ *         becomes known without the queue being flushed, as when an NS
+ *         with SLLAO is received, and one more datagram is sent, which
+ *         must not overtake the queued ones.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/uip-nd6.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT      5683
+#define ROUNDS        4000
+#define PAYLOAD_LEN   32
+#define NBRS          4
+
+#define UIP_IP_BUF     ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF   ((struct uip_icmp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+#define UIP_ND6_NA_BUF ((uip_nd6_na *)&uip_buf[UIP_LLIPH_LEN + UIP_ICMPH_LEN])
+
+static struct simple_udp_connection connection;
+static uip_ipaddr_t nbr_addr[NBRS];
+static uip_lladdr_t nbr_lladdr[NBRS];
+/* The sequence number of the next datagram a neighbor should get */
+static int next_seq[NBRS];
+static unsigned long sent, delivered, reordered;
+
+PROCESS(bench_process, "Address resolution queue benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  uint8_t *payload;
+  int n;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_UDP && lladdr != NULL) {
+    payload = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+    n = payload[0];
+    if(n < NBRS &&
+       memcmp(lladdr, &nbr_lladdr[n], sizeof(uip_lladdr_t)) == 0) {
+      delivered++;
+      if(payload[1] < next_seq[n]) {
+        reordered++;
+      }
+      next_seq[n] = payload[1] + 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Sets the link-layer address of a neighbor as ns_input() does */
+static void
+learn_lladdr(int n)
+{
+  uip_ds6_nbr_t *nbr;
+
+  nbr = uip_ds6_nbr_lookup(&nbr_addr[n]);
+  if(nbr != NULL) {
+    memcpy((uip_lladdr_t *)uip_ds6_nbr_get_ll(nbr), &nbr_lladdr[n],
+           UIP_LLADDR_LEN);
+    nbr->state = NBR_STALE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_na(int n)
+{
+  uint8_t *llao;
+
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPH_LEN + UIP_ICMPH_LEN +
+         UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &nbr_addr[n]);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_ICMP_BUF->type = ICMP6_NA;
+  UIP_ND6_NA_BUF->flagsreserved =
+    UIP_ND6_NA_FLAG_SOLICITED | UIP_ND6_NA_FLAG_OVERRIDE;
+  uip_ipaddr_copy(&UIP_ND6_NA_BUF->tgtipaddr, &nbr_addr[n]);
+  llao = &uip_buf[UIP_LLIPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN];
+  llao[UIP_ND6_OPT_TYPE_OFFSET] = UIP_ND6_OPT_TLLAO;
+  llao[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_LLAO_LEN >> 3;
+  memcpy(&llao[UIP_ND6_OPT_DATA_OFFSET], &nbr_lladdr[n], UIP_LLADDR_LEN);
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t payload[PAYLOAD_LEN];
+  static int round;
+  clock_time_t start;
+  int n, i;
+
+  PROCESS_BEGIN();
+
+  printf("Queue: %u packets per neighbor, %u packets, %u bytes; bursts of %u\n",
+         UIP_QUEUE_PKT_NBR, UIP_QUEUE_PKT_MAX, UIP_QUEUE_PKT_BUDGET,
+         BENCH_BURST);
+
+  tcpip_set_outputfunc(output);
+  simple_udp_register(&connection, UDP_PORT, NULL, UDP_PORT, NULL);
+  for(n = 0; n < NBRS; n++) {
+    memset(&nbr_lladdr[n], 0, sizeof(uip_lladdr_t));
+    nbr_lladdr[n].addr[0] = 0x02;
+    nbr_lladdr[n].addr[sizeof(uip_lladdr_t) - 1] = n + 1;
+    uip_ip6addr(&nbr_addr[n], 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&nbr_addr[n], &nbr_lladdr[n]);
+  }
+
+  start = clock_time();
+  for(round = 0; round < ROUNDS; round++) {
+    n = round % NBRS;
+    memset(payload, round, sizeof(payload));
+    payload[0] = n;
+    for(i = 0; i < BENCH_BURST; i++) {
+      payload[1] = i;
+      simple_udp_sendto(&connection, payload, sizeof(payload), &nbr_addr[n]);
+      sent++;
+    }
+    next_seq[n] = 0;
+    if(round & 1) {
+      learn_lladdr(n);
+      payload[1] = BENCH_BURST;
+      simple_udp_sendto(&connection, payload, sizeof(payload), &nbr_addr[n]);
+      sent++;
+    } else {
+      input_na(n);
+    }
+    /* Resolve the neighbor again the next time. */
+    uip_ds6_nbr_rm(uip_ds6_nbr_lookup(&nbr_addr[n]));
+  }
+  start = clock_time() - start;
+
+  printf("Sent: %lu of %lu datagrams, %lu out of order\n",
+         delivered, sent, reordered);
+  printf("Queue: %lu queued, %lu evicted, %lu timed out, %lu dropped\n",
+         (unsigned long)uip_stat.nd6queue.queued,
+         (unsigned long)uip_stat.nd6queue.evicted,
+         (unsigned long)uip_stat.nd6queue.timeout,
+         (unsigned long)uip_stat.nd6queue.drop);
+  if(start > 0) {
+    printf("Datagrams per second: %lu\n",
+           sent * CLOCK_SECOND / start);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
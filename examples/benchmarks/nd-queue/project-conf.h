@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with e.g. "make DEFINES=BENCH_BURST=16" to change the number
+ * of packets sent to each neighbor before it is resolved, and with
+ * "make DEFINES=BENCH_QUEUE_NBR=1,BENCH_QUEUE_MAX=2" to queue only one
+ * packet per neighbor for comparison.
+ */
+#ifndef BENCH_BURST
+#define BENCH_BURST 8
+#endif
+
+#ifndef BENCH_QUEUE_NBR
+#define BENCH_QUEUE_NBR 8
+#endif
+
+#ifndef BENCH_QUEUE_MAX
+#define BENCH_QUEUE_MAX 16
+#endif
+
+#ifndef BENCH_QUEUE_BUDGET
+#define BENCH_QUEUE_BUDGET 1024
+#endif
+
+#define UIP_CONF_IPV6_QUEUE_PKT_NBR BENCH_QUEUE_NBR
+#define UIP_CONF_IPV6_QUEUE_PKT_MAX BENCH_QUEUE_MAX
+#define UIP_CONF_IPV6_QUEUE_PKT_BUDGET BENCH_QUEUE_BUDGET
+
+#define UIP_CONF_STATISTICS 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the event dispatcher of the process kernel.
+ *
+ *         The benchmark first measures how many events per second
+ *         the kernel delivers from a full event queue. It then fills
+ *         the queue with broadcast events, posts a single event to a
+ *         high-priority process and measures how many events were
+ *         dispatched before it, and how long it took, in the worst
+ *         case.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+
+#define THROUGHPUT_EVENTS 200000UL
+#define LATENCY_ROUNDS    1000
+
+/* Number of idle processes that receive the broadcast events. */
+#define NUM_LISTENERS     8
+
+static process_event_t bench_event, urgent_event;
+static unsigned long dispatched;
+static unsigned long urgent_dispatched;
+static unsigned char urgent_done;
+static clock_time_t urgent_time;
+
+PROCESS(bench_process, "Dispatch benchmark");
+PROCESS(sink_process, "Sink");
+PROCESS(urgent_process, "Urgent");
+PROCESS(listener_process0, "Listener");
+PROCESS(listener_process1, "Listener");
+PROCESS(listener_process2, "Listener");
+PROCESS(listener_process3, "Listener");
+PROCESS(listener_process4, "Listener");
+PROCESS(listener_process5, "Listener");
+PROCESS(listener_process6, "Listener");
+PROCESS(listener_process7, "Listener");
+AUTOSTART_PROCESSES(&bench_process);
+
+static struct process * const listeners[NUM_LISTENERS] = {
+  &listener_process0, &listener_process1, &listener_process2,
+  &listener_process3, &listener_process4, &listener_process5,
+  &listener_process6, &listener_process7
+};
+/*---------------------------------------------------------------------------*/
+#define LISTENER_THREAD(name)                   \
+  PROCESS_THREAD(name, ev, data)                \
+  {                                             \
+    PROCESS_BEGIN();                            \
+    while(1) {                                  \
+      PROCESS_WAIT_EVENT();                     \
+    }                                           \
+    PROCESS_END();                              \
+  }
+LISTENER_THREAD(listener_process0)
+LISTENER_THREAD(listener_process1)
+LISTENER_THREAD(listener_process2)
+LISTENER_THREAD(listener_process3)
+LISTENER_THREAD(listener_process4)
+LISTENER_THREAD(listener_process5)
+LISTENER_THREAD(listener_process6)
+LISTENER_THREAD(listener_process7)
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == bench_event) {
+      dispatched++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(urgent_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == urgent_event) {
+      urgent_dispatched = dispatched;
+      urgent_time = clock_time();
+      urgent_done = 1;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static unsigned long posted;
+  static unsigned long start_dispatched;
+  static unsigned long worst_events;
+  static clock_time_t start, worst_time;
+  static int round;
+  int i;
+
+  PROCESS_BEGIN();
+
+  bench_event = process_alloc_event();
+  urgent_event = process_alloc_event();
+  process_start(&sink_process, NULL);
+  process_start(&urgent_process, NULL);
+  process_set_priority(&urgent_process, PROCESS_PRIO_HIGH);
+  for(i = 0; i < NUM_LISTENERS; i++) {
+    process_start(listeners[i], NULL);
+  }
+
+  printf("Scheduler: %s, %u events per process_run()\n",
+         PROCESS_CONF_PRIORITIES ? "priority queues" : "single FIFO",
+         PROCESS_BATCH_EVENTS);
+
+  /* Throughput: keep the event queue full of events to the sink,
+     leaving room for the event that PROCESS_PAUSE() posts. */
+  posted = 0;
+  dispatched = 0;
+  start = clock_time();
+  while(posted < THROUGHPUT_EVENTS) {
+    while(process_nevents() < PROCESS_CONF_NUMEVENTS - 1) {
+      process_post(&sink_process, bench_event, NULL);
+      posted++;
+    }
+    PROCESS_PAUSE();
+  }
+  while(dispatched < posted) {
+    PROCESS_PAUSE();
+  }
+  start = clock_time() - start;
+  printf("Throughput: %lu events in %lu ms, %lu events/s\n",
+         dispatched, (unsigned long)start,
+         start > 0 ? dispatched * CLOCK_SECOND / start : 0);
+
+  /* Latency: post an event to the high-priority process behind a
+     queue full of broadcast events. */
+  worst_events = 0;
+  worst_time = 0;
+  for(round = 0; round < LATENCY_ROUNDS; round++) {
+    while(process_nevents() < PROCESS_CONF_NUMEVENTS - 2) {
+      process_post(PROCESS_BROADCAST, bench_event, NULL);
+    }
+    start_dispatched = dispatched;
+    urgent_done = 0;
+    start = clock_time();
+    process_post(&urgent_process, urgent_event, NULL);
+    while(!urgent_done || process_nevents() > 0) {
+      PROCESS_PAUSE();
+    }
+
+    if(urgent_dispatched - start_dispatched > worst_events) {
+      worst_events = urgent_dispatched - start_dispatched;
+    }
+    if(urgent_time - start > worst_time) {
+      worst_time = urgent_time - start;
+    }
+  }
+  printf("Worst-case latency: %lu events dispatched before the urgent event, %lu ms\n",
+         worst_events, (unsigned long)worst_time);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
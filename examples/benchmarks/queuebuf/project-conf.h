@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with "make DEFINES=BENCH_SMALL_NUM=0" to store every packet
+ * in a full-size buffer for comparison, and with e.g.
+ * "make DEFINES=BENCH_NUM=10" to change the number of full-size
+ * buffers. Build with "make DEFINES=BENCH_SHARE=0" to have the sniffer
+ * copy the packets it logs instead of sharing their queue buffers.
+ */
+#ifndef BENCH_NUM
+#define BENCH_NUM 6
+#endif
+
+#ifndef BENCH_SMALL_NUM
+#define BENCH_SMALL_NUM 8
+#endif
+
+#ifndef BENCH_SHARE
+#define BENCH_SHARE 1
+#endif
+
+#define QUEUEBUF_CONF_NUM BENCH_NUM
+#define QUEUEBUF_CONF_SMALL_NUM BENCH_SMALL_NUM
+#define QUEUEBUF_CONF_STATS 1
+#define QUEUEBUF_CONF_STATS_ANNOTATE 0
+
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC csma_driver
+
+/* Packets go to a stub RDC, and CSMA shows them to the sniffer */
+#undef NETSTACK_CONF_RDC
+#define NETSTACK_CONF_RDC bench_rdc_driver
+#define CSMA_CONF_SNIFFER bench_sniffer
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for queue buffers.
+ *
+ *         The benchmark queues a mix of short packets, such as
+ *         acknowledgements, and full data packets until no queue
+ *         buffer is left, and checks that a queued short packet that
+ *         outgrows its buffer is refused, and left intact, while no
+ *         full-size buffer is free.
+ *
+ *         It then sends data packets through CSMA, which has to
+ *         retransmit each of them once, and logs every transmission
+ *         with a sniffer. The sniffer shares the queue buffer of the
+ *         packet, or copies it when built with BENCH_SHARE=0. The
+ *         benchmark reports how many transmissions the sniffer could
+ *         log, and the number of buffers in use meanwhile.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/netstack.h"
+#include "net/mac/csma.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SHORT_LEN      12
+#define DATA_LEN       100
+/* One packet in DATA_EVERY is a data packet, the others are short */
+#define DATA_EVERY     4
+#define MAX_QUEUED     (QUEUEBUF_NUM + QUEUEBUF_SMALL_NUM)
+/* The data packets sent through CSMA, and their transmissions */
+#define SNIFFED        4
+#define LOG_LEN        (2 * SNIFFED)
+
+/* The size of a queue buffer, not counting padding */
+#define BUF_SIZE(data_size) (sizeof(uint16_t) + (data_size) +           \
+    PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) +               \
+    PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr))
+
+static struct queuebuf *queued[MAX_QUEUED + 1];
+static struct queuebuf *sniffer_log[LOG_LEN];
+/* The packet that each log entry holds */
+static int log_packet[LOG_LEN];
+static int logged, sniffed, acked, done;
+static linkaddr_t neighbor;
+
+PROCESS(bench_process, "Queuebuf benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_packet(int i, uint16_t len)
+{
+  uint8_t data[DATA_LEN];
+  uint16_t j;
+
+  for(j = 0; j < len; j++) {
+    data[j] = (uint8_t)(i + j);
+  }
+  packetbuf_clear();
+  packetbuf_copyfrom(data, len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_packet(int i, struct queuebuf *q, uint16_t len)
+{
+  uint8_t *data;
+  uint16_t j;
+
+  if(queuebuf_datalen(q) != len) {
+    return 0;
+  }
+  data = queuebuf_dataptr(q);
+  for(j = 0; j < len; j++) {
+    if(data[j] != (uint8_t)(i + j)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+packet_len(int i)
+{
+  return i % DATA_EVERY == DATA_EVERY - 1 ? DATA_LEN : SHORT_LEN;
+}
+/*---------------------------------------------------------------------------*/
+/* Called by CSMA after each transmission */
+void
+bench_sniffer(struct queuebuf *buf, int status, int transmissions)
+{
+  struct queuebuf *q;
+
+  if(!linkaddr_cmp(queuebuf_addr(buf, PACKETBUF_ADDR_RECEIVER), &neighbor) ||
+     sniffed == LOG_LEN) {
+    return;
+  }
+  sniffed++;
+#if BENCH_SHARE
+  q = queuebuf_share(buf);
+#else /* BENCH_SHARE */
+  /* The packetbuf holds the frame that was sent */
+  q = queuebuf_new_from_packetbuf();
+#endif /* BENCH_SHARE */
+  if(q != NULL) {
+    /* A packet and its retransmission follow each other */
+    log_packet[logged] = (sniffed - 1) / 2;
+    sniffer_log[logged++] = q;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_rdc_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_rdc_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+  static int attempts;
+  int status;
+
+  queuebuf_to_packetbuf(list->buf);
+  status = MAC_TX_OK;
+  if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &neighbor) &&
+     attempts++ % 2 == 0) {
+    /* The neighbor acknowledges every packet at the second attempt */
+    status = MAC_TX_NOACK;
+  }
+  mac_call_sent_callback(sent, ptr, status, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_rdc_send(mac_callback_t sent, void *ptr)
+{
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_rdc_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench_rdc_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench_rdc_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+bench_rdc_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver bench_rdc_driver = {
+  "bench_rdc",
+  bench_rdc_init,
+  bench_rdc_send,
+  bench_rdc_send_list,
+  bench_rdc_input,
+  bench_rdc_on,
+  bench_rdc_off,
+  bench_rdc_channel_check_interval
+};
+/*---------------------------------------------------------------------------*/
+static void
+sent(void *ptr, int status, int transmissions)
+{
+  if(status == MAC_TX_OK) {
+    acked++;
+  }
+  done++;
+  process_poll(&bench_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  unsigned long i;
+  int n, data_packets, intact, updated;
+  static uint16_t full;
+
+  PROCESS_BEGIN();
+
+  printf("Queuebuf: %u full-size and %u small buffers, about %lu bytes\n",
+         QUEUEBUF_NUM, QUEUEBUF_SMALL_NUM,
+         (unsigned long)(QUEUEBUF_NUM * BUF_SIZE(PACKETBUF_SIZE) +
+                         QUEUEBUF_SMALL_NUM * BUF_SIZE(QUEUEBUF_SMALL_SIZE)));
+
+  /* Queue packets until no buffer is left */
+  data_packets = 0;
+  for(n = 0; n <= MAX_QUEUED; n++) {
+    make_packet(n, packet_len(n));
+    queued[n] = queuebuf_new_from_packetbuf();
+    if(queued[n] == NULL) {
+      break;
+    }
+    if(packet_len(n) == DATA_LEN) {
+      data_packets++;
+    }
+  }
+  intact = 0;
+  for(i = 0; i < n; i++) {
+    intact += check_packet(i, queued[i], packet_len(i));
+  }
+  printf("Queued: %d packets (%d data packets), %d intact\n",
+         n, data_packets, intact);
+  printf("Buffers in use: %u (peak %u), %u small; %u allocations failed\n",
+         queuebuf_len, queuebuf_peak_len, queuebuf_small_len, queuebuf_full);
+
+  /* Grow the first queued packet, which is short, to a data packet */
+  make_packet(0, DATA_LEN);
+  updated = queuebuf_update_from_packetbuf(queued[0]);
+  printf("Growing a queued short packet: %s, %s\n",
+         updated ? "updated" : "refused",
+         check_packet(0, queued[0], updated ? DATA_LEN : SHORT_LEN) ?
+         "intact" : "corrupt");
+
+  for(i = 0; i < n; i++) {
+    queuebuf_free(queued[i]);
+  }
+
+  /* Send data packets through CSMA, which the sniffer logs */
+  memset(&neighbor, 0, sizeof(neighbor));
+  neighbor.u8[LINKADDR_SIZE - 1] = 2;
+  queuebuf_peak_len = queuebuf_len;
+  full = queuebuf_full;
+  for(n = 0; n < SNIFFED; n++) {
+    make_packet(n, DATA_LEN);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &neighbor);
+    NETSTACK_MAC.send(sent, NULL);
+  }
+  while(done < SNIFFED) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+  }
+
+  intact = 0;
+  for(i = 0; i < logged; i++) {
+    intact += check_packet(log_packet[i], sniffer_log[i], DATA_LEN);
+  }
+  printf("Sniffer (%s): %d packets acked, %d of %d transmissions logged, %d intact\n",
+         BENCH_SHARE ? "sharing" : "copying", acked, logged, sniffed, intact);
+  printf("Buffers in use while sniffing: peak %u; %u allocations failed\n",
+         queuebuf_peak_len, queuebuf_full - full);
+  for(i = 0; i < logged; i++) {
+    queuebuf_free(sniffer_log[i]);
+  }
+  printf("Buffers in use at the end: %u\n", queuebuf_len);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
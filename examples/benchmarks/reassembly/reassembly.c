@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for 6lowpan reassembly with concurrent senders.
+ *
+ *         A number of neighbors send fragmented UDP datagrams at the
+ *         same time, so that their fragments arrive interleaved.
+ *         Every other sender sends its fragments in reverse order and
+ *         the first sender sends every fragment twice. One fragment
+ *         of the first datagram of the second sender is lost. The
+ *         benchmark counts the datagrams that are delivered intact
+ *         and measures how fast fragments are processed.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT      5678
+#define DATAGRAMS     200
+#define DATAGRAM_LEN  640
+/* The uncompressed datagram bytes in the first fragment and in the
+   following fragments. Both are multiples of eight. */
+#define FRAG1_LEN     88
+#define FRAGN_LEN     96
+#define FRAGMENTS     (1 + (DATAGRAM_LEN - FRAG1_LEN + FRAGN_LEN - 1) / FRAGN_LEN)
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF   ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+static struct simple_udp_connection connection;
+static uint8_t datagram[BENCH_SENDERS][DATAGRAM_LEN];
+static linkaddr_t sender[BENCH_SENDERS];
+static unsigned long delivered, corrupt;
+
+PROCESS(bench_process, "Reassembly benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+payload_byte(int s, int seq, int i)
+{
+  return (uint8_t)(s * 31 + seq * 7 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  int i, s, seq;
+
+  s = sender_addr->u8[15] - 1;
+  seq = data[0] | (data[1] << 8);
+  for(i = 2; i < datalen; i++) {
+    if(data[i] != payload_byte(s, seq, i)) {
+      break;
+    }
+  }
+  if(datalen == DATAGRAM_LEN - UIP_IPUDPH_LEN && i == datalen) {
+    delivered++;
+  } else {
+    corrupt++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_datagram(int s, int seq)
+{
+  uint8_t *data;
+  int i;
+
+  /* Build the datagram in uip_buf to compute its UDP checksum. */
+  memset(uip_buf, 0, UIP_LLIPH_LEN + UIP_UDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (DATAGRAM_LEN - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (DATAGRAM_LEN - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, s + 1);
+  uip_create_linklocal_allnodes_mcast(&UIP_IP_BUF->destipaddr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(DATAGRAM_LEN - UIP_IPH_LEN);
+  data = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  data[0] = seq & 0xff;
+  data[1] = seq >> 8;
+  for(i = 2; i < DATAGRAM_LEN - UIP_IPUDPH_LEN; i++) {
+    data[i] = payload_byte(s, seq, i);
+  }
+  uip_len = DATAGRAM_LEN;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+  memcpy(datagram[s], &uip_buf[UIP_LLH_LEN], DATAGRAM_LEN);
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_fragment(int s, int seq, int fragment)
+{
+  uint8_t *frag;
+  uint16_t offset, len;
+
+  packetbuf_clear();
+  frag = packetbuf_dataptr();
+  frag[1] = DATAGRAM_LEN & 0xff;
+  frag[2] = seq >> 8;
+  frag[3] = seq & 0xff;
+  if(fragment == 0) {
+    frag[0] = SICSLOWPAN_DISPATCH_FRAG1 | (DATAGRAM_LEN >> 8);
+    frag[SICSLOWPAN_FRAG1_HDR_LEN] = SICSLOWPAN_DISPATCH_IPV6;
+    memcpy(&frag[SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN],
+           datagram[s], FRAG1_LEN);
+    len = SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN + FRAG1_LEN;
+  } else {
+    offset = FRAG1_LEN + (fragment - 1) * FRAGN_LEN;
+    len = DATAGRAM_LEN - offset < FRAGN_LEN ? DATAGRAM_LEN - offset : FRAGN_LEN;
+    frag[0] = SICSLOWPAN_DISPATCH_FRAGN | (DATAGRAM_LEN >> 8);
+    frag[4] = offset >> 3;
+    memcpy(&frag[SICSLOWPAN_FRAGN_HDR_LEN], &datagram[s][offset], len);
+    len += SICSLOWPAN_FRAGN_HDR_LEN;
+  }
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender[s]);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int seq;
+  clock_time_t start;
+  int s, i, fragment;
+
+  PROCESS_BEGIN();
+
+  printf("Reassembly: %u contexts, %u senders, %u fragments per datagram\n",
+         SICSLOWPAN_REASS_CONTEXTS, BENCH_SENDERS, FRAGMENTS);
+
+  simple_udp_register(&connection, UDP_PORT, NULL, UDP_PORT, receiver);
+  for(s = 0; s < BENCH_SENDERS; s++) {
+    memset(&sender[s], 0, sizeof(linkaddr_t));
+    sender[s].u8[LINKADDR_SIZE - 1] = s + 1;
+  }
+
+  start = clock_time();
+  for(seq = 0; seq < DATAGRAMS; seq++) {
+    for(s = 0; s < BENCH_SENDERS; s++) {
+      make_datagram(s, seq);
+    }
+    for(i = 0; i < FRAGMENTS; i++) {
+      for(s = 0; s < BENCH_SENDERS; s++) {
+        fragment = (s & 1) ? FRAGMENTS - 1 - i : i;
+        if(s == 1 && seq == 0 && fragment == FRAGMENTS / 2) {
+          continue;
+        }
+        input_fragment(s, seq, fragment);
+        if(s == 0) {
+          input_fragment(s, seq, fragment);
+        }
+      }
+    }
+  }
+  start = clock_time() - start;
+
+  printf("Delivered: %lu of %u datagrams, %lu corrupt\n",
+         delivered, DATAGRAMS * BENCH_SENDERS, corrupt);
+  printf("Fragments: %lu received, %lu dropped\n",
+         (unsigned long)sicslowpan_stats.frag.recv,
+         (unsigned long)sicslowpan_stats.frag.drop);
+  printf("Datagrams: %lu reassembled, %lu timed out, %lu evicted\n",
+         (unsigned long)sicslowpan_stats.frag.reassembled,
+         (unsigned long)sicslowpan_stats.frag.timeout,
+         (unsigned long)sicslowpan_stats.frag.evicted);
+  if(start > 0) {
+    printf("Fragments per second: %lu\n",
+           (unsigned long)sicslowpan_stats.frag.recv * CLOCK_SECOND / start);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for IPv6 route lookups.
+ *
+ *         The benchmark fills the routing table with host routes via
+ *         a single neighbor, as on an RPL root in storing mode, plus
+ *         a prefix route. It then looks up routes for a stream of
+ *         packets to random destinations, as the forwarding path
+ *         does, and for destinations that are not in the table.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define LOOKUPS 1000000UL
+
+PROCESS(bench_process, "Route lookup benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_destination(uip_ipaddr_t *addr, int id)
+{
+  uip_ip6addr(addr, 0xaaaa, 0, 0, 0, 0x0212, 0x7400, id >> 8, id & 0xff);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+lookups_per_second(int first_id, int count, int expect_host_route)
+{
+  unsigned long i, errors;
+  clock_time_t start;
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+
+  errors = 0;
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; i++) {
+    make_destination(&addr, first_id + random_rand() % count);
+    r = uip_ds6_route_lookup(&addr);
+    if(r == NULL || (r->length == 128) != expect_host_route) {
+      errors++;
+    }
+  }
+  start = clock_time() - start;
+  if(errors > 0) {
+    printf("Error: %lu lookups returned the wrong route\n", errors);
+  }
+  return start > 0 ? LOOKUPS * CLOCK_SECOND / start : 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uip_ipaddr_t nexthop, addr;
+  static uip_lladdr_t lladdr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Route lookup: %s, %u routes\n",
+         UIP_DS6_ROUTE_WITH_HASH ? "hash index" : "linear search",
+         BENCH_ROUTES);
+
+  uip_ip6addr(&nexthop, 0xfe80, 0, 0, 0, 0x0212, 0x7401, 0x0001, 0x0101);
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[sizeof(lladdr.addr) - 1] = 1;
+  uip_ds6_nbr_add(&nexthop, &lladdr, 1, NBR_REACHABLE);
+
+  for(i = 0; i < BENCH_ROUTES - 1; i++) {
+    make_destination(&addr, i);
+    if(uip_ds6_route_add(&addr, 128, &nexthop) == NULL) {
+      printf("Error: could not add route %d\n", i);
+    }
+  }
+
+  /* A prefix route for the destinations that have no host route. It
+     is added last, as uip_ds6_route_add() would otherwise return the
+     prefix route instead of adding host routes via the same next
+     hop. */
+  uip_ip6addr(&addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&addr, 64, &nexthop);
+  printf("Routes in table: %d\n", uip_ds6_route_num_routes());
+
+  printf("Host routes: %lu lookups/s\n",
+         lookups_per_second(0, BENCH_ROUTES - 1, 1));
+  printf("Prefix route: %lu lookups/s\n",
+         lookups_per_second(BENCH_ROUTES, BENCH_ROUTES, 0));
+
+  /* Remove every other route and check that the rest are found. */
+  for(i = 0; i < BENCH_ROUTES - 1; i += 2) {
+    make_destination(&addr, i);
+    uip_ds6_route_rm(uip_ds6_route_lookup(&addr));
+  }
+  for(i = 0; i < BENCH_ROUTES - 1; i++) {
+    uip_ds6_route_t *r;
+    make_destination(&addr, i);
+    r = uip_ds6_route_lookup(&addr);
+    if(r == NULL || r->length != ((i & 1) ? 128 : 64)) {
+      printf("Error: wrong route for destination %d after removal\n", i);
+    }
+  }
+  printf("Routes after removal: %d\n", uip_ds6_route_num_routes());
+
+  /* The routes have no lifetime and there is no RPL instance, so
+     leave an empty table behind for the RPL route purge. */
+  while(uip_ds6_route_head() != NULL) {
+    uip_ds6_route_rm(uip_ds6_route_head());
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for RPL preferred parent selection.
+ *
+ *         The benchmark joins a DAG through BENCH_PARENTS neighbors and
+ *         then processes a stream of DIOs from random neighbors. Most
+ *         of them repeat the rank of the sender, some announce a
+ *         slightly different one, as happens when the ranks of the
+ *         neighbors follow their link estimates. It reports the time
+ *         per DIO, the calls into the objective function, and how often
+ *         the preferred parent changed.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl-private.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DIOS           200000UL
+/* One DIO in RANK_CHANGE_EVERY announces a new rank */
+#define RANK_CHANGE_EVERY 8
+
+extern rpl_of_t rpl_mrhof;
+
+static unsigned long best_parent_calls;
+static unsigned long parent_cost_calls;
+
+PROCESS(bench_process, "RPL parent selection benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+reset(rpl_dag_t *dag)
+{
+  rpl_mrhof.reset(dag);
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_link_callback(rpl_parent_t *p, int status, int numtx)
+{
+  rpl_mrhof.neighbor_link_callback(p, status, numtx);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
+{
+  best_parent_calls++;
+  return rpl_mrhof.best_parent(p1, p2);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_dag_t *
+best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
+{
+  return rpl_mrhof.best_dag(d1, d2);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_rank_t
+calculate_rank(rpl_parent_t *p, rpl_rank_t base_rank)
+{
+  return rpl_mrhof.calculate_rank(p, base_rank);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_metric_container(rpl_instance_t *instance)
+{
+  rpl_mrhof.update_metric_container(instance);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+parent_cost(rpl_parent_t *p)
+{
+  parent_cost_calls++;
+  return rpl_mrhof.parent_cost(p);
+}
+/*---------------------------------------------------------------------------*/
+rpl_of_t bench_of = {
+  reset,
+  neighbor_link_callback,
+  best_parent,
+  best_dag,
+  calculate_rank,
+  update_metric_container,
+  1,
+  parent_cost
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_neighbor(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr, int id)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->addr[0] = 0x02;
+  lladdr->addr[sizeof(*lladdr) - 2] = id >> 8;
+  lladdr->addr[sizeof(*lladdr) - 1] = id & 0xff;
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_dio(rpl_dio_t *dio, rpl_rank_t rank)
+{
+  memset(dio, 0, sizeof(*dio));
+  uip_ip6addr(&dio->dag_id, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  dio->ocp = bench_of.ocp;
+  dio->rank = rank;
+  dio->grounded = 0;
+  dio->mop = RPL_MOP_DEFAULT;
+  dio->preference = 0;
+  dio->instance_id = RPL_DEFAULT_INSTANCE;
+  dio->dag_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
+  dio->dag_intmin = RPL_DIO_INTERVAL_MIN;
+  dio->dag_redund = RPL_DIO_REDUNDANCY;
+  dio->default_lifetime = RPL_DEFAULT_LIFETIME;
+  dio->lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
+  dio->dag_max_rankinc = RPL_MAX_RANKINC;
+  dio->dag_min_hoprankinc = RPL_MIN_HOPRANKINC;
+  dio->mc.type = RPL_DAG_MC;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_rank_t
+random_rank(void)
+{
+  /* Two to four hops from the root */
+  return (2 + random_rand() % 3) * RPL_MIN_HOPRANKINC +
+    random_rand() % RPL_MIN_HOPRANKINC;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static rpl_rank_t ranks[BENCH_PARENTS];
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  uip_ds6_nbr_t *nbr;
+  rpl_dio_t dio;
+  rpl_instance_t *instance;
+  clock_time_t start;
+  unsigned long i;
+  int id;
+
+  PROCESS_BEGIN();
+
+  random_init(1);
+  for(id = 0; id < BENCH_PARENTS; id++) {
+    make_neighbor(&ipaddr, &lladdr, id + 1);
+    nbr = uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE);
+    if(nbr == NULL) {
+      printf("Error: could not add neighbor %d\n", id);
+      PROCESS_EXIT();
+    }
+    /* ETX between 1 and 3 */
+    nbr->link_metric = RPL_DAG_MC_ETX_DIVISOR +
+      random_rand() % (2 * RPL_DAG_MC_ETX_DIVISOR);
+    ranks[id] = random_rank();
+  }
+
+  for(id = 0; id < BENCH_PARENTS; id++) {
+    make_neighbor(&ipaddr, &lladdr, id + 1);
+    make_dio(&dio, ranks[id]);
+    rpl_process_dio(&ipaddr, &dio);
+  }
+
+  instance = rpl_get_instance(RPL_DEFAULT_INSTANCE);
+  if(instance == NULL || instance->current_dag == NULL ||
+     !instance->current_dag->joined) {
+    printf("Error: did not join the DAG\n");
+    PROCESS_EXIT();
+  }
+
+  printf("RPL parent selection: %s, %d parents\n",
+         RPL_PARENT_HEAP ? "parent heap" : "scan", BENCH_PARENTS);
+
+  best_parent_calls = parent_cost_calls = 0;
+  rpl_stats.parent_switch = rpl_stats.parent_switch_suppressed = 0;
+  start = clock_time();
+  for(i = 0; i < DIOS; i++) {
+    id = random_rand() % BENCH_PARENTS;
+    if(random_rand() % RANK_CHANGE_EVERY == 0) {
+      ranks[id] = random_rank();
+    }
+    make_neighbor(&ipaddr, &lladdr, id + 1);
+    make_dio(&dio, ranks[id]);
+    rpl_process_dio(&ipaddr, &dio);
+  }
+  start = clock_time() - start;
+
+  printf("%lu ns per DIO\n",
+         (unsigned long)(start * (1000000000.0 / CLOCK_SECOND) / DIOS));
+  printf("Per 100 DIOs: %lu best_parent calls, %lu parent_cost calls\n",
+         best_parent_calls * 100 / DIOS, parent_cost_calls * 100 / DIOS);
+  printf("Parent switches: %u, suppressed by hysteresis: %u\n",
+         rpl_stats.parent_switch, rpl_stats.parent_switch_suppressed);
+  printf("Rank: %u\n", instance->current_dag->rank);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
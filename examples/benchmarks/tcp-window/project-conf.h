@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/*
+ * Build with "make DEFINES=UIP_CONF_TCP_WINDOW_SEGMENTS=1" to measure
+ * uIP with a single segment in flight for comparison.
+ */
+#ifndef UIP_CONF_TCP_WINDOW_SEGMENTS
+#define UIP_CONF_TCP_WINDOW_SEGMENTS 4
+#endif
+
+/* Round-trip time of the simulated path in milliseconds */
+#ifndef BENCH_RTT
+#define BENCH_RTT 100
+#endif
+
+/* The peer drops one data segment in BENCH_LOSS, or none if 0 */
+#ifndef BENCH_LOSS
+#define BENCH_LOSS 0
+#endif
+
+/* The peer delays one ACK in BENCH_SPIKE by BENCH_SPIKE_DELAY
+   milliseconds more, or none if 0 */
+#ifndef BENCH_SPIKE
+#define BENCH_SPIKE 0
+#endif
+#ifndef BENCH_SPIKE_DELAY
+#define BENCH_SPIKE_DELAY 3000
+#endif
+
+#undef UIP_CONF_TCP_MSS
+#define UIP_CONF_TCP_MSS         320
+#undef UIP_CONF_MAX_CONNECTIONS
+#define UIP_CONF_MAX_CONNECTIONS 4
+
+#endif /* PROJECT_CONF_H_ */
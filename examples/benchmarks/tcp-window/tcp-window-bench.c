@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the TCP send window.
+ *
+ *         The benchmark sends BENCH_BYTES over a TCP socket to a
+ *         simulated peer behind a path with a round-trip time of
+ *         BENCH_RTT milliseconds, as a firmware or HTTP transfer over a
+ *         multi-hop 6LoWPAN network does. The peer is a TCP sink that
+ *         checks the byte stream, and acknowledges every data segment
+ *         after the round-trip time. It accepts data in order only, and
+ *         drops one segment in BENCH_LOSS to exercise retransmissions.
+ *         One ACK in BENCH_SPIKE is delayed by BENCH_SPIKE_DELAY
+ *         milliseconds more, and the ACKs behind it are merged into it,
+ *         so that the sender times out and retransmits before one
+ *         cumulative ACK for all its data arrives.
+ *         The socket is closed once all data is queued, so the FIN has
+ *         to follow the last data segment.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ip/tcp-socket.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_BYTES    32768UL
+#define PEER_PORT      9
+#define PEER_WINDOW    4096
+#define PEER_ISS       1000UL
+#define ACK_QUEUE_SIZE 32
+#define TIMEOUT        (120 * CLOCK_SECOND)
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+struct ack {
+  clock_time_t due;
+  uint32_t ackno;
+  uint8_t flags;
+};
+
+static struct ack acks[ACK_QUEUE_SIZE];
+static uint8_t ack_head, ack_count;
+static unsigned long ack_total;
+static clock_time_t ack_last_due;
+static struct ctimer ack_timer;
+
+static uip_ipaddr_t peer_addr, local_addr;
+static uint16_t local_port;
+static uint32_t peer_rcv_nxt;
+static uint8_t fin_received;
+
+static unsigned long queued, delivered, segments, duplicates, dropped, errors;
+static clock_time_t start, end;
+
+static struct tcp_socket socket;
+static uint8_t inputbuf[64];
+static uint8_t outputbuf[2 * UIP_TCP_MSS];
+
+PROCESS(bench_process, "TCP window benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+stream_byte(unsigned long offset)
+{
+  return (offset ^ (offset >> 8)) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_ack(void *ptr)
+{
+  struct ack a;
+  clock_time_t now;
+  int hdrlen;
+
+  a = acks[ack_head];
+  ack_head = (ack_head + 1) % ACK_QUEUE_SIZE;
+  ack_count--;
+
+  hdrlen = UIP_TCPH_LEN + ((a.flags & TCP_SYN) ? 4 : 0);
+  uip_len = UIP_IPH_LEN + hdrlen;
+  uip_ext_len = 0;
+  memset(uip_buf, 0, UIP_LLH_LEN + uip_len);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = hdrlen >> 8;
+  UIP_IP_BUF->len[1] = hdrlen & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_TCP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &peer_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &local_addr);
+
+  UIP_TCP_BUF->srcport = UIP_HTONS(PEER_PORT);
+  UIP_TCP_BUF->destport = local_port;
+  put32(UIP_TCP_BUF->seqno, (a.flags & TCP_SYN) ? PEER_ISS : PEER_ISS + 1);
+  put32(UIP_TCP_BUF->ackno, a.ackno);
+  UIP_TCP_BUF->tcpoffset = (hdrlen / 4) << 4;
+  UIP_TCP_BUF->flags = a.flags;
+  UIP_TCP_BUF->wnd[0] = PEER_WINDOW >> 8;
+  UIP_TCP_BUF->wnd[1] = PEER_WINDOW & 0xff;
+  if(a.flags & TCP_SYN) {
+    UIP_TCP_BUF->optdata[0] = 2;
+    UIP_TCP_BUF->optdata[1] = 4;
+    UIP_TCP_BUF->optdata[2] = UIP_TCP_MSS >> 8;
+    UIP_TCP_BUF->optdata[3] = UIP_TCP_MSS & 0xff;
+  }
+  UIP_TCP_BUF->tcpchksum = 0;
+  UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+  tcpip_input();
+
+  if(ack_count > 0) {
+    now = clock_time();
+    a = acks[ack_head];
+    ctimer_set(&ack_timer, a.due > now ? a.due - now : 0, send_ack, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_ack(uint32_t ackno, uint8_t flags)
+{
+  struct ack *a;
+  clock_time_t due;
+
+  if(ack_count == ACK_QUEUE_SIZE) {
+    return;
+  }
+  due = clock_time() + BENCH_RTT * CLOCK_SECOND / 1000;
+  if(ack_count > 0 && due < ack_last_due) {
+    /* Merge the ACK into the delayed one before it */
+    a = &acks[(ack_head + ack_count - 1) % ACK_QUEUE_SIZE];
+    if(a->flags == TCP_ACK && flags == TCP_ACK) {
+      a->ackno = ackno;
+      return;
+    }
+    due = ack_last_due;
+  }
+  if(BENCH_SPIKE > 0 && ++ack_total % BENCH_SPIKE == 0) {
+    due += BENCH_SPIKE_DELAY * CLOCK_SECOND / 1000;
+  }
+  ack_last_due = due;
+  a = &acks[(ack_head + ack_count) % ACK_QUEUE_SIZE];
+  a->due = due;
+  a->ackno = ackno;
+  a->flags = flags;
+  if(ack_count++ == 0) {
+    ctimer_set(&ack_timer, a->due - clock_time(), send_ack, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The peer receives the packets that uIP sends. */
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  uint32_t seqno;
+  uint8_t *data;
+  int i, len;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_TCP) {
+    return 0;
+  }
+  seqno = get32(UIP_TCP_BUF->seqno);
+  data = (uint8_t *)UIP_TCP_BUF + ((UIP_TCP_BUF->tcpoffset >> 4) << 2);
+  len = uip_len - (data - (uint8_t *)UIP_IP_BUF);
+
+  if(UIP_TCP_BUF->flags & TCP_FIN) {
+    if(seqno == peer_rcv_nxt && len == 0 && !fin_received) {
+      fin_received = 1;
+      process_poll(&bench_process);
+    }
+    return 0;
+  }
+  if(UIP_TCP_BUF->flags & TCP_SYN) {
+    uip_ipaddr_copy(&local_addr, &UIP_IP_BUF->srcipaddr);
+    local_port = UIP_TCP_BUF->srcport;
+    peer_rcv_nxt = seqno + 1;
+    queue_ack(peer_rcv_nxt, TCP_SYN | TCP_ACK);
+    return 0;
+  }
+  if(len == 0) {
+    return 0;
+  }
+
+  segments++;
+  if(BENCH_LOSS > 0 && segments % BENCH_LOSS == 0) {
+    dropped++;
+    return 0;
+  }
+  if(seqno == peer_rcv_nxt) {
+    for(i = 0; i < len; i++) {
+      if(data[i] != stream_byte(delivered + i)) {
+        errors++;
+        break;
+      }
+    }
+    peer_rcv_nxt += len;
+    delivered += len;
+    if(delivered >= BENCH_BYTES && end == 0) {
+      end = clock_time();
+    }
+  } else {
+    duplicates++;
+  }
+  queue_ack(peer_rcv_nxt, TCP_ACK);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(struct tcp_socket *s)
+{
+  uint8_t buf[64];
+  int i, len;
+
+  while(queued < BENCH_BYTES) {
+    len = BENCH_BYTES - queued > sizeof(buf) ? sizeof(buf) : BENCH_BYTES - queued;
+    for(i = 0; i < len; i++) {
+      buf[i] = stream_byte(queued + i);
+    }
+    len = tcp_socket_send(s, buf, len);
+    if(len <= 0) {
+      break;
+    }
+    queued += len;
+  }
+  if(queued == BENCH_BYTES) {
+    tcp_socket_close(s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *s, void *ptr, const uint8_t *data, int len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+  if(ev == TCP_SOCKET_CONNECTED) {
+    start = clock_time();
+    fill(s);
+  } else if(ev == TCP_SOCKET_DATA_SENT) {
+    fill(s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer timeout;
+  uip_lladdr_t lladdr;
+  unsigned long ms;
+
+  PROCESS_BEGIN();
+
+  tcpip_set_outputfunc(output);
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[0] = 0x02;
+  lladdr.addr[sizeof(lladdr) - 1] = 0x02;
+  uip_ip6addr(&peer_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&peer_addr, &lladdr);
+  uip_ds6_nbr_add(&peer_addr, &lladdr, 0, NBR_REACHABLE);
+
+  tcp_socket_register(&socket, NULL, inputbuf, sizeof(inputbuf),
+                      outputbuf, sizeof(outputbuf), input, event);
+  tcp_socket_connect(&socket, &peer_addr, PEER_PORT);
+
+  etimer_set(&timeout, TIMEOUT);
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&timeout));
+  if(!fin_received) {
+    printf("Error: transfer stalled after %lu bytes\n", delivered);
+    PROCESS_EXIT();
+  }
+
+  ms = (end - start) * 1000UL / CLOCK_SECOND;
+  printf("TCP window: %u segments, MSS %u, RTT %u ms, loss 1/%u, "
+         "spike 1/%u\n", UIP_TCP_WINDOW_SEGMENTS, UIP_TCP_MSS, BENCH_RTT,
+         BENCH_LOSS, BENCH_SPIKE);
+  printf("%lu bytes in %lu ms: %lu bytes/s\n",
+         delivered, ms, ms > 0 ? delivered * 1000UL / ms : 0);
+  printf("Data segments: %lu, dropped %lu, duplicates %lu, errors %lu\n",
+         segments, dropped, duplicates, errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
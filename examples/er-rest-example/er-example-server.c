@@ -42,6 +42,7 @@
 #include "contiki.h"
 #include "contiki-net.h"
 #include "rest-engine.h"
+#include "net/mac/csma.h"
 
 #if PLATFORM_HAS_BUTTON
 #include "dev/button-sensor.h"
@@ -79,6 +80,9 @@ extern resource_t res_leds, res_toggle;
 #include "dev/light-sensor.h"
 extern resource_t res_light;
 #endif
+#if CSMA_STATS
+extern resource_t res_csma;
+#endif
 /*
 #if PLATFORM_HAS_BATTERY
 #include "dev/battery-sensor.h"
@@ -141,6 +145,9 @@ PROCESS_THREAD(er_example_server, ev, data)
   rest_activate_resource(&res_light, "sensors/light"); 
   SENSORS_ACTIVATE(light_sensor);  
 #endif
+#if CSMA_STATS
+  rest_activate_resource(&res_csma, "debug/csma");
+#endif
 /*
 #if PLATFORM_HAS_BATTERY
   rest_activate_resource(&res_battery, "sensors/battery");  
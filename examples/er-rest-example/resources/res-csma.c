@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      CSMA queue statistics resource
+ */
+
+#include "contiki.h"
+#include "net/mac/csma.h"
+
+#if CSMA_STATS
+
+#include <stdio.h>
+#include <string.h>
+#include "rest-engine.h"
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/*
+ * One line with the totals, "queued sent dropped collisions
+ * transmissions", then one line per neighbor, "lladdr queue-length
+ * queued sent dropped collisions transmissions". Large tables are
+ * returned block-wise.
+ */
+RESOURCE(res_csma,
+         "title=\"CSMA statistics\";rt=\"Debug\"",
+         res_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+/* The part of the representation that goes into the current block */
+static uint8_t *block;
+static int32_t block_start;
+static uint16_t block_size, block_len;
+/* The length of the representation generated so far */
+static int32_t text_len;
+
+static void
+add_line(const char *line)
+{
+  int32_t len, i;
+
+  len = strlen(line);
+  for(i = block_start > text_len ? block_start - text_len : 0;
+      i < len && block_len < block_size; i++) {
+    block[block_len++] = line[i];
+  }
+  text_len += len;
+}
+
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  char line[80];
+  char *p;
+  struct csma_stats *s;
+  const linkaddr_t *addr;
+  int i;
+
+  block = buffer;
+  block_start = *offset;
+  block_size = preferred_size;
+  block_len = 0;
+  text_len = 0;
+
+  s = &csma_stats;
+  snprintf(line, sizeof(line), "%u %u %u %u %u\n",
+           s->queued, s->sent, s->dropped, s->collisions, s->transmissions);
+  add_line(line);
+  for(s = csma_stats_neighbor_head(); s != NULL;
+      s = csma_stats_neighbor_next(s)) {
+    addr = csma_stats_neighbor_lladdr(s);
+    p = line;
+    for(i = 0; i < LINKADDR_SIZE; i++) {
+      p += sprintf(p, i == 0 ? "%02x" : ":%02x", addr->u8[i]);
+    }
+    snprintf(p, sizeof(line) - (p - line), " %d %u %u %u %u %u\n",
+             csma_queue_length(addr), s->queued, s->sent, s->dropped,
+             s->collisions, s->transmissions);
+    add_line(line);
+  }
+
+  if(*offset >= text_len) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    /* A block error message should not exceed the minimum block size (16). */
+    const char *error_msg = "BlockOutOfScope";
+    REST.set_response_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, block_len);
+
+  /* Signal chunk awareness and the end of the representation */
+  *offset += block_len;
+  if(*offset >= text_len) {
+    *offset = -1;
+  }
+}
+#endif /* CSMA_STATS */
@@ -61,6 +61,7 @@ PROCESS_THREAD(example_shell_process, ev, data)
   shell_base64_init();
   shell_blink_init();
   /*shell_coffee_init();*/
+  shell_csma_init();
   shell_download_init();
   /*shell_exec_init();*/
   shell_file_init();
@@ -111,6 +111,26 @@ test_sec_lvl_6()
   } else {
     printf("Failure\n");
   }
+
+  printf("Testing authenticated encryption ... ");
+  memset(mic, 0, LLSEC802154_MIC_LENGTH);
+  CCM_STAR.aead(extended_source_address, mic, LLSEC802154_MIC_LENGTH, 1);
+  if((((uint8_t *) packetbuf_hdrptr())[29] == 0xD8)
+      && (memcmp(mic, oracle, LLSEC802154_MIC_LENGTH) == 0)) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
+
+  printf("Testing authenticated decryption ... ");
+  memset(mic, 0, LLSEC802154_MIC_LENGTH);
+  CCM_STAR.aead(extended_source_address, mic, LLSEC802154_MIC_LENGTH, 0);
+  if((((uint8_t *) packetbuf_hdrptr())[29] == 0xCE)
+      && (memcmp(mic, oracle, LLSEC802154_MIC_LENGTH) == 0)) {
+    printf("Success\n");
+  } else {
+    printf("Failure\n");
+  }
 }
 /*---------------------------------------------------------------------------*/
 PROCESS(ccm_star_tests_process, "CCM* tests process");
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Tests for broadcast event subscriptions.
+ *
+ *         Checks that a broadcast event with subscribers reaches only
+ *         them, that it reaches all processes again once they have
+ *         unsubscribed, and that a subscription to PROCESS_EVENT_EXITED
+ *         does not keep the event from the etimer process, which
+ *         removes the timers of exited processes.
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+
+static process_event_t test_event;
+static int subscriber_count, bystander_count;
+static struct etimer exiting_timer;
+
+PROCESS(test_process, "Subscription test process");
+PROCESS(subscriber_process, "Subscriber");
+PROCESS(bystander_process, "Bystander");
+PROCESS(exiting_process, "Exiting process");
+AUTOSTART_PROCESSES(&test_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(subscriber_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  process_subscribe(test_event);
+  process_subscribe(PROCESS_EVENT_EXITED);
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == test_event) {
+      subscriber_count++;
+    } else if(ev == PROCESS_EVENT_CONTINUE) {
+      process_unsubscribe(test_event);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bystander_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == test_event) {
+      bystander_count++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(exiting_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  etimer_set(&exiting_timer, 10 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&exiting_timer));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(const char *name, int ok)
+{
+  printf("Testing %s ... %s\n", name, ok ? "Success" : "Failure");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  test_event = process_alloc_event();
+  process_start(&subscriber_process, NULL);
+  process_start(&bystander_process, NULL);
+  process_start(&exiting_process, NULL);
+
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  PROCESS_PAUSE();
+  check("delivery to subscribers",
+        subscriber_count == 1 && bystander_count == 0);
+
+  process_post(&subscriber_process, PROCESS_EVENT_CONTINUE, NULL);
+  PROCESS_PAUSE();
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  PROCESS_PAUSE();
+  check("delivery to all after unsubscribing",
+        subscriber_count == 2 && bystander_count == 1);
+
+  check("timer of running process", !etimer_expired(&exiting_timer));
+  process_exit(&exiting_process);
+  check("timer removal on exit", etimer_expired(&exiting_timer));
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,39 @@
+TIMEOUT(300000, log.log("last message: " + msg + "\n"));
+
+/* The adaptive check rate should bring the round-trip time below the
+   base cycle of 125 ms, and decay back to the idle duty cycle after
+   the traffic. */
+requests = 20;
+replies = 0;
+rtt_sum = 0;
+before = [];
+nodes = 0;
+while(true) {
+    YIELD();
+    if(msg.startsWith('Reply')) {
+        replies++;
+        rtt_sum += parseInt(msg.split(' ')[3]);
+    }
+    if(msg.startsWith('Idle duty cycle before')) {
+        before[id] = parseInt(msg.split(' ')[4]);
+    }
+    if(msg.startsWith('Idle duty cycle after')) {
+        after = parseInt(msg.split(' ')[4]);
+        log.log("Node " + id + " idle duty cycle " + before[id] +
+                " permille before, " + after + " permille after\n");
+        if(after > before[id] * 3 / 2 + 2) {
+            log.log("Check rate did not decay\n");
+            log.testFailed();
+        }
+        nodes++;
+    }
+    if(nodes == 2) {
+        log.log("Heard " + replies + " replies, mean RTT " +
+                rtt_sum / replies + " ms\n");
+        if(replies == requests && rtt_sum / replies < 125) {
+            log.testOK();
+        } else {
+            log.testFailed();
+        }
+    }
+}